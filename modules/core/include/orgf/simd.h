@@ -0,0 +1,23 @@
+#ifndef ORGF_SIMD_H
+#define ORGF_SIMD_H 1
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ORGF_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define ORGF_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Hints a spin wait to the CPU, so a sibling hardware thread runs meanwhile
+#if defined(ORGF_SIMD_SSE2)
+#define ORGF_CPU_PAUSE() _mm_pause()
+#endif
+
+#if defined(_MSC_VER)
+#define ORGF_RESTRICT __restrict
+#else
+#define ORGF_RESTRICT __restrict__
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef ORGF_THREAD_H
+#define ORGF_THREAD_H 1
+
+#include <mruby.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *orgf_thread;
+typedef void *orgf_signal;
+typedef void (*orgf_thread_func)(void *data);
+typedef volatile long orgf_atomic;
+
+mrb_bool
+orgf_thread_start(orgf_thread *thread, orgf_thread_func func, void *data);
+
+void
+orgf_thread_join(orgf_thread thread);
+
+void
+orgf_thread_sleep(unsigned int milliseconds);
+
+/* Gives the rest of the time slice to another thread, for short waits. */
+void
+orgf_thread_yield(void);
+
+/* A counter threads can sleep on until another thread raises it, so idle
+   threads wait without polling. */
+mrb_bool
+orgf_signal_init(orgf_signal *signal);
+
+void
+orgf_signal_destroy(orgf_signal signal);
+
+/* Wakes every thread waiting on the signal. */
+void
+orgf_signal_raise(orgf_signal signal);
+
+/* Sleeps until the signal was raised past seen, a value an earlier wait
+   returned or 0, and returns how many times it was raised. Raises that
+   happen before the call are not lost. */
+long
+orgf_signal_wait(orgf_signal signal, long seen);
+
+int
+orgf_cpu_count(void);
+
+uint64_t
+orgf_time_ns(void);
+
+#if defined(_MSC_VER)
+
+static inline long
+orgf_atomic_load(orgf_atomic *value)
+{
+  return _InterlockedCompareExchange(value, 0, 0);
+}
+
+static inline void
+orgf_atomic_store(orgf_atomic *value, long desired)
+{
+  _InterlockedExchange(value, desired);
+}
+
+static inline long
+orgf_atomic_fetch_add(orgf_atomic *value, long amount)
+{
+  return _InterlockedExchangeAdd(value, amount);
+}
+
+static inline mrb_bool
+orgf_atomic_cas(orgf_atomic *value, long expected, long desired)
+{
+  return _InterlockedCompareExchange(value, desired, expected) == expected;
+}
+
+#else
+
+static inline long
+orgf_atomic_load(orgf_atomic *value)
+{
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void
+orgf_atomic_store(orgf_atomic *value, long desired)
+{
+  __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+}
+
+static inline long
+orgf_atomic_fetch_add(orgf_atomic *value, long amount)
+{
+  return __atomic_fetch_add(value, amount, __ATOMIC_ACQ_REL);
+}
+
+static inline mrb_bool
+orgf_atomic_cas(orgf_atomic *value, long expected, long desired)
+{
+  return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,264 @@
+#include <mruby.h>
+#include <stdlib.h>
+
+#include <orgf/thread.h>
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <process.h>
+
+typedef struct
+{
+  orgf_thread_func  func;
+  void             *data;
+} thread_start;
+
+static unsigned __stdcall
+thread_main(void *p)
+{
+  thread_start start = *(thread_start *)p;
+  free(p);
+  start.func(start.data);
+  return 0;
+}
+
+mrb_bool
+orgf_thread_start(orgf_thread *thread, orgf_thread_func func, void *data)
+{
+  thread_start *start = malloc(sizeof *start);
+  if (!start) return FALSE;
+  start->func = func;
+  start->data = data;
+  uintptr_t handle = _beginthreadex(NULL, 0, thread_main, start, 0, NULL);
+  if (!handle)
+  {
+    free(start);
+    return FALSE;
+  }
+  *thread = (orgf_thread)handle;
+  return TRUE;
+}
+
+void
+orgf_thread_join(orgf_thread thread)
+{
+  WaitForSingleObject((HANDLE)thread, INFINITE);
+  CloseHandle((HANDLE)thread);
+}
+
+void
+orgf_thread_sleep(unsigned int milliseconds)
+{
+  Sleep(milliseconds);
+}
+
+void
+orgf_thread_yield(void)
+{
+  SwitchToThread();
+}
+
+typedef struct
+{
+  CRITICAL_SECTION    lock;
+  CONDITION_VARIABLE  raised;
+  long                count;
+} signal_state;
+
+mrb_bool
+orgf_signal_init(orgf_signal *signal)
+{
+  signal_state *state = malloc(sizeof *state);
+  if (!state) return FALSE;
+  InitializeCriticalSection(&(state->lock));
+  InitializeConditionVariable(&(state->raised));
+  state->count = 0;
+  *signal = state;
+  return TRUE;
+}
+
+void
+orgf_signal_destroy(orgf_signal signal)
+{
+  signal_state *state = signal;
+  DeleteCriticalSection(&(state->lock));
+  free(state);
+}
+
+void
+orgf_signal_raise(orgf_signal signal)
+{
+  signal_state *state = signal;
+  EnterCriticalSection(&(state->lock));
+  state->count += 1;
+  LeaveCriticalSection(&(state->lock));
+  WakeAllConditionVariable(&(state->raised));
+}
+
+long
+orgf_signal_wait(orgf_signal signal, long seen)
+{
+  signal_state *state = signal;
+  EnterCriticalSection(&(state->lock));
+  while (state->count == seen) SleepConditionVariableCS(&(state->raised), &(state->lock), INFINITE);
+  long count = state->count;
+  LeaveCriticalSection(&(state->lock));
+  return count;
+}
+
+int
+orgf_cpu_count(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int)info.dwNumberOfProcessors;
+}
+
+uint64_t
+orgf_time_ns(void)
+{
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  uint64_t seconds = (uint64_t)(counter.QuadPart / frequency.QuadPart);
+  uint64_t rest = (uint64_t)(counter.QuadPart % frequency.QuadPart);
+  return seconds * 1000000000ull + rest * 1000000000ull / (uint64_t)frequency.QuadPart;
+}
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct
+{
+  orgf_thread_func  func;
+  void             *data;
+  pthread_t         handle;
+} thread_start;
+
+static void *
+thread_main(void *p)
+{
+  thread_start *start = p;
+  start->func(start->data);
+  return NULL;
+}
+
+mrb_bool
+orgf_thread_start(orgf_thread *thread, orgf_thread_func func, void *data)
+{
+  thread_start *start = malloc(sizeof *start);
+  if (!start) return FALSE;
+  start->func = func;
+  start->data = data;
+  if (pthread_create(&(start->handle), NULL, thread_main, start))
+  {
+    free(start);
+    return FALSE;
+  }
+  *thread = start;
+  return TRUE;
+}
+
+void
+orgf_thread_join(orgf_thread thread)
+{
+  thread_start *start = thread;
+  pthread_join(start->handle, NULL);
+  free(start);
+}
+
+void
+orgf_thread_sleep(unsigned int milliseconds)
+{
+  struct timespec ts;
+  ts.tv_sec = milliseconds / 1000;
+  ts.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+void
+orgf_thread_yield(void)
+{
+  sched_yield();
+}
+
+typedef struct
+{
+  pthread_mutex_t  lock;
+  pthread_cond_t   raised;
+  long             count;
+} signal_state;
+
+mrb_bool
+orgf_signal_init(orgf_signal *signal)
+{
+  signal_state *state = malloc(sizeof *state);
+  if (!state) return FALSE;
+  if (pthread_mutex_init(&(state->lock), NULL))
+  {
+    free(state);
+    return FALSE;
+  }
+  if (pthread_cond_init(&(state->raised), NULL))
+  {
+    pthread_mutex_destroy(&(state->lock));
+    free(state);
+    return FALSE;
+  }
+  state->count = 0;
+  *signal = state;
+  return TRUE;
+}
+
+void
+orgf_signal_destroy(orgf_signal signal)
+{
+  signal_state *state = signal;
+  pthread_cond_destroy(&(state->raised));
+  pthread_mutex_destroy(&(state->lock));
+  free(state);
+}
+
+void
+orgf_signal_raise(orgf_signal signal)
+{
+  signal_state *state = signal;
+  pthread_mutex_lock(&(state->lock));
+  state->count += 1;
+  pthread_cond_broadcast(&(state->raised));
+  pthread_mutex_unlock(&(state->lock));
+}
+
+long
+orgf_signal_wait(orgf_signal signal, long seen)
+{
+  signal_state *state = signal;
+  pthread_mutex_lock(&(state->lock));
+  while (state->count == seen) pthread_cond_wait(&(state->raised), &(state->lock));
+  long count = state->count;
+  pthread_mutex_unlock(&(state->lock));
+  return count;
+}
+
+int
+orgf_cpu_count(void)
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count < 1 ? 1 : (int)count;
+}
+
+uint64_t
+orgf_time_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#endif
@@ -9,6 +9,7 @@ require_relative 'dependencies/rayfork'
 require_relative 'dependencies/physfs'
 require_relative 'dependencies/dgs'
 require_relative 'dependencies/boxer'
+require_relative 'dependencies/plmpeg'
 
 require_relative 'platforms/platform'
 # Windows builds
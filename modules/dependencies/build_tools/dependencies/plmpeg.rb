@@ -0,0 +1,9 @@
+class PLMpeg < Dependency
+  def libraries
+    []
+  end
+
+  def configure; end
+
+  def compile; end
+end
@@ -2,4 +2,9 @@ class Rayfork < Dependency
   def libraries
     ['rayfork-dev']
   end
+
+  # The glyph cache rasterizes with the stb_truetype rayfork bundles
+  def include_paths
+    super + [File.join(dir, 'libs'), File.join(dir, 'src', 'libs')].filter { |f| File.exist?(f) }
+  end
 end
@@ -85,13 +85,17 @@ module PlatformDetector
     end
 
     def core_dependencies
-      [rayfork]
+      [rayfork, plmpeg]
     end
 
     def rayfork
       @rayfork ||= Rayfork.new(self)
     end
 
+    def plmpeg
+      @plmpeg ||= PLMpeg.new(self)
+    end
+
     def configure_compilers
       compilers.each do |c|
         c.defines       += compiler_definitions
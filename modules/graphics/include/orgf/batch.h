@@ -0,0 +1,57 @@
+#ifndef ORGF_BATCH_H
+#define ORGF_BATCH_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_BATCH_DEFAULT_SIZE 8192
+#define ORGF_BATCH_MAX_SIZE (1024 * 1024)
+#define ORGF_BATCH_DEFAULT_BUFFERS 3
+#define ORGF_BATCH_MAX_BUFFERS 8
+#define ORGF_BATCH_DRAW_CALLS 256
+#define ORGF_BATCH_FULL_SLACK 1024
+#define ORGF_BATCH_TRACKED_BUFFERS (ORGF_BATCH_MAX_BUFFERS * 4)
+
+typedef struct rf_batch_config rf_batch_config;
+typedef struct rf_batch_stats rf_batch_stats;
+
+enum rf_batch_streaming
+{
+  RF_BATCH_ROTATE,
+  RF_BATCH_ORPHAN,
+};
+
+struct rf_batch_config
+{
+  mrb_int                  size;
+  mrb_int                  buffers;
+  enum rf_batch_streaming  streaming;
+};
+
+/* A flush counts as full when the batch was within one engine request
+   (ORGF_BATCH_FULL_SLACK quads) of its capacity. */
+struct rf_batch_stats
+{
+  mrb_int  flushes;
+  mrb_int  full_flushes;
+  mrb_int  orphaned;
+};
+
+void
+mrb_batch_config_init(rf_batch_config *config);
+
+rf_render_batch
+mrb_batch_create(rf_batch_config *config, rf_batch_stats *stats, rf_allocator allocator);
+
+void
+mrb_batch_unload(rf_render_batch batch, rf_allocator allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,7 +5,13 @@
 #include <mruby/data.h>
 #include <rayfork.h>
 
+#include <orgf/collision.h>
 #include <orgf/drawable.h>
+#include <orgf/font.h>
+#include <orgf/readback.h>
+#include <orgf/residency.h>
+#include <orgf/texformat.h>
+#include <orgf/tiles.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,10 +26,54 @@ struct rf_bitmap
 {
   rf_image     image;
   rf_texture2d texture;
-  rf_font     *font;
+  rf_text_font *font;
   mrb_bool     dirty;
+  mrb_bool     uploaded;
+  mrb_bool     upload_avoided;
+  rf_readback *readback;
+  char        *source;
+  mrb_bool     read_only;
+  enum rf_texture_format texture_format;
+  size_t       image_bytes;
+  size_t       released_bytes;
+  mrb_int      last_used;
+  mrb_bool     pinned;
+  rf_bitmap   *lru_prev;
+  rf_bitmap   *lru_next;
+  rf_collision_mask *collision;
+  rf_tiled_texture  *tiles;
+  rf_rec       dirty_rect;
 };
 
+void
+mrb_bitmap_materialize(mrb_state *mrb, rf_bitmap *bmp);
+
+void
+mrb_bitmap_upload(mrb_state *mrb, rf_bitmap *bmp);
+
+/* Uploads only the pixels inside dirty_rect to the current texture. */
+void
+mrb_bitmap_upload_region(mrb_state *mrb, rf_bitmap *bmp);
+
+/* Marks the pixels inside rect as changed. While the texture can take it,
+   only the union of every marked rect is uploaded on the next draw,
+   otherwise the whole bitmap is. */
+void
+mrb_bitmap_mark_dirty(rf_bitmap *bmp, rf_rec rect);
+
+/* Like mrb_bitmap_get_image, but for callers about to change the pixels:
+   the bitmap stops being read only and keeps its pixels from then on. */
+rf_image *
+mrb_bitmap_get_mutable_image(mrb_state *mrb, rf_bitmap *bmp);
+
+/* The cached mask, built again when the threshold differs or the pixels
+   changed since it was made. */
+rf_collision_mask *
+mrb_bitmap_get_collision_mask(mrb_state *mrb, rf_bitmap *bmp, int threshold);
+
+mrb_value
+mrb_bitmap_new_from_render_texture(mrb_state *mrb, rf_render_texture2d target);
+
 static inline rf_bitmap *
 mrb_get_bitmap(mrb_state *mrb, mrb_value obj)
 {
@@ -36,15 +86,20 @@ mrb_get_bitmap(mrb_state *mrb, mrb_value obj)
   return bmp;
 }
 
+static inline rf_image *
+mrb_bitmap_get_image(mrb_state *mrb, rf_bitmap *bmp)
+{
+  if (!bmp->image.data) mrb_bitmap_materialize(mrb, bmp);
+  return &(bmp->image);
+}
+
 static inline void
-mrb_refresh_bitmap(rf_bitmap *bmp)
+mrb_refresh_bitmap(mrb_state *mrb, rf_bitmap *bmp)
 {
-  if (bmp->dirty)
-  {
-    bmp->dirty = FALSE;
-    rf_unload_texture(bmp->texture);
-    bmp->texture = rf_load_texture_from_image(bmp->image);
-  }
+  // An evicted texture comes back here, right before it is drawn
+  if (bmp->dirty || (!bmp->texture.id && !bmp->tiles)) mrb_bitmap_upload(mrb, bmp);
+  else if (bmp->dirty_rect.width > 0) mrb_bitmap_upload_region(mrb, bmp);
+  mrb_residency_touch(bmp);
 }
 
 static inline mrb_bool
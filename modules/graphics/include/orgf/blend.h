@@ -0,0 +1,58 @@
+#ifndef ORGF_BLEND_H
+#define ORGF_BLEND_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* With premultiplied alpha every texture holds its colors already multiplied
+   by their alpha, bitmaps keep straight pixels and are only premultiplied on
+   their way to the GPU. Alpha and additive draws then use the same blend
+   function, additive ones just leave the alpha out of their vertex color, so
+   switching between them doesn't flush the batch. */
+mrb_bool
+mrb_get_premultiplied_alpha(void);
+
+/* Only before the game starts, every texture and shader depends on it. */
+void
+mrb_set_premultiplied_alpha(mrb_bool value);
+
+/* Premultiplies count RGBA pixels in place. */
+void
+mrb_premultiply_pixels(unsigned char *pixels, size_t count);
+
+/* Premultiplies the pixels of an image in place, formats without alpha are
+   left as they are. */
+void
+mrb_premultiply_image(rf_image *image);
+
+/* Turns premultiplied RGBA pixels read back from the GPU straight again. */
+void
+mrb_unpremultiply_pixels(unsigned char *pixels, size_t count);
+
+/* The vertex color a draw with this color and blend mode has to use. */
+rf_color
+mrb_blend_color(rf_color color, rf_blend_mode mode);
+
+/* Drop in replacements for rf_begin_blend_mode and rf_end_blend_mode, they
+   must be used everywhere as premultiplied blending bypasses rayfork. */
+void
+mrb_begin_blend_mode(rf_blend_mode mode);
+
+void
+mrb_end_blend_mode(void);
+
+/* Forgets the blend function last given to GL, a new context starts with
+   its own state. */
+void
+mrb_reset_blend_state(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef ORGF_CAPTURE_H
+#define ORGF_CAPTURE_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#include <orgf/file.h>
+#include <orgf/thread.h>
+#include <orgf/readback.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_CAPTURE_SLOTS 8
+#define ORGF_CAPTURE_READBACKS 3
+#define ORGF_CAPTURE_MAX_WORKERS 4
+
+typedef struct rf_capture rf_capture;
+typedef struct rf_capture_frame rf_capture_frame;
+typedef struct rf_capture_stats rf_capture_stats;
+
+enum rf_capture_format
+{
+  RF_CAPTURE_PNG,
+  RF_CAPTURE_Y4M,
+};
+
+struct rf_capture_stats
+{
+  mrb_int  captured;
+  mrb_int  dropped;
+  mrb_int  written;
+  mrb_int  failed;
+  uint64_t latency_total;
+  uint64_t latency_max;
+};
+
+/* A slot goes from free to queued on the main thread, from queued to
+   encoded on a worker, from encoded to written on the writer thread, and
+   back to free once the main thread counted it. */
+struct rf_capture_frame
+{
+  orgf_atomic     state;
+  long            sequence;
+  mrb_int         frame;
+  unsigned char  *pixels;
+  unsigned char  *data;
+  size_t          size;
+  mrb_bool        written;
+  uint64_t        queued_at;
+  uint64_t        encoded_at;
+};
+
+struct rf_capture
+{
+  rf_capture_frame        frames[ORGF_CAPTURE_SLOTS];
+  rf_readback             readbacks[ORGF_CAPTURE_READBACKS];
+  mrb_int                 readback_frames[ORGF_CAPTURE_READBACKS];
+  mrb_int                 readback_head;
+  mrb_int                 readback_tail;
+  orgf_thread             workers[ORGF_CAPTURE_MAX_WORKERS];
+  int                     worker_count;
+  orgf_thread             writer;
+  mrb_bool                writer_started;
+  orgf_signal             queued;
+  orgf_signal             encoded;
+  orgf_atomic             running;
+  orgf_atomic             writing;
+  orgf_atomic             next_job;
+  long                    head;
+  long                    write_tail;
+  long                    tail;
+  enum rf_capture_format  format;
+  int                     width;
+  int                     height;
+  mrb_int                 every;
+  mrb_int                 ticks;
+  char                   *path;
+  struct PHYSFS_File     *stream;
+  rf_capture_stats        stats;
+};
+
+rf_capture *
+mrb_capture_start(mrb_state *mrb, const char *path, mrb_int every, int width, int height, mrb_int frame_rate);
+
+void
+mrb_capture_frame(mrb_state *mrb, rf_capture *capture, rf_render_texture2d target);
+
+void
+mrb_capture_stop(mrb_state *mrb, rf_capture *capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
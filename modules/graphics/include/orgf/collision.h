@@ -0,0 +1,49 @@
+#ifndef ORGF_COLLISION_H
+#define ORGF_COLLISION_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_COLLISION_THRESHOLD 128
+
+typedef struct rf_collision_mask rf_collision_mask;
+
+/* One bit per pixel, set when its alpha reaches the threshold. Bit x of a
+   row lives in bit x % 64 of word x / 64, bits past the width are zero. */
+struct rf_collision_mask
+{
+  int       width;
+  int       height;
+  int       stride;
+  int       threshold;
+  uint64_t *bits;
+};
+
+rf_collision_mask *
+mrb_collision_mask_new(mrb_state *mrb, rf_image *image, int threshold);
+
+void
+mrb_collision_mask_free(mrb_state *mrb, rf_collision_mask *mask);
+
+/* Up to 64 bits of a row starting at x, anything outside the mask reads as
+   empty. With flip the bits come from right to left, starting at x. */
+uint64_t
+mrb_collision_mask_row(rf_collision_mask *mask, int x, int y, int count, mrb_bool flip);
+
+static inline mrb_bool
+mrb_collision_mask_get(rf_collision_mask *mask, int x, int y)
+{
+  if (x < 0 || y < 0 || x >= mask->width || y >= mask->height) return FALSE;
+  return (mask->bits[(size_t)y * (size_t)mask->stride + (size_t)(x >> 6)] >> (x & 63)) & 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
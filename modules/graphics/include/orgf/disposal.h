@@ -0,0 +1,74 @@
+#ifndef ORGF_DISPOSAL_H
+#define ORGF_DISPOSAL_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_DISPOSAL_BUDGET 1000000
+
+typedef struct rf_disposal rf_disposal;
+typedef struct rf_disposal_queue rf_disposal_queue;
+
+enum rf_disposal_type
+{
+  RF_DISPOSE_TEXTURE,
+  RF_DISPOSE_RENDER_TEXTURE,
+};
+
+struct rf_disposal
+{
+  enum rf_disposal_type  type;
+  rf_texture2d           texture;
+  rf_render_texture2d    target;
+  size_t                 bytes;
+};
+
+/* GPU resources released by finalizers wait here, the GC can run at any
+   point of a frame and the GL calls only happen at the end of one. Each
+   frame unloads them oldest first until the budget in nanoseconds runs
+   out, always at least one. While Graphics isn't running the context is
+   gone and so are the resources, anything queued then is dropped. */
+struct rf_disposal_queue
+{
+  rf_disposal  *entries;
+  mrb_int       head;
+  mrb_int       count;
+  mrb_int       capa;
+  uint64_t      budget;
+  mrb_bool      open;
+  mrb_int       queued;
+  mrb_int       released;
+  size_t        queued_bytes;
+  size_t        released_bytes;
+};
+
+rf_disposal_queue *
+mrb_get_disposal_queue(void);
+
+void
+mrb_dispose_texture(mrb_state *mrb, rf_texture2d texture, size_t bytes);
+
+void
+mrb_dispose_render_texture(mrb_state *mrb, rf_render_texture2d target, size_t bytes);
+
+/* Unloads queued resources within the budget, or all of them with all. */
+void
+mrb_disposal_drain(mrb_state *mrb, mrb_bool all);
+
+void
+mrb_disposal_open(void);
+
+/* Unloads everything left while the context still exists. */
+void
+mrb_disposal_close(mrb_state *mrb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,12 +16,18 @@ typedef struct rf_container rf_container;
 
 typedef void (*rf_drawable_update_callback)(mrb_state *mrb, rf_drawable *obj);
 typedef void (*rf_drawable_draw_callback)(mrb_state *mrb, rf_drawable *obj);
+/* Draws count neighbours sharing the callback at once, hidden ones included. */
+typedef void (*rf_drawable_run_callback)(mrb_state *mrb, rf_drawable **items, mrb_int count);
 
+/* Tick advances state every frame, update renders off-screen passes and is
+   left out of frames the pacer skips. */
 struct rf_drawable
 {
   struct rf_container          *container;
+  rf_drawable_update_callback   tick;
   rf_drawable_update_callback   update;
   rf_drawable_draw_callback     draw;
+  rf_drawable_run_callback      draw_run;
   mrb_int                       z;
   mrb_int                       id;
   mrb_bool                      visible;
@@ -48,6 +54,9 @@ mrb_container_add_child(mrb_state *mrb, rf_container *parent, rf_drawable *child
 void
 mrb_container_remove_child(mrb_state *mrb, rf_container *parent, rf_drawable *child);
 
+void
+mrb_container_tick(mrb_state *mrb, rf_container *parent);
+
 void
 mrb_container_update(mrb_state *mrb, rf_container *parent);
 
@@ -4,13 +4,66 @@
 #include <mruby.h>
 #include <mruby/data.h>
 #include <rayfork.h>
+#include <stdint.h>
+
+#include <orgf/glyphs.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define ORGF_SDF_BASE_SIZE 48
+#define ORGF_SDF_SPREAD 6
+#define ORGF_SDF_ATLAS_WIDTH 512
+#define ORGF_SDF_FIRST_CODEPOINT 32
+#define ORGF_SDF_CODEPOINTS 95
+
+typedef struct rf_font_face rf_font_face;
+typedef struct rf_text_font rf_text_font;
+typedef struct rf_font_stats rf_font_stats;
+
 extern const struct mrb_data_type mrb_font_data_type;
 
+/* A face rasterized once at ORGF_SDF_BASE_SIZE and turned into a distance
+   field, shared by every distance field Font of that file whatever its
+   size. Glyph recs point into field and carry ORGF_SDF_SPREAD pixels of
+   padding on each side, the offsets already account for it. */
+struct rf_font_face
+{
+  char          *path;
+  rf_font        font;
+  rf_image       field;
+  mrb_int        refs;
+  rf_font_face  *next;
+};
+
+/* A Font of a file is drawn either from its distance field face or from
+   the glyph cache through glyphs, font is only used by the default font. */
+struct rf_text_font
+{
+  rf_font           font;
+  rf_font_face     *face;
+  rf_glyph_source  *glyphs;
+  mrb_bool          antialias;
+  mrb_int           size;
+  rf_color         *color;
+  rf_color         *out_color;
+  mrb_bool          outline;
+  mrb_bool          shadow;
+};
+
+/* What building the distance field faces costs. */
+struct rf_font_stats
+{
+  mrb_int   faces;
+  size_t    face_bytes;
+  uint64_t  face_time;
+  mrb_int   face_hits;
+};
+
+rf_font_stats *
+mrb_get_font_stats(void);
+
 const char *
 mrb_get_default_font_name(mrb_state *mrb);
 
@@ -20,16 +73,44 @@ mrb_get_default_font_size(mrb_state *mrb);
 mrb_bool
 mrb_get_default_font_antialias(mrb_state *mrb);
 
+mrb_bool
+mrb_get_default_font_sdf(mrb_state *mrb);
+
+/* Fonts with glyphs on the CPU, the only ones text can be drawn with into
+   a bitmap. */
+static inline mrb_bool
+mrb_font_cpu_p(rf_text_font *font)
+{
+  return font->face || font->glyphs;
+}
+
+/* The advance of text in a font mrb_font_cpu_p accepts, 0 for any other. */
+float
+mrb_font_text_width(mrb_state *mrb, rf_text_font *font, const char *text, mrb_int length);
+
+/* Draws text into an RGBA image with the pen starting at x and the top of
+   the line at y, only inside clip. touched grows to hold every pixel
+   written, when given. */
+void
+mrb_font_draw_run(mrb_state *mrb, rf_text_font *font, rf_image *image, float x, float y, rf_rec clip,
+                  const char *text, mrb_int length, rf_rec *touched);
+
+/* Draws text into an RGBA image, aligned inside rect like Bitmap#draw_text.
+   Returns FALSE when the font or the image can't be drawn this way. */
+mrb_bool
+mrb_font_draw_text(mrb_state *mrb, rf_text_font *font, rf_image *image, rf_rec rect, const char *text, mrb_int length,
+                   int align, rf_rec *touched);
+
 static inline mrb_bool
 mrb_font_p(mrb_value obj)
 {
   return mrb_data_p(obj) && DATA_TYPE(obj) == &mrb_font_data_type;
 }
 
-static inline rf_font *
+static inline rf_text_font *
 mrb_get_font(mrb_state *mrb, mrb_value obj)
 {
-  rf_font *font;
+  rf_text_font *font;
   Data_Get_Struct(mrb, obj, &mrb_font_data_type, font);
   return font;
 }
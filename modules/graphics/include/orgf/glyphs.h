@@ -0,0 +1,137 @@
+#ifndef ORGF_GLYPHS_H
+#define ORGF_GLYPHS_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_GLYPH_PAGE_SIZE 512
+#define ORGF_GLYPH_PAGES 16
+#define ORGF_GLYPH_BUCKETS 4096
+#define ORGF_GLYPH_PADDING 1
+
+typedef struct rf_glyph_source rf_glyph_source;
+typedef struct rf_cached_glyph rf_cached_glyph;
+typedef struct rf_glyph_page rf_glyph_page;
+typedef struct rf_glyph_cache rf_glyph_cache;
+
+/* The TTF file of a Font, shared by every size of it. Glyphs are only
+   rasterized when some text needs them, so the size of the character set
+   doesn't matter. */
+struct rf_glyph_source
+{
+  char             *path;
+  unsigned char    *data;
+  size_t            data_size;
+  void             *info;
+  mrb_int           refs;
+  rf_glyph_source  *next;
+};
+
+/* Metrics of a glyph at one size, kept after its page is recycled so
+   measuring text never rasterizes. page is -1 while it has no coverage. */
+struct rf_cached_glyph
+{
+  rf_glyph_source  *source;
+  int               size;
+  int               codepoint;
+  int               page;
+  int               x;
+  int               y;
+  int               width;
+  int               height;
+  int               offset_x;
+  int               offset_y;
+  float             advance;
+  rf_cached_glyph  *next;
+};
+
+/* A fixed size page of glyph coverage, one byte per pixel, filled in
+   shelves from the top. */
+struct rf_glyph_page
+{
+  unsigned char  *pixels;
+  int             shelf_x;
+  int             shelf_y;
+  int             shelf_height;
+  mrb_int         glyphs;
+  mrb_int         last_used;
+};
+
+/* Every source shares the same pages. When none has room the least
+   recently used one is recycled, except pages the text being laid out
+   already uses. */
+struct rf_glyph_cache
+{
+  rf_cached_glyph  *buckets[ORGF_GLYPH_BUCKETS];
+  rf_glyph_page    *pages;
+  mrb_int           page_count;
+  mrb_int           page_limit;
+  mrb_int           batch;
+  mrb_int           glyphs;
+  mrb_int           sources;
+  size_t            source_bytes;
+  mrb_int           rasterizations;
+  mrb_int           recycled;
+  mrb_int           hits;
+  mrb_int           misses;
+};
+
+rf_glyph_cache *
+mrb_get_glyph_cache(void);
+
+/* Pages past the limit are recycled right away. */
+void
+mrb_glyph_cache_set_page_limit(mrb_state *mrb, mrb_int limit);
+
+/* Returns the source of a TTF file, loading it the first time. */
+rf_glyph_source *
+mrb_glyph_source_load(mrb_state *mrb, const char *path, const char **extensions);
+
+void
+mrb_glyph_source_release(mrb_state *mrb, rf_glyph_source *source);
+
+/* Fills glyphs with the glyph of every codepoint in text, returning how
+   many there are. glyphs needs room for length entries. With rasterize,
+   the glyphs missing coverage are rasterized together before returning. */
+mrb_int
+mrb_glyph_cache_layout(mrb_state *mrb, rf_glyph_source *source, int size, const char *text, mrb_int length,
+                       rf_cached_glyph **glyphs, mrb_bool rasterize);
+
+/* Rasterizes the coverage of a glyph laid out without rasterize into
+   pixels, a buffer of the glyph's size with rows stride bytes apart. The
+   glyph pages are left alone. */
+void
+mrb_glyph_rasterize_into(rf_cached_glyph *glyph, unsigned char *pixels, int stride);
+
+/* Decodes the UTF-8 codepoint at *index and moves past it, broken
+   sequences decode one byte at a time. */
+static inline int
+mrb_next_codepoint(const char *text, mrb_int length, mrb_int *index)
+{
+  const unsigned char *s = (const unsigned char *)text + *index;
+  mrb_int left = length - *index;
+  int extra = s[0] >= 0xF0 ? 3 : s[0] >= 0xE0 ? 2 : s[0] >= 0xC0 ? 1 : 0;
+  if (extra >= left) extra = 0;
+  int codepoint = extra ? s[0] & (0x3F >> extra) : s[0];
+  for (int i = 1; i <= extra; ++i) codepoint = (codepoint << 6) | (s[i] & 0x3F);
+  *index += extra + 1;
+  return codepoint;
+}
+
+static inline const unsigned char *
+mrb_cached_glyph_row(rf_cached_glyph *glyph, int y)
+{
+  rf_glyph_page *page = mrb_get_glyph_cache()->pages + glyph->page;
+  return page->pixels + (size_t)(glyph->y + y) * ORGF_GLYPH_PAGE_SIZE + glyph->x;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,6 +6,12 @@
 #include <time.h>
 
 #include <orgf/drawable.h>
+#include <orgf/capture.h>
+#include <orgf/pacer.h>
+#include <orgf/resolution.h>
+#include <orgf/stats.h>
+#include <orgf/batch.h>
+#include <orgf/targets.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,7 +25,17 @@ typedef GLFWwindow * rf_window_ref;
 typedef void * rf_window_ref;
 #endif
 
+#define ORGF_TRANSITION_CACHE_SIZE 4
+
 typedef struct rf_graphics_config rf_graphics_config;
+typedef struct rf_transition_entry rf_transition_entry;
+
+struct rf_transition_entry
+{
+  char         *name;
+  rf_texture2d  texture;
+  mrb_int       last_used;
+};
 
 struct rf_graphics_config
 {
@@ -30,16 +46,27 @@ struct rf_graphics_config
   mrb_int                    brightness;
   rf_context                 context;
   rf_render_batch            render_batch;
+  rf_batch_config            batch;
+  rf_batch_stats             batch_stats;
   rf_default_font            default_font;
   mrb_bool                   is_open;
   rf_window_ref              window;
   mrb_value                  title;
   rf_gfx_backend_data       *data;
   mrb_bool                   is_frozen;
-  rf_texture2d               frozen_img;
+  rf_render_target           frozen_render;
   rf_render_texture2d        render_texture;
   rf_container               container;
   mrb_float                  dt;
+  rf_frame_pacer             pacer;
+  rf_resolution              resolution;
+  mrb_bool                   draw_skipped;
+  mrb_bool                   stats_enabled;
+  rf_graphics_stats          stats;
+  rf_transition_entry        transitions[ORGF_TRANSITION_CACHE_SIZE];
+  mrb_int                    transition_clock;
+  rf_capture                *capture;
+  rf_capture_stats           capture_stats;
 };
 
 rf_container *
@@ -51,6 +78,13 @@ mrb_get_dt(mrb_state *mrb);
 rf_sizef
 mrb_get_graphics_size(mrb_state *mrb);
 
+rf_resolution *
+mrb_get_graphics_resolution(mrb_state *mrb);
+
+/* Whether the game screen, and with it the GL context, exists. */
+mrb_bool
+mrb_graphics_is_open(mrb_state *mrb);
+
 #ifdef __cplusplus
 }
 #endif
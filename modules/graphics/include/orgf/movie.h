@@ -0,0 +1,92 @@
+#ifndef ORGF_MOVIE_H
+#define ORGF_MOVIE_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#include <orgf/file.h>
+#include <orgf/thread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_MOVIE_CHUNKS 8
+#define ORGF_MOVIE_CHUNK_SIZE (64 * 1024)
+#define ORGF_MOVIE_FRAMES 4
+
+extern const char *MRB_MOVIE_EXTENSIONS[];
+
+typedef struct rf_movie rf_movie;
+typedef struct rf_movie_chunk rf_movie_chunk;
+typedef struct rf_movie_plane rf_movie_plane;
+typedef struct rf_movie_frame rf_movie_frame;
+
+struct rf_movie_chunk
+{
+  orgf_atomic    state;
+  size_t         size;
+  unsigned char  data[ORGF_MOVIE_CHUNK_SIZE];
+};
+
+struct rf_movie_plane
+{
+  int            width;
+  int            height;
+  unsigned char *data;
+};
+
+struct rf_movie_frame
+{
+  orgf_atomic     state;
+  double          time;
+  int             width;
+  int             height;
+  rf_movie_plane  planes[3];
+};
+
+/* The file is read on the main thread and handed to the decoder in chunks,
+   decoded frames come back through a small ring. Both rings have a single
+   producer and a single consumer. */
+struct rf_movie
+{
+  mrb_file        *file;
+  rf_movie_chunk   chunks[ORGF_MOVIE_CHUNKS];
+  long             chunk_head;
+  long             chunk_tail;
+  orgf_atomic      end_of_file;
+  rf_movie_frame   frames[ORGF_MOVIE_FRAMES];
+  long             frame_head;
+  long             frame_tail;
+  orgf_atomic      running;
+  orgf_atomic      decoded_all;
+  orgf_thread      decoder;
+  double           clock;
+  mrb_bool         started;
+  rf_texture2d     textures[3];
+  int              width;
+  int              height;
+  mrb_int          presented;
+  mrb_int          dropped;
+};
+
+rf_movie *
+mrb_movie_open(mrb_state *mrb, const char *name);
+
+void
+mrb_movie_update(mrb_state *mrb, rf_movie *movie, mrb_float dt, mrb_bool upload);
+
+void
+mrb_movie_draw(rf_movie *movie, float width, float height);
+
+mrb_bool
+mrb_movie_finished(rf_movie *movie);
+
+void
+mrb_movie_close(mrb_state *mrb, rf_movie *movie);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
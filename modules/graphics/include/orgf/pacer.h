@@ -0,0 +1,66 @@
+#ifndef ORGF_PACER_H
+#define ORGF_PACER_H 1
+
+#include <mruby.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_PACER_SAMPLES 256
+#define ORGF_PACER_SPIN_NS 1000000ull
+
+typedef struct rf_frame_pacer rf_frame_pacer;
+
+enum rf_vsync_mode
+{
+  RF_VSYNC_OFF,
+  RF_VSYNC_ON,
+  RF_VSYNC_ADAPTIVE,
+};
+
+/* Frame times are kept in a ring, in nanoseconds. The sleep overshoot is
+   measured as the pacer runs, so coarse system timers only cost a longer
+   spin instead of a missed deadline. */
+struct rf_frame_pacer
+{
+  enum rf_vsync_mode  vsync;
+  mrb_bool            frame_skip;
+  mrb_int             max_skip;
+  mrb_int             skipped_in_row;
+  mrb_int             skipped;
+  uint64_t            last_frame;
+  uint64_t            deadline;
+  uint64_t            sleep_overshoot;
+  uint64_t            samples[ORGF_PACER_SAMPLES];
+  mrb_int             sample_count;
+  mrb_int             sample_index;
+};
+
+void
+mrb_pacer_init(rf_frame_pacer *pacer);
+
+void
+mrb_pacer_reset(rf_frame_pacer *pacer);
+
+void
+mrb_pacer_wait(rf_frame_pacer *pacer, mrb_int frame_rate);
+
+mrb_float
+mrb_pacer_tick(rf_frame_pacer *pacer, mrb_int frame_rate);
+
+mrb_bool
+mrb_pacer_should_skip(rf_frame_pacer *pacer);
+
+mrb_float
+mrb_pacer_percentile(rf_frame_pacer *pacer, mrb_float percentile);
+
+mrb_float
+mrb_pacer_average(rf_frame_pacer *pacer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef ORGF_PARTICLES_H
+#define ORGF_PARTICLES_H 1
+
+#include <mruby.h>
+#include <mruby/data.h>
+#include <rayfork.h>
+
+#include <orgf/bitmap.h>
+#include <orgf/drawable.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const struct mrb_data_type mrb_particle_emitter_data_type;
+
+typedef struct rf_particles rf_particles;
+typedef struct rf_particle_emitter rf_particle_emitter;
+
+/* Particle state is kept as parallel arrays so every field is updated
+   by its own tight loop. */
+struct rf_particles
+{
+  float    *x;
+  float    *y;
+  float    *vx;
+  float    *vy;
+  float    *life;
+  float    *inv_life;
+  float    *scale;
+  float    *rotation;
+  float    *spin;
+  rf_color *color;
+  mrb_int   size;
+  mrb_int   capa;
+};
+
+struct rf_particle_emitter
+{
+  rf_drawable   base;
+  rf_particles  particles;
+  /* The Bitmap object itself, also kept in an ivar so it stays alive;
+     a disposed bitmap is skipped when drawing. */
+  mrb_value     bitmap;
+  rf_rec       *src_rect;
+  rf_vec2      *position;
+  rf_vec2      *area;
+  rf_vec2      *gravity;
+  rf_color     *start_color;
+  rf_color     *end_color;
+  float         rate;
+  float         pending;
+  float         life_min, life_max;
+  float         speed_min, speed_max;
+  float         angle, spread;
+  float         start_scale, end_scale;
+  float         spin;
+  uint32_t      seed;
+  rf_blend_mode blend_mode;
+  mrb_bool      emitting;
+};
+
+static inline rf_particle_emitter *
+mrb_get_particle_emitter(mrb_state *mrb, mrb_value obj)
+{
+  rf_particle_emitter *emitter;
+  Data_Get_Struct(mrb, obj, &mrb_particle_emitter_data_type, emitter);
+  if (!emitter) mrb_raise(mrb, E_DISPOSED_ERROR, "Disposed ParticleEmitter");
+  return emitter;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
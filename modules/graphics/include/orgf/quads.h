@@ -0,0 +1,87 @@
+#ifndef ORGF_QUADS_H
+#define ORGF_QUADS_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_QUADS_PARALLEL_MIN 4096
+#define ORGF_QUADS_CHUNK 1024
+#define ORGF_QUADS_MAX_THREADS 8
+#define ORGF_QUADS_SPIN_NS 2000000
+#define ORGF_QUADS_PAUSE_SPINS 64
+
+typedef struct rf_sprite_quads rf_sprite_quads;
+
+/* The transform of many sprites, gathered in contiguous arrays so the
+   corners of four sprites are computed at once. Each quad spans left to
+   right and top to bottom around its anchor at x, y, rotated by cos and sin.
+   Texture coordinates come in pixels, already swapped for flips, and are
+   divided by the texture size. */
+struct rf_sprite_quads
+{
+  mrb_int         count;
+  mrb_int         capa;
+  float          *x;
+  float          *y;
+  float          *left;
+  float          *top;
+  float          *right;
+  float          *bottom;
+  float          *cos;
+  float          *sin;
+  float          *src_u0;
+  float          *src_v0;
+  float          *src_u1;
+  float          *src_v1;
+  float          *inv_width;
+  float          *inv_height;
+  // Corner k of quad i is at [k * capa + i], in the order the sprites draw them
+  float          *vx;
+  float          *vy;
+  float          *u0;
+  float          *v0;
+  float          *u1;
+  float          *v1;
+  // Draw state for each quad, the kernels don't touch it
+  rf_color       *color;
+  unsigned int   *texture;
+  rf_blend_mode  *blend;
+};
+
+/* Room for count quads, whatever the quads held before is lost. */
+void
+mrb_sprite_quads_reserve(mrb_state *mrb, rf_sprite_quads *quads, mrb_int count);
+
+void
+mrb_sprite_quads_free(mrb_state *mrb, rf_sprite_quads *quads);
+
+/* Computes the corners and texture coordinates of every quad. Past
+   ORGF_QUADS_PARALLEL_MIN quads the work is split in chunks shared with the
+   worker threads, the caller computes chunks too. */
+void
+mrb_sprite_quads_compute(rf_sprite_quads *quads);
+
+/* Threads used for the corners, counting the one drawing. */
+mrb_int
+mrb_get_quad_threads(void);
+
+void
+mrb_set_quad_threads(mrb_int threads);
+
+/* Stops the worker threads, they start again when needed. */
+void
+mrb_quad_workers_stop(void);
+
+/* Sprites per millisecond of count random quads with the given threads. */
+double
+mrb_sprite_quads_benchmark(mrb_state *mrb, mrb_int count, mrb_int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ORGF_READBACK_H
+#define ORGF_READBACK_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(ORGF_PLATFORM_GLFW) && defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+#define ORGF_ASYNC_READBACK 1
+#endif
+
+typedef struct rf_readback rf_readback;
+
+/* Reads the pixels of a render texture back into memory.
+   With ORGF_ASYNC_READBACK the copy goes into a pixel buffer guarded by a fence,
+   otherwise the pixels are read synchronously when the readback is finished. */
+struct rf_readback
+{
+  rf_render_texture2d  target;
+  unsigned int         buffer;
+  size_t               buffer_size;
+  void                *fence;
+  mrb_bool             pending;
+};
+
+void
+mrb_readback_init(rf_readback *readback);
+
+void
+mrb_readback_start(rf_readback *readback, rf_render_texture2d target);
+
+mrb_bool
+mrb_readback_ready(rf_readback *readback);
+
+/* Passing NULL pixels completes the readback without copying anything. */
+void
+mrb_readback_finish(rf_readback *readback, void *pixels);
+
+/* Reads a texture that is not a render target synchronously, the pixels
+   come back as RGBA in the same row order they were uploaded. */
+void
+mrb_readback_texture(rf_texture2d texture, void *pixels);
+
+void
+mrb_readback_release_target(rf_readback *readback);
+
+/* The same from a finalizer, through the disposal queue. */
+void
+mrb_readback_dispose_target(mrb_state *mrb, rf_readback *readback);
+
+void
+mrb_readback_free(rf_readback *readback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
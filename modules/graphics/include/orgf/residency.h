@@ -0,0 +1,71 @@
+#ifndef ORGF_RESIDENCY_H
+#define ORGF_RESIDENCY_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rf_bitmap;
+
+typedef struct rf_residency rf_residency;
+
+/* Bitmaps are kept in a list ordered by the last frame they were drawn,
+   the most recent first. Only textures not drawn in the current frame are
+   evicted, so a texture is never lost between its refresh and its draw. */
+struct rf_residency
+{
+  struct rf_bitmap  *head;
+  struct rf_bitmap  *tail;
+  size_t             budget;
+  size_t             resident_bytes;
+  mrb_int            frame;
+  mrb_int            tracked;
+  mrb_int            resident;
+  mrb_int            pinned;
+  mrb_int            evictions;
+  mrb_int            reloads;
+  size_t             image_bytes;
+  size_t             released_bytes;
+  mrb_int            released;
+  mrb_int            recovered;
+  mrb_int            avoided_uploads;
+  mrb_int            reduced;
+};
+
+rf_residency *
+mrb_get_residency(void);
+
+void
+mrb_residency_track(struct rf_bitmap *bmp);
+
+void
+mrb_residency_untrack(mrb_state *mrb, struct rf_bitmap *bmp);
+
+void
+mrb_residency_touch(struct rf_bitmap *bmp);
+
+void
+mrb_residency_set_pinned(struct rf_bitmap *bmp, mrb_bool pinned);
+
+void
+mrb_residency_set_texture(struct rf_bitmap *bmp, rf_texture2d texture);
+
+/* Accounts the pixels a bitmap keeps on the CPU and the ones it gave up
+   because the texture and the source file are enough to get them back. */
+void
+mrb_residency_set_image(struct rf_bitmap *bmp, size_t held, size_t released);
+
+mrb_bool
+mrb_residency_evictable(struct rf_bitmap *bmp);
+
+void
+mrb_residency_end_frame(mrb_state *mrb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
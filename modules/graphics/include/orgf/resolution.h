@@ -0,0 +1,68 @@
+#ifndef ORGF_RESOLUTION_H
+#define ORGF_RESOLUTION_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_RESOLUTION_STEP 0.125f
+#define ORGF_RESOLUTION_MIN_SCALE 0.5f
+#define ORGF_RESOLUTION_WINDOW 30
+#define ORGF_RESOLUTION_PATIENCE 2
+#define ORGF_RESOLUTION_MAX_PATIENCE 32
+
+typedef struct rf_resolution rf_resolution;
+
+/* Dynamic resolution draws the screen into a smaller part of its render
+   texture and stretches it back when presenting, coordinates seen by the
+   game don't change. Frame times are looked at in windows of
+   ORGF_RESOLUTION_WINDOW frames: when over a quarter of a window missed
+   the frame rate the scale goes down a step, after patience windows
+   without a single late frame it tries a step up. A step up that is late
+   right away doubles the patience, so a scene right at the limit doesn't
+   bounce between two scales. */
+struct rf_resolution
+{
+  mrb_bool                enabled;
+  float                   scale;
+  float                   min_scale;
+  rf_texture_filter_mode  filter;
+  mrb_int                 frames;
+  mrb_int                 late;
+  mrb_int                 calm;
+  mrb_int                 patience;
+  mrb_bool                probing;
+  mrb_int                 downscales;
+  mrb_int                 upscales;
+};
+
+void
+mrb_resolution_init(rf_resolution *resolution);
+
+/* Counts a frame that took elapsed nanoseconds out of period, TRUE when
+   the scale changed. */
+mrb_bool
+mrb_resolution_frame(rf_resolution *resolution, uint64_t elapsed, uint64_t period);
+
+/* Sets the scale by hand, clamped to min_scale and 1, and starts measuring again. */
+void
+mrb_resolution_set_scale(rf_resolution *resolution, float scale);
+
+/* The corner of a width x height target drawn at the current scale. */
+void
+mrb_resolution_region(rf_resolution *resolution, int width, int height, int *region_width, int *region_height);
+
+/* Limits drawing to that corner of the bound width x height target, the
+   projection stays the same so everything drawn shrinks to fit. */
+void
+mrb_resolution_begin(rf_resolution *resolution, int width, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
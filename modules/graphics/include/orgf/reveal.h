@@ -0,0 +1,76 @@
+#ifndef ORGF_REVEAL_H
+#define ORGF_REVEAL_H 1
+
+#include <mruby.h>
+#include <mruby/data.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const struct mrb_data_type mrb_text_reveal_data_type;
+
+typedef struct rf_reveal_glyph rf_reveal_glyph;
+typedef struct rf_reveal_event rf_reveal_event;
+typedef struct rf_text_reveal rf_text_reveal;
+
+enum rf_reveal_event_type
+{
+  RF_REVEAL_SPEED,
+  RF_REVEAL_WAIT,
+  RF_REVEAL_PAUSE,
+};
+
+/* Where a glyph lives in the text with the control codes removed, and the
+   pen position it is drawn from. */
+struct rf_reveal_glyph
+{
+  mrb_int  offset;
+  mrb_int  length;
+  float    x;
+  float    y;
+  mrb_int  line;
+};
+
+/* A control code, run right before the glyph at index is revealed. */
+struct rf_reveal_event
+{
+  enum rf_reveal_event_type  type;
+  mrb_int                    index;
+  float                      value;
+};
+
+/* Text laid out once, then revealed a few glyphs per update. Only the
+   glyphs revealed in an update are drawn, and only their pixels are
+   uploaded again. */
+struct rf_text_reveal
+{
+  char             *text;
+  mrb_int           text_length;
+  rf_reveal_glyph  *glyphs;
+  mrb_int           count;
+  rf_reveal_event  *events;
+  mrb_int           event_count;
+  mrb_int           next_event;
+  mrb_int           revealed;
+  rf_rec            rect;
+  float             speed;
+  float             budget;
+  mrb_int           wait;
+  mrb_bool          paused;
+};
+
+static inline rf_text_reveal *
+mrb_get_text_reveal(mrb_state *mrb, mrb_value obj)
+{
+  rf_text_reveal *reveal;
+  Data_Get_Struct(mrb, obj, &mrb_text_reveal_data_type, reveal);
+  return reveal;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ORGF_SDF_H
+#define ORGF_SDF_H 1
+
+#include <mruby.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Turns coverage (a pixel is inside from 128 up) into a distance field of
+   the same size. The edge maps to 128, spread pixels inside to 255 and
+   spread pixels outside to 0. */
+void
+mrb_sdf_generate(mrb_state *mrb, const unsigned char *coverage, int width, int height, int spread, unsigned char *field);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -49,6 +49,11 @@ mrb_get_sprite(mrb_state *mrb, mrb_value obj)
   return sprite;
 }
 
+/* Pixel perfect test between two sprites, using each bitmap's collision
+   mask. Rotation is not taken into account. */
+mrb_bool
+mrb_sprite_collide(mrb_state *mrb, rf_sprite *a, rf_sprite *b);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,97 @@
+#ifndef ORGF_STATS_H
+#define ORGF_STATS_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+#include <stdint.h>
+
+#include <orgf/thread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_STATS_FRAMES 120
+
+typedef struct rf_frame_stats rf_frame_stats;
+typedef struct rf_graphics_stats rf_graphics_stats;
+
+enum rf_flush_reason
+{
+  RF_FLUSH_NONE = -1,
+  RF_FLUSH_BUFFER,
+  RF_FLUSH_SHADER,
+  RF_FLUSH_BLEND,
+  RF_FLUSH_TARGET,
+  RF_FLUSH_FRAME,
+  RF_FLUSH_SCISSOR,
+  RF_FLUSH_REASONS
+};
+
+struct rf_frame_stats
+{
+  mrb_int   draw_calls;
+  mrb_int   flushes[RF_FLUSH_REASONS];
+  mrb_int   vertices;
+  mrb_int   texture_binds;
+  mrb_int   shader_switches;
+  mrb_int   target_switches;
+  mrb_int   visited;
+  mrb_int   culled;
+  mrb_int   direct_viewports;
+  mrb_int   uploads;
+  mrb_int   glyph_rasterizations;
+  uint64_t  upload_time;
+  uint64_t  update_time;
+  uint64_t  draw_time;
+  uint64_t  present_time;
+};
+
+/* GPU work is counted by wrapping rayfork's GL procs, so it sees every
+   call the batch makes. The engine only tells why a flush happens, the
+   draw that follows is the one that gets the reason. A reason only lasts
+   until the state change it announced is done, ORGF_STATS_SETTLE drops it
+   when that change drew nothing, so it doesn't stick to a later flush. */
+struct rf_graphics_stats
+{
+  rf_frame_stats        current;
+  rf_frame_stats        frames[ORGF_STATS_FRAMES];
+  mrb_int               count;
+  mrb_int               index;
+  enum rf_flush_reason  pending_reason;
+  mrb_bool              flush_open;
+  unsigned int          texture;
+  unsigned int          program;
+};
+
+extern rf_graphics_stats *mrb_active_stats;
+
+#ifdef ORGF_NO_GRAPHICS_STATS
+#define ORGF_STATS_NOW() ((uint64_t)0)
+#define ORGF_STATS_ADD(field, amount) ((void)0)
+#define ORGF_STATS_FLUSH(reason) ((void)0)
+#define ORGF_STATS_SETTLE() ((void)0)
+#else
+#define ORGF_STATS_NOW() (mrb_active_stats ? orgf_time_ns() : 0)
+#define ORGF_STATS_ADD(field, amount) do { if (mrb_active_stats) mrb_active_stats->current.field += (amount); } while (0)
+#define ORGF_STATS_FLUSH(reason) do { if (mrb_active_stats) mrb_active_stats->pending_reason = (reason); } while (0)
+#define ORGF_STATS_SETTLE() do { if (mrb_active_stats) mrb_active_stats->pending_reason = RF_FLUSH_NONE; } while (0)
+#endif
+
+void
+mrb_stats_enable(rf_graphics_stats *stats);
+
+void
+mrb_stats_disable(void);
+
+void
+mrb_stats_commit(rf_graphics_stats *stats);
+
+mrb_value
+mrb_stats_to_hash(mrb_state *mrb, rf_graphics_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
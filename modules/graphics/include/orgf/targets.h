@@ -0,0 +1,82 @@
+#ifndef ORGF_TARGETS_H
+#define ORGF_TARGETS_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_TARGET_BUCKET 32
+#define ORGF_TARGET_KEEP_FRAMES 300
+
+typedef struct rf_render_target rf_render_target;
+typedef struct rf_render_target_entry rf_render_target_entry;
+typedef struct rf_render_target_pool rf_render_target_pool;
+
+/* A render texture borrowed from the pool. It can be larger than what was
+   asked for, only the top left width x height corner is drawn into. */
+struct rf_render_target
+{
+  rf_render_texture2d  target;
+  int                  width;
+  int                  height;
+};
+
+struct rf_render_target_entry
+{
+  rf_render_texture2d  target;
+  int                  format;
+  mrb_bool             in_use;
+  mrb_int              last_used;
+};
+
+/* Targets are allocated in buckets of ORGF_TARGET_BUCKET pixels, and a free
+   target up to one bucket larger than needed is reused, so a size that
+   shrinks and grows a little keeps the same framebuffer. Free targets not
+   used for ORGF_TARGET_KEEP_FRAMES frames are unloaded. */
+struct rf_render_target_pool
+{
+  rf_render_target_entry  *entries;
+  mrb_int                  count;
+  mrb_int                  capa;
+  mrb_int                  frame;
+  mrb_int                  in_use;
+  size_t                   bytes;
+  mrb_int                  hits;
+  mrb_int                  allocations;
+  mrb_int                  trims;
+};
+
+rf_render_target_pool *
+mrb_get_render_target_pool(void);
+
+/* With exact the target has the requested size, for code that draws the
+   whole texture. Returns FALSE for an empty size. */
+mrb_bool
+mrb_render_target_acquire(mrb_state *mrb, rf_render_target *target, int width, int height, mrb_bool exact);
+
+void
+mrb_render_target_release(rf_render_target *target);
+
+void
+mrb_render_target_end_frame(mrb_state *mrb);
+
+void
+mrb_render_target_pool_clear(mrb_state *mrb);
+
+/* The texture coordinates of the used corner, rows are upside down in a
+   render texture so the top of the region is at v = 1. */
+static inline void
+mrb_render_target_uv(rf_render_target *target, float *u, float *v)
+{
+  *u = (float)target->width / (float)target->target.texture.width;
+  *v = 1.0f - (float)target->height / (float)target->target.texture.height;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
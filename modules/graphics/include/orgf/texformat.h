@@ -0,0 +1,88 @@
+#ifndef ORGF_TEXFORMAT_H
+#define ORGF_TEXFORMAT_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rf_texture_rule rf_texture_rule;
+typedef struct rf_texture_policy rf_texture_policy;
+
+/* The format a bitmap's texture is uploaded in. Default defers to the
+   directory rules and then to the global format, auto picks the smallest
+   format that keeps the image's alpha. */
+enum rf_texture_format
+{
+  RF_TEXTURE_DEFAULT,
+  RF_TEXTURE_AUTO,
+  RF_TEXTURE_RGBA8888,
+  RF_TEXTURE_RGB565,
+  RF_TEXTURE_RGBA5551,
+  RF_TEXTURE_RGBA4444,
+};
+
+struct rf_texture_rule
+{
+  char                   *directory;
+  enum rf_texture_format  format;
+};
+
+struct rf_texture_policy
+{
+  enum rf_texture_format  format;
+  mrb_bool                dither;
+  rf_texture_rule        *rules;
+  mrb_int                 rule_count;
+  mrb_int                 rule_capa;
+};
+
+static inline int
+mrb_pixel_bytes(int format)
+{
+  switch (format)
+  {
+    case RF_UNCOMPRESSED_GRAYSCALE: return 1;
+    case RF_UNCOMPRESSED_GRAY_ALPHA: return 2;
+    case RF_UNCOMPRESSED_R5G6B5: return 2;
+    case RF_UNCOMPRESSED_R5G5B5A1: return 2;
+    case RF_UNCOMPRESSED_R4G4B4A4: return 2;
+    case RF_UNCOMPRESSED_R8G8B8: return 3;
+    default: return 4;
+  }
+}
+
+rf_texture_policy *
+mrb_get_texture_policy(void);
+
+void
+mrb_texture_policy_set(mrb_state *mrb, const char *directory, enum rf_texture_format format);
+
+void
+mrb_texture_policy_free(mrb_state *mrb);
+
+/* Never returns default or auto, only a format the image can be uploaded in. */
+enum rf_texture_format
+mrb_texture_policy_resolve(enum rf_texture_format format, const char *source, rf_image image);
+
+enum rf_texture_format
+mrb_texture_detect(rf_image image);
+
+/* Converts the image into a new one allocated with mrb_malloc, the caller
+   frees its data with mrb_free. */
+rf_image
+mrb_texture_convert(mrb_state *mrb, rf_image image, enum rf_texture_format format);
+
+enum rf_texture_format
+mrb_get_texture_format(mrb_state *mrb, mrb_value value);
+
+mrb_value
+mrb_texture_format_value(mrb_state *mrb, enum rf_texture_format format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef ORGF_TILES_H
+#define ORGF_TILES_H 1
+
+#include <mruby.h>
+#include <rayfork.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORGF_TILE_SIZE 512
+#define ORGF_TILE_GUTTER 1
+#define ORGF_TILE_KEEP_FRAMES 120
+#define ORGF_TILE_BUDGET (64 * 1024 * 1024)
+
+typedef struct rf_texture_tile rf_texture_tile;
+typedef struct rf_tiled_texture rf_tiled_texture;
+typedef struct rf_tile_cache rf_tile_cache;
+
+struct rf_texture_tile
+{
+  rf_texture2d texture;
+  mrb_int      last_used;
+};
+
+/* An image too big for one texture, split in a grid of tiles that are
+   uploaded the first time a draw samples them. Each tile texture repeats
+   ORGF_TILE_GUTTER pixels of its neighbours around it, so filtering is
+   seamless across tiles, and tile_size counts only the pixels inside.
+   Tiles are uploaded from the bitmap's decoded image, which stays in RAM
+   for as long as the bitmap lives: width * height * 4 bytes, on top of
+   the resident tiles the budget accounts for. */
+struct rf_tiled_texture
+{
+  int               tile_size;
+  int               columns;
+  int               rows;
+  rf_texture_tile  *tiles;
+  rf_tiled_texture *prev;
+  rf_tiled_texture *next;
+};
+
+/* Every tiled texture shares one budget. Tiles not drawn for
+   ORGF_TILE_KEEP_FRAMES frames are unloaded, and going over the budget
+   unloads the least recently drawn ones, except those of the current frame. */
+struct rf_tile_cache
+{
+  rf_tiled_texture *head;
+  size_t            budget;
+  size_t            bytes;
+  int               max_size;
+  int               gl_max_size;
+  mrb_int           frame;
+  mrb_int           textures;
+  mrb_int           resident;
+  mrb_int           uploads;
+  mrb_int           evictions;
+};
+
+rf_tile_cache *
+mrb_get_tile_cache(void);
+
+/* The largest texture side used before an image is split in tiles. */
+int
+mrb_get_max_texture_size(void);
+
+static inline mrb_bool
+mrb_texture_needs_tiles(int width, int height)
+{
+  int max_size = mrb_get_max_texture_size();
+  return width > max_size || height > max_size;
+}
+
+rf_tiled_texture *
+mrb_tiled_texture_new(mrb_state *mrb, int width, int height);
+
+void
+mrb_tiled_texture_free(mrb_state *mrb, rf_tiled_texture *tiles);
+
+/* Unloads every tile, so they are uploaded again from the changed pixels. */
+void
+mrb_tiled_texture_invalidate(rf_tiled_texture *tiles);
+
+/* Draws the src region of the image as quads filling dst, in the current
+   matrix. Only tiles with a quad inside clip are uploaded and drawn, a NULL
+   clip draws every tile src touches. */
+void
+mrb_tiled_texture_draw(mrb_state *mrb, rf_tiled_texture *tiles, rf_image *image, rf_rec src, rf_rec dst,
+                       mrb_bool flip_x, mrb_bool flip_y, const rf_rec *clip, rf_color color);
+
+void
+mrb_tiled_texture_end_frame(mrb_state *mrb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
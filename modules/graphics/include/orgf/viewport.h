@@ -6,6 +6,7 @@
 #include <rayfork.h>
 
 #include <orgf/drawable.h>
+#include <orgf/targets.h>
 #include <orgf/tone.h>
 
 #ifdef __cplusplus
@@ -25,7 +26,8 @@ struct rf_viewport
   rf_tone             *tone;
   rf_rec              *rect;
   rf_vec2             *offset;
-  rf_render_texture2d  render;
+  rf_render_target     render;
+  mrb_bool             direct;
   mrb_float            total_flash_time;
   mrb_float            flash_time;
 };
@@ -7,6 +7,7 @@
 
 #include <orgf/drawable.h>
 #include <orgf/bitmap.h>
+#include <orgf/targets.h>
 #include <orgf/tone.h>
 
 #ifdef __cplusplus
@@ -54,7 +55,7 @@ struct rf_window
     }      borders;
     int border_left, border_top;
   }                   skin_rects;
-  rf_render_texture2d render;
+  rf_render_target    render;
   rf_vec2            *offset;
   rf_rec             *rect;
   rf_rec             *cursor_rect;
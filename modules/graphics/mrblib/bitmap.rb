@@ -0,0 +1,5 @@
+class Bitmap
+  def reveal_text(*args)
+    TextReveal.new(self, *args)
+  end
+end
@@ -1,9 +1,26 @@
 class Font
   class << self
-    attr_accessor :default_name, :default_size, :default_antialias
+    attr_accessor :default_name, :default_size, :default_antialias, :default_sdf
+  end
+
+  def color=(value)
+    if value.is_a?(Array)
+      color.set(*value)
+    else
+      color.set(value)
+    end
+  end
+
+  def out_color=(value)
+    if value.is_a?(Array)
+      out_color.set(*value)
+    else
+      out_color.set(value)
+    end
   end
 end
 
 Font.default_name = nil
 Font.default_size = 16
 Font.default_antialias = false
+Font.default_sdf = false
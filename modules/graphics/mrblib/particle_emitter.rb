@@ -0,0 +1,83 @@
+class ParticleEmitter
+  delegate :x, :x=, :y, :y=, to: :position
+
+  def position=(value)
+    if value.is_a?(Array)
+      position.set(*value)
+    else
+      position.set(value)
+    end
+  end
+
+  def area=(value)
+    if value.is_a?(Array)
+      area.set(*value)
+    else
+      area.set(value)
+    end
+  end
+
+  def gravity=(value)
+    if value.is_a?(Array)
+      gravity.set(*value)
+    else
+      gravity.set(value)
+    end
+  end
+
+  def src_rect=(value)
+    if value.is_a?(Array)
+      src_rect.set(*value)
+    else
+      src_rect.set(value)
+    end
+  end
+
+  def start_color=(value)
+    if value.is_a?(Array)
+      start_color.set(*value)
+    else
+      start_color.set(value)
+    end
+  end
+
+  def end_color=(value)
+    if value.is_a?(Array)
+      end_color.set(*value)
+    else
+      end_color.set(value)
+    end
+  end
+
+  def life=(value)
+    if value.is_a?(Range)
+      set_life(value.first, value.last)
+    else
+      set_life(value)
+    end
+  end
+
+  def speed=(value)
+    if value.is_a?(Range)
+      set_speed(value.first, value.last)
+    else
+      set_speed(value)
+    end
+  end
+
+  def start
+    self.emitting = true
+  end
+
+  def stop
+    self.emitting = false
+  end
+
+  def show
+    self.visible = true
+  end
+
+  def hide
+    self.visible = false
+  end
+end
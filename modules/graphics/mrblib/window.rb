@@ -34,6 +34,10 @@ class Window
     rect.set(x, y, width, height)
   end
 
+  def reveal_text(*args)
+    contents.reveal_text(*args)
+  end
+
   def open?
     openess >= 255
   end
@@ -0,0 +1,127 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <string.h>
+
+#include <orgf/batch.h>
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_DYNAMIC_DRAW 0x88E8
+
+typedef struct
+{
+  unsigned int  id;
+  ptrdiff_t     size;
+} tracked_buffer;
+
+static struct
+{
+  void (*BindBuffer)(unsigned int target, unsigned int buffer);
+  void (*BufferData)(unsigned int target, ptrdiff_t size, const void *data, unsigned int usage);
+  void (*BufferSubData)(unsigned int target, ptrdiff_t offset, ptrdiff_t size, const void *data);
+} original;
+
+static rf_batch_config *active_config = NULL;
+static rf_batch_stats *active_stats = NULL;
+static unsigned int bound_buffer = 0;
+static tracked_buffer buffers[ORGF_BATCH_TRACKED_BUFFERS];
+static int buffer_count = 0;
+static mrb_bool creating = FALSE;
+
+static tracked_buffer *
+find_buffer(unsigned int id)
+{
+  for (int i = 0; i < buffer_count; ++i)
+  {
+    if (buffers[i].id == id) return &(buffers[i]);
+  }
+  return NULL;
+}
+
+static void
+batch_bind_buffer(unsigned int target, unsigned int buffer)
+{
+  if (target == GL_ARRAY_BUFFER) bound_buffer = buffer;
+  original.BindBuffer(target, buffer);
+}
+
+static void
+batch_buffer_data(unsigned int target, ptrdiff_t size, const void *data, unsigned int usage)
+{
+  // Array buffers made while the batch is created are its vertex buffers
+  if (creating && target == GL_ARRAY_BUFFER && !find_buffer(bound_buffer) && buffer_count < ORGF_BATCH_TRACKED_BUFFERS)
+  {
+    buffers[buffer_count].id = bound_buffer;
+    buffers[buffer_count].size = size;
+    buffer_count += 1;
+  }
+  original.BufferData(target, size, data, usage);
+}
+
+static void
+batch_buffer_sub_data(unsigned int target, ptrdiff_t offset, ptrdiff_t size, const void *data)
+{
+  tracked_buffer *buffer = target == GL_ARRAY_BUFFER && !offset ? find_buffer(bound_buffer) : NULL;
+  if (buffer)
+  {
+    // Positions take 3 floats for each of the 4 vertices of a quad
+    ptrdiff_t position_size = (ptrdiff_t)active_config->size * 4 * 3 * sizeof(float);
+    if (buffer->size == position_size)
+    {
+      ptrdiff_t slack = (ptrdiff_t)ORGF_BATCH_FULL_SLACK * 4 * 3 * sizeof(float);
+      active_stats->flushes += 1;
+      if (size > position_size - slack) active_stats->full_flushes += 1;
+    }
+    if (active_config->streaming == RF_BATCH_ORPHAN)
+    {
+      // Handing the driver a fresh store means it never waits on the GPU
+      // for the draw that still reads the old one.
+      original.BufferData(target, buffer->size, NULL, GL_DYNAMIC_DRAW);
+      active_stats->orphaned += 1;
+    }
+  }
+  original.BufferSubData(target, offset, size, data);
+}
+
+void
+mrb_batch_config_init(rf_batch_config *config)
+{
+  config->size = ORGF_BATCH_DEFAULT_SIZE;
+  config->buffers = ORGF_BATCH_DEFAULT_BUFFERS;
+  config->streaming = RF_BATCH_ROTATE;
+}
+
+rf_render_batch
+mrb_batch_create(rf_batch_config *config, rf_batch_stats *stats, rf_allocator allocator)
+{
+  original.BindBuffer = rf_gl.BindBuffer;
+  original.BufferData = rf_gl.BufferData;
+  original.BufferSubData = rf_gl.BufferSubData;
+  rf_gl.BindBuffer = batch_bind_buffer;
+  rf_gl.BufferData = batch_buffer_data;
+  rf_gl.BufferSubData = batch_buffer_sub_data;
+  active_config = config;
+  active_stats = stats;
+  buffer_count = 0;
+  memset(stats, 0, sizeof *stats);
+  // Each flush moves the batch to its next vertex buffer, so with several of
+  // them the upload never lands on a buffer the GPU is still drawing from.
+  creating = TRUE;
+  rf_render_batch batch = rf_create_custom_render_batch((int)config->buffers, ORGF_BATCH_DRAW_CALLS, (int)config->size, allocator);
+  creating = FALSE;
+  return batch;
+}
+
+void
+mrb_batch_unload(rf_render_batch batch, rf_allocator allocator)
+{
+  rf_unload_render_batch(batch, allocator);
+  rf_gl.BindBuffer = original.BindBuffer;
+  rf_gl.BufferData = original.BufferData;
+  rf_gl.BufferSubData = original.BufferSubData;
+  active_config = NULL;
+  active_stats = NULL;
+  buffer_count = 0;
+}
@@ -1,19 +1,44 @@
 #include <mruby.h>
 #include <mruby/class.h>
 #include <mruby/data.h>
+#include <mruby/string.h>
 #include <mruby/variable.h>
 
+#include <math.h>
 #include <rayfork.h>
+#include <string.h>
 
 #include <orgf/alloc.h>
 #include <orgf/color.h>
 #include <orgf/font.h>
 #include <orgf/bitmap.h>
+#include <orgf/blend.h>
 #include <orgf/file.h>
+#include <orgf/point.h>
 #include <orgf/rect.h>
+#include <orgf/stats.h>
+#include <orgf/texformat.h>
 
 #define FONT mrb_intern_lit(mrb, "#font")
 
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#ifndef GL_TEXTURE_2D
+#define GL_TEXTURE_2D 0x0DE1
+#endif
+
+#ifndef GL_RGBA
+#define GL_RGBA 0x1908
+#endif
+
+#ifndef GL_UNSIGNED_BYTE
+#define GL_UNSIGNED_BYTE 0x1401
+#endif
+
+#ifndef GL_UNPACK_ALIGNMENT
+#define GL_UNPACK_ALIGNMENT 0x0CF5
+#endif
+
 const char *MRB_IMAGE_EXTENSIONS[] = {
   "",
   ".png",
@@ -23,14 +48,37 @@ const char *MRB_IMAGE_EXTENSIONS[] = {
   NULL
 };
 
+/* Before textures were made on first draw, every bitmap was uploaded on
+   creation. That upload turned out unneeded when the pixels changed before
+   the first draw or the bitmap was never drawn, it is counted once. */
+static void
+count_avoided_upload(rf_bitmap *bmp)
+{
+  if (bmp->uploaded || bmp->upload_avoided) return;
+  // Tiled bitmaps never had a texture of their own to upload
+  if (mrb_texture_needs_tiles(bmp->image.width, bmp->image.height)) return;
+  bmp->upload_avoided = TRUE;
+  mrb_get_residency()->avoided_uploads += 1;
+}
+
 static void
 free_bitmap(mrb_state *mrb, void *ptr)
 {
   if (ptr)
   {
     rf_bitmap *bmp = ptr;
-    rf_unload_texture(bmp->texture);
+    if (bmp->readback)
+    {
+      mrb_readback_dispose_target(mrb, bmp->readback);
+      mrb_readback_free(bmp->readback);
+      mrb_free(mrb, bmp->readback);
+    }
+    count_avoided_upload(bmp);
+    mrb_residency_untrack(mrb, bmp);
+    mrb_collision_mask_free(mrb, bmp->collision);
+    mrb_tiled_texture_free(mrb, bmp->tiles);
     rf_unload_image(bmp->image, mrb_get_allocator(mrb));
+    if (bmp->source) mrb_free(mrb, bmp->source);
     mrb_free(mrb, bmp);
   }
 }
@@ -39,10 +87,267 @@ const struct mrb_data_type mrb_bitmap_data_type = {
   "Bitmap", free_bitmap
 };
 
+static inline size_t
+image_bytes(rf_image image)
+{
+  return (size_t)image.width * (size_t)image.height * (size_t)mrb_pixel_bytes(image.format);
+}
+
+static void
+account_image(rf_bitmap *bmp)
+{
+  if (bmp->image.data)
+  {
+    mrb_residency_set_image(bmp, image_bytes(bmp->image), 0);
+  }
+  else
+  {
+    mrb_residency_set_image(bmp, 0, bmp->read_only ? image_bytes(bmp->image) : 0);
+  }
+}
+
+/* Bitmaps loaded from a file keep only their size and format once the
+   texture exists, the pixels come back from the texture or the file. */
+static void
+release_image(mrb_state *mrb, rf_bitmap *bmp)
+{
+  if (!bmp->read_only || !bmp->texture.id || !bmp->image.data) return;
+  rf_unload_image(bmp->image, mrb_get_allocator(mrb));
+  bmp->image.data = NULL;
+  bmp->image.valid = false;
+  mrb_get_residency()->released += 1;
+}
+
+static rf_bitmap *
+alloc_bitmap(mrb_state *mrb, rf_image image, char *source)
+{
+  rf_bitmap *bmp = mrb_malloc(mrb, sizeof *bmp);
+  bmp->image = image;
+  // No texture until the first draw, but drawables can already ask for its size
+  bmp->texture = (rf_texture2d){ 0 };
+  bmp->texture.width = image.width;
+  bmp->texture.height = image.height;
+  bmp->font = NULL;
+  bmp->dirty = TRUE;
+  bmp->uploaded = FALSE;
+  bmp->upload_avoided = FALSE;
+  bmp->readback = NULL;
+  bmp->source = source;
+  bmp->read_only = source ? TRUE : FALSE;
+  bmp->texture_format = RF_TEXTURE_DEFAULT;
+  bmp->image_bytes = 0;
+  bmp->released_bytes = 0;
+  bmp->lru_prev = NULL;
+  bmp->lru_next = NULL;
+  bmp->collision = NULL;
+  bmp->tiles = NULL;
+  bmp->dirty_rect = (rf_rec){ 0 };
+  mrb_residency_track(bmp);
+  account_image(bmp);
+  return bmp;
+}
+
+static char *
+copy_source(mrb_state *mrb, const char *source)
+{
+  size_t len = strlen(source);
+  char *copy = mrb_malloc(mrb, len + 1);
+  memcpy(copy, source, len + 1);
+  return copy;
+}
+
+/* The bitmap keeps straight pixels, only the ones the GPU gets are
+   premultiplied. A scratch image can be premultiplied in place. */
+static rf_texture2d
+load_texture(mrb_state *mrb, rf_bitmap *bmp, rf_image image, mrb_bool scratch)
+{
+  enum rf_texture_format format = mrb_texture_policy_resolve(bmp->texture_format, bmp->source, image);
+  rf_image source = image;
+  if (mrb_get_premultiplied_alpha())
+  {
+    if (!scratch)
+    {
+      size_t bytes = image_bytes(image);
+      source.data = mrb_malloc(mrb, bytes);
+      memcpy(source.data, image.data, bytes);
+    }
+    mrb_premultiply_image(&source);
+  }
+  rf_texture2d texture;
+  if (format == RF_TEXTURE_RGBA8888)
+  {
+    texture = rf_load_texture_from_image(source);
+  }
+  else
+  {
+    rf_image reduced = mrb_texture_convert(mrb, source, format);
+    texture = rf_load_texture_from_image(reduced);
+    mrb_free(mrb, reduced.data);
+  }
+  if (source.data != image.data) mrb_free(mrb, source.data);
+  return texture;
+}
+
+/* Images past the GPU's texture size keep their pixels and get a tile grid,
+   the tiles are uploaded by the draws that need them. */
+static void
+upload_tiles(mrb_state *mrb, rf_bitmap *bmp)
+{
+  rf_image *image = mrb_bitmap_get_image(mrb, bmp);
+  if (bmp->tiles) mrb_tiled_texture_invalidate(bmp->tiles);
+  else bmp->tiles = mrb_tiled_texture_new(mrb, image->width, image->height);
+  if (bmp->texture.id) mrb_residency_set_texture(bmp, (rf_texture2d){ 0 });
+  bmp->texture.width = image->width;
+  bmp->texture.height = image->height;
+  bmp->dirty = FALSE;
+  bmp->dirty_rect = (rf_rec){ 0 };
+  bmp->uploaded = TRUE;
+  account_image(bmp);
+}
+
+/* Decodes the source file again, for read only bitmaps that gave up their pixels. */
+static rf_image
+reload_source(mrb_state *mrb, rf_bitmap *bmp)
+{
+  rf_allocator alloc = mrb_get_allocator(mrb);
+  rf_io_callbacks io = mrb_get_io_callbacks_for_extensions(mrb, MRB_IMAGE_EXTENSIONS);
+  rf_image image = rf_load_image_from_file(bmp->source, alloc, alloc, io);
+  if (!image.valid || !image.data)
+  {
+    rf_unload_image(image, alloc);
+    mrb_raisef(mrb, E_LOAD_ERROR, "Cannot reload bitmap '%s'", bmp->source);
+  }
+  return image;
+}
+
+void
+mrb_bitmap_upload(mrb_state *mrb, rf_bitmap *bmp)
+{
+  if (bmp->tiles || mrb_texture_needs_tiles(bmp->image.width, bmp->image.height))
+  {
+    upload_tiles(mrb, bmp);
+    return;
+  }
+  rf_residency *residency = mrb_get_residency();
+  uint64_t start = ORGF_STATS_NOW();
+  // A texture uploaded before but without an id now was evicted
+  if (!bmp->texture.id && bmp->uploaded) residency->reloads += 1;
+  if (bmp->image.data)
+  {
+    mrb_residency_set_texture(bmp, load_texture(mrb, bmp, bmp->image, FALSE));
+  }
+  else if (bmp->source)
+  {
+    rf_image image = reload_source(mrb, bmp);
+    mrb_residency_set_texture(bmp, load_texture(mrb, bmp, image, TRUE));
+    rf_unload_image(image, mrb_get_allocator(mrb));
+  }
+  ORGF_STATS_ADD(uploads, 1);
+  ORGF_STATS_ADD(upload_time, ORGF_STATS_NOW() - start);
+  bmp->dirty = FALSE;
+  bmp->dirty_rect = (rf_rec){ 0 };
+  bmp->uploaded = TRUE;
+  release_image(mrb, bmp);
+  account_image(bmp);
+}
+
+void
+mrb_bitmap_upload_region(mrb_state *mrb, rf_bitmap *bmp)
+{
+  uint64_t start = ORGF_STATS_NOW();
+  int x = (int)bmp->dirty_rect.x, y = (int)bmp->dirty_rect.y;
+  int w = (int)bmp->dirty_rect.width, h = (int)bmp->dirty_rect.height;
+  bmp->dirty_rect = (rf_rec){ 0 };
+  // GLES2 has no unpack row length, so the rows are gathered first
+  unsigned char *pixels = mrb_malloc(mrb, (size_t)w * (size_t)h * 4);
+  const unsigned char *src = bmp->image.data;
+  for (int j = 0; j < h; ++j)
+  {
+    memcpy(pixels + (size_t)j * w * 4, src + ((size_t)(y + j) * bmp->image.width + x) * 4, (size_t)w * 4);
+  }
+  if (mrb_get_premultiplied_alpha()) mrb_premultiply_pixels(pixels, (size_t)w * (size_t)h);
+  rf_gl.BindTexture(GL_TEXTURE_2D, bmp->texture.id);
+  rf_gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  rf_gl.TexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  rf_gl.BindTexture(GL_TEXTURE_2D, 0);
+  mrb_free(mrb, pixels);
+  ORGF_STATS_ADD(uploads, 1);
+  ORGF_STATS_ADD(upload_time, ORGF_STATS_NOW() - start);
+}
+
+void
+mrb_bitmap_mark_dirty(rf_bitmap *bmp, rf_rec rect)
+{
+  if (bmp->dirty) return;
+  float x0 = rect.x > 0 ? floorf(rect.x) : 0;
+  float y0 = rect.y > 0 ? floorf(rect.y) : 0;
+  float x1 = ceilf(rect.x + rect.width), y1 = ceilf(rect.y + rect.height);
+  if (x1 > bmp->image.width) x1 = (float)bmp->image.width;
+  if (y1 > bmp->image.height) y1 = (float)bmp->image.height;
+  if (x1 <= x0 || y1 <= y0) return;
+  // Sub uploads need the texture to hold the very same RGBA pixels
+  if (!bmp->texture.id || bmp->tiles || !bmp->image.data || bmp->image.format != RF_UNCOMPRESSED_R8G8B8A8 ||
+      bmp->texture.format != RF_UNCOMPRESSED_R8G8B8A8)
+  {
+    bmp->dirty = TRUE;
+    return;
+  }
+  if (bmp->dirty_rect.width > 0)
+  {
+    rf_rec *d = &(bmp->dirty_rect);
+    if (d->x < x0) x0 = d->x;
+    if (d->y < y0) y0 = d->y;
+    if (d->x + d->width > x1) x1 = d->x + d->width;
+    if (d->y + d->height > y1) y1 = d->y + d->height;
+  }
+  bmp->dirty_rect = (rf_rec){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+rf_image *
+mrb_bitmap_get_mutable_image(mrb_state *mrb, rf_bitmap *bmp)
+{
+  rf_image *image = mrb_bitmap_get_image(mrb, bmp);
+  // The pixels are about to change, the mask is rebuilt on its next use
+  mrb_collision_mask_free(mrb, bmp->collision);
+  bmp->collision = NULL;
+  // A texture made before this change would have to be uploaded again
+  count_avoided_upload(bmp);
+  if (bmp->read_only && image->data)
+  {
+    // The file no longer matches the pixels, so it can't bring them back either
+    bmp->read_only = FALSE;
+    mrb_free(mrb, bmp->source);
+    bmp->source = NULL;
+    account_image(bmp);
+  }
+  return image;
+}
+
+rf_collision_mask *
+mrb_bitmap_get_collision_mask(mrb_state *mrb, rf_bitmap *bmp, int threshold)
+{
+  if (bmp->collision && bmp->collision->threshold == threshold) return bmp->collision;
+  mrb_collision_mask_free(mrb, bmp->collision);
+  bmp->collision = mrb_collision_mask_new(mrb, mrb_bitmap_get_image(mrb, bmp), threshold);
+  // The mask is all collisions need, a file bitmap can drop its pixels again
+  release_image(mrb, bmp);
+  account_image(bmp);
+  return bmp->collision;
+}
+
+static void
+set_default_font(mrb_state *mrb, mrb_value self, rf_bitmap *bmp)
+{
+  mrb_value font = mrb_new_default_font(mrb);
+  mrb_iv_set(mrb, self, FONT, font);
+  bmp->font = mrb_get_font(mrb, font);
+}
+
 static mrb_value
 mrb_bitmap_initialize(mrb_state *mrb, mrb_value self)
 {
   rf_image img;
+  char *source = NULL;
   mrb_int argc = mrb_get_argc(mrb);
   rf_allocator alloc = mrb_get_allocator(mrb);
   switch (argc)
@@ -60,6 +365,13 @@ mrb_bitmap_initialize(mrb_state *mrb, mrb_value self)
       mrb_get_args(mrb, "z", &filename);
       const char *new_filename = mrb_filesystem_join(mrb, "Graphics", filename);
       img = rf_load_image_from_file(new_filename, alloc, alloc, io);
+      // Fail here, the bitmap would only decode the file again when first drawn
+      if (!img.valid || !img.data)
+      {
+        rf_unload_image(img, alloc);
+        mrb_raisef(mrb, E_LOAD_ERROR, "Cannot load bitmap '%s'", filename);
+      }
+      source = copy_source(mrb, new_filename);
       mrb_gc_arena_restore(mrb, arena);
       break;
     }
@@ -76,13 +388,8 @@ mrb_bitmap_initialize(mrb_state *mrb, mrb_value self)
       mrb_raisef(mrb, E_ARGUMENT_ERROR, "Wrong number of arguments expected 0, 1 or 2 but %i where given", argc);
     }
   }
-  rf_bitmap *bmp = mrb_malloc(mrb, sizeof *bmp);
-  bmp->image = img;
-  bmp->texture = rf_load_texture_from_image(img);
-  bmp->dirty = FALSE;
-  mrb_value font = mrb_new_default_font(mrb);
-  mrb_iv_set(mrb, self, FONT, font);
-  bmp->font = mrb_get_font(mrb, font);
+  rf_bitmap *bmp = alloc_bitmap(mrb, img, source);
+  set_default_font(mrb, self, bmp);
   DATA_TYPE(self) = &mrb_bitmap_data_type;
   DATA_PTR(self) = bmp;
   return mrb_nil_value();
@@ -93,11 +400,11 @@ mrb_bitmap_initialize_copy(mrb_state *mrb, mrb_value self)
 {
   rf_bitmap *original;
   mrb_get_args(mrb, "d", &original, &mrb_bitmap_data_type);
-  rf_image img = rf_image_copy(original->image, mrb_get_allocator(mrb));
-  rf_bitmap *bmp = mrb_malloc(mrb, sizeof *bmp);
-  bmp->image = img;
-  bmp->texture = rf_load_texture_from_image(img);
-  bmp->dirty = FALSE;
+  rf_image img = rf_image_copy(*mrb_bitmap_get_image(mrb, original), mrb_get_allocator(mrb));
+  rf_bitmap *bmp = alloc_bitmap(mrb, img, NULL);
+  bmp->font = mrb_get_font(mrb, mrb_iv_get(mrb, self, FONT));
+  DATA_TYPE(self) = &mrb_bitmap_data_type;
+  DATA_PTR(self) = bmp;
   return mrb_nil_value();
 }
 
@@ -122,17 +429,72 @@ mrb_bitmap_get_height(mrb_state *mrb, mrb_value self)
   return mrb_fixnum_value(bmp->image.height);
 }
 
+/* Wraps an image the caller already built, without going through initialize. */
 static mrb_value
-new_bitmap(mrb_state *mrb)
+new_bitmap(mrb_state *mrb, rf_image image)
 {
-  mrb_value argv[] = {
-    mrb_fixnum_value(1),
-    mrb_fixnum_value(1)
-  };
-  struct RClass *bmp = mrb_class_get(mrb, "Bitmap");
-  return mrb_obj_new(mrb, bmp, 2, argv);
+  struct RClass *bitmap = mrb_class_get(mrb, "Bitmap");
+  mrb_value result = mrb_obj_value(mrb_data_object_alloc(mrb, bitmap, NULL, &mrb_bitmap_data_type));
+  rf_bitmap *bmp = alloc_bitmap(mrb, image, NULL);
+  DATA_PTR(result) = bmp;
+  set_default_font(mrb, result, bmp);
+  return result;
 }
 
+void
+mrb_bitmap_materialize(mrb_state *mrb, rf_bitmap *bmp)
+{
+  if (bmp->readback)
+  {
+    rf_color *pixels = mrb_malloc(mrb, bmp->image.width * bmp->image.height * sizeof *pixels);
+    mrb_readback_finish(bmp->readback, pixels);
+    // Render targets are drawn premultiplied, the bitmap keeps straight pixels
+    if (mrb_get_premultiplied_alpha()) mrb_unpremultiply_pixels((unsigned char *)pixels, (size_t)bmp->image.width * bmp->image.height);
+    mrb_readback_release_target(bmp->readback);
+    mrb_readback_free(bmp->readback);
+    mrb_free(mrb, bmp->readback);
+    bmp->readback = NULL;
+    bmp->image.data = pixels;
+    bmp->image.valid = true;
+  }
+  else if (bmp->read_only && bmp->texture.id && bmp->texture.format == RF_UNCOMPRESSED_R8G8B8A8 && !mrb_get_premultiplied_alpha())
+  {
+    // A resident texture is faster to read back than decoding the file again,
+    // unless it holds premultiplied colors, which lose precision where alpha is low,
+    // or was uploaded in a reduced format, which would quantize the pixels for good
+    rf_color *pixels = mrb_malloc(mrb, bmp->image.width * bmp->image.height * sizeof *pixels);
+    mrb_readback_texture(bmp->texture, pixels);
+    bmp->image.data = pixels;
+    bmp->image.format = RF_UNCOMPRESSED_R8G8B8A8;
+    bmp->image.valid = true;
+    mrb_get_residency()->recovered += 1;
+  }
+  else if (bmp->read_only && bmp->source)
+  {
+    bmp->image = reload_source(mrb, bmp);
+    mrb_get_residency()->recovered += 1;
+  }
+  account_image(bmp);
+}
+
+mrb_value
+mrb_bitmap_new_from_render_texture(mrb_state *mrb, rf_render_texture2d target)
+{
+  rf_image image = { 0 };
+  image.width = target.texture.width;
+  image.height = target.texture.height;
+  image.format = RF_UNCOMPRESSED_R8G8B8A8;
+  mrb_value result = new_bitmap(mrb, image);
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
+  // The texture is used as is, pixels are copied back only when something asks for them.
+  mrb_residency_set_texture(bmp, target.texture);
+  bmp->dirty = FALSE;
+  bmp->uploaded = TRUE;
+  bmp->readback = mrb_malloc(mrb, sizeof *(bmp->readback));
+  mrb_readback_init(bmp->readback);
+  mrb_readback_start(bmp->readback, target);
+  return result;
+}
 
 #define COLOR_PARAM(v) &v, &mrb_color_data_type
 
@@ -143,13 +505,7 @@ mrb_bitmap_s_from_color(mrb_state *mrb, mrb_value self)
   rf_color *color;
   rf_allocator alloc = mrb_get_allocator(mrb);
   mrb_get_args(mrb, "iid", &w, &h, COLOR_PARAM(color));
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
-  bmp->image = rf_gen_image_color((int)w, (int)h, *color, alloc);
-  bmp->texture = rf_load_texture_from_image(bmp->image);
-  return result;
+  return new_bitmap(mrb, rf_gen_image_color((int)w, (int)h, *color, alloc));
 }
 
 static mrb_value
@@ -158,13 +514,7 @@ mrb_bitmap_s_cellular(mrb_state *mrb, mrb_value self)
   mrb_int w, h, ts;
   rf_allocator alloc = mrb_get_allocator(mrb);
   mrb_get_args(mrb, "iii", &w, &h, &ts);
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
-  bmp->image = rf_gen_image_cellular((int)w, (int)h, (int)ts, RF_DEFAULT_RAND_PROC, alloc);
-  bmp->texture = rf_load_texture_from_image(bmp->image);
-  return result;
+  return new_bitmap(mrb, rf_gen_image_cellular((int)w, (int)h, (int)ts, RF_DEFAULT_RAND_PROC, alloc));
 }
 
 static mrb_value
@@ -174,13 +524,7 @@ mrb_bitmap_s_checked(mrb_state *mrb, mrb_value self)
   rf_color *c1, *c2;
   rf_allocator alloc = mrb_get_allocator(mrb);
   mrb_get_args(mrb, "iiiidd", &w, &h, &cx, &cy, COLOR_PARAM(c1), COLOR_PARAM(c2));
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
-  bmp->image = rf_gen_image_checked((int)w, (int)h, (int)cx, (int)cy, *c1, *c2, alloc);
-  bmp->texture = rf_load_texture_from_image(bmp->image);
-  return result;
+  return new_bitmap(mrb, rf_gen_image_checked((int)w, (int)h, (int)cx, (int)cy, *c1, *c2, alloc));
 }
 
 static mrb_value
@@ -191,21 +535,11 @@ mrb_bitmap_s_gradient(mrb_state *mrb, mrb_value self)
   mrb_bool v = FALSE;
   rf_allocator alloc = mrb_get_allocator(mrb);
   mrb_get_args(mrb, "iidd|b", &w, &h, COLOR_PARAM(c1), COLOR_PARAM(c2), &v);
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
   if (v)
   {
-    bmp->image = rf_gen_image_gradient_v((int)w, (int)h, *c1, *c2, alloc);
-    
+    return new_bitmap(mrb, rf_gen_image_gradient_v((int)w, (int)h, *c1, *c2, alloc));
   }
-  else
-  {
-    bmp->image = rf_gen_image_gradient_h((int)w, (int)h, *c1, *c2, alloc);
-  }
-  bmp->texture = rf_load_texture_from_image(bmp->image);  
-  return result;
+  return new_bitmap(mrb, rf_gen_image_gradient_h((int)w, (int)h, *c1, *c2, alloc));
 }
 
 static mrb_value
@@ -216,13 +550,7 @@ mrb_bitmap_s_radial_gradient(mrb_state *mrb, mrb_value self)
   rf_color *c1, *c2;
   mrb_get_args(mrb, "iifdd", &w, &h, &d, COLOR_PARAM(c1), COLOR_PARAM(c2));
   rf_allocator alloc = mrb_get_allocator(mrb);
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
-  bmp->image = rf_gen_image_gradient_radial((int)w, (int)h, (float)d, *c1, *c2, alloc);
-  bmp->texture = rf_load_texture_from_image(bmp->image);  
-  return result;
+  return new_bitmap(mrb, rf_gen_image_gradient_radial((int)w, (int)h, (float)d, *c1, *c2, alloc));
 }
 
 static mrb_value
@@ -232,13 +560,7 @@ mrb_bitmap_s_perlin_noise(mrb_state *mrb, mrb_value self)
   mrb_float s;
   rf_allocator alloc = mrb_get_allocator(mrb);
   mrb_get_args(mrb, "iiiif", &w, &h, &ox, &oy, &s);
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
-  bmp->image = rf_gen_image_perlin_noise((int)w, (int)h, (int)ox, (int)oy, (float)s, alloc);
-  bmp->texture = rf_load_texture_from_image(bmp->image);
-  return result;
+  return new_bitmap(mrb, rf_gen_image_perlin_noise((int)w, (int)h, (int)ox, (int)oy, (float)s, alloc));
 }
 
 static mrb_value
@@ -248,13 +570,7 @@ mrb_bitmap_s_white_noise(mrb_state *mrb, mrb_value self)
   mrb_float f;
   rf_allocator alloc = mrb_get_allocator(mrb);
   mrb_get_args(mrb, "iif", &w, &h, &f);
-  mrb_value result = new_bitmap(mrb);
-  rf_bitmap *bmp = mrb_get_bitmap(mrb, result);
-  rf_unload_texture(bmp->texture);
-  rf_unload_image(bmp->image, alloc);
-  bmp->image = rf_gen_image_white_noise((int)w, (int)h, (float)f, RF_DEFAULT_RAND_PROC, alloc);
-  bmp->texture = rf_load_texture_from_image(bmp->image);
-  return result;
+  return new_bitmap(mrb, rf_gen_image_white_noise((int)w, (int)h, (float)f, RF_DEFAULT_RAND_PROC, alloc));
 }
 
 static mrb_value
@@ -272,6 +588,70 @@ mrb_bitmap_dispose(mrb_state *mrb, mrb_value self)
   return mrb_nil_value();
 }
 
+static mrb_value
+mrb_bitmap_pinnedQ(mrb_state *mrb, mrb_value self)
+{
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  return mrb_bool_value(bmp->pinned);
+}
+
+static mrb_value
+mrb_bitmap_set_pinned(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  mrb_get_args(mrb, "b", &value);
+  mrb_residency_set_pinned(bmp, value);
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_bitmap_residentQ(mrb_state *mrb, mrb_value self)
+{
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  return mrb_bool_value(bmp->texture.id ? TRUE : FALSE);
+}
+
+static mrb_value
+mrb_bitmap_tiledQ(mrb_state *mrb, mrb_value self)
+{
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  if (!bmp->tiles && !bmp->uploaded) return mrb_bool_value(mrb_texture_needs_tiles(bmp->image.width, bmp->image.height));
+  return mrb_bool_value(bmp->tiles ? TRUE : FALSE);
+}
+
+static mrb_value
+mrb_bitmap_get_texture_format(mrb_state *mrb, mrb_value self)
+{
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  return mrb_texture_format_value(mrb, bmp->texture_format);
+}
+
+static mrb_value
+mrb_bitmap_set_texture_format(mrb_state *mrb, mrb_value self)
+{
+  mrb_value value;
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  mrb_get_args(mrb, "o", &value);
+  enum rf_texture_format format = mrb_get_texture_format(mrb, value);
+  if (format == bmp->texture_format) return value;
+  bmp->texture_format = format;
+  // Uploaded again in the new format the next time it is drawn
+  if (bmp->texture.id) bmp->dirty = TRUE;
+  return value;
+}
+
+static mrb_value
+mrb_bitmap_collision_mask(mrb_state *mrb, mrb_value self)
+{
+  mrb_int threshold = ORGF_COLLISION_THRESHOLD;
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  mrb_get_args(mrb, "|i", &threshold);
+  if (threshold < 1 || threshold > 255) mrb_raise(mrb, E_ARGUMENT_ERROR, "threshold must be between 1 and 255");
+  mrb_bitmap_get_collision_mask(mrb, bmp, (int)threshold);
+  return self;
+}
+
 static mrb_value
 mrb_bitmap_blt(mrb_state *mrb, mrb_value self)
 {
@@ -314,17 +694,82 @@ mrb_bitmap_clear_rect(mrb_state *mrb, mrb_value self)
   return mrb_nil_value();
 }
 
+static void
+get_pixel_position(mrb_state *mrb, mrb_value *argv, mrb_int argc, mrb_int *x, mrb_int *y)
+{
+  if (argc == 1)
+  {
+    rf_vec2 *point = mrb_get_point(mrb, argv[0]);
+    *x = (mrb_int)point->x;
+    *y = (mrb_int)point->y;
+    return;
+  }
+  *x = mrb_int(mrb, argv[0]);
+  *y = mrb_int(mrb, argv[1]);
+}
+
+static unsigned char *
+pixel_at(rf_image *image, mrb_int x, mrb_int y)
+{
+  if (!image->data || x < 0 || y < 0 || x >= image->width || y >= image->height) return NULL;
+  size_t index = (size_t)y * (size_t)image->width + (size_t)x;
+  return (unsigned char *)image->data + index * (size_t)mrb_pixel_bytes(image->format);
+}
+
 static mrb_value
 mrb_bitmap_get_pixel(mrb_state *mrb, mrb_value self)
 {
+  mrb_int x, y, argc;
+  mrb_value *argv;
   rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
-  return mrb_nil_value();
+  mrb_get_args(mrb, "*", &argv, &argc);
+  if (argc < 1 || argc > 2) mrb_raise(mrb, E_ARGUMENT_ERROR, "Wrong number of arguments expected 1 or 2");
+  get_pixel_position(mrb, argv, argc, &x, &y);
+  rf_image *image = mrb_bitmap_get_image(mrb, bmp);
+  unsigned char *p = pixel_at(image, x, y);
+  if (!p) return mrb_color_new(mrb, 0, 0, 0, 0);
+  switch (image->format)
+  {
+    case RF_UNCOMPRESSED_GRAYSCALE: return mrb_color_new(mrb, p[0], p[0], p[0], 255);
+    case RF_UNCOMPRESSED_GRAY_ALPHA: return mrb_color_new(mrb, p[0], p[0], p[0], p[1]);
+    case RF_UNCOMPRESSED_R8G8B8: return mrb_color_new(mrb, p[0], p[1], p[2], 255);
+    case RF_UNCOMPRESSED_R8G8B8A8: return mrb_color_new(mrb, p[0], p[1], p[2], p[3]);
+    default: return mrb_color_new(mrb, 0, 0, 0, 0);
+  }
 }
 
 static mrb_value
 mrb_bitmap_set_pixel(mrb_state *mrb, mrb_value self)
 {
+  mrb_int x, y, argc;
+  mrb_value *argv;
   rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  mrb_get_args(mrb, "*", &argv, &argc);
+  if (argc < 2 || argc > 3) mrb_raise(mrb, E_ARGUMENT_ERROR, "Wrong number of arguments expected 2 or 3");
+  get_pixel_position(mrb, argv, argc - 1, &x, &y);
+  rf_color *color = mrb_get_color(mrb, argv[argc - 1]);
+  rf_image *image = mrb_bitmap_get_mutable_image(mrb, bmp);
+  unsigned char *p = pixel_at(image, x, y);
+  if (!p) return mrb_nil_value();
+  switch (image->format)
+  {
+    case RF_UNCOMPRESSED_GRAYSCALE:
+      p[0] = (unsigned char)((color->r + color->g + color->b) / 3);
+      break;
+    case RF_UNCOMPRESSED_GRAY_ALPHA:
+      p[0] = (unsigned char)((color->r + color->g + color->b) / 3);
+      p[1] = color->a;
+      break;
+    case RF_UNCOMPRESSED_R8G8B8:
+      p[0] = color->r; p[1] = color->g; p[2] = color->b;
+      break;
+    case RF_UNCOMPRESSED_R8G8B8A8:
+      p[0] = color->r; p[1] = color->g; p[2] = color->b; p[3] = color->a;
+      break;
+    default:
+      return mrb_nil_value();
+  }
+  bmp->dirty = TRUE;
   return mrb_nil_value();
 }
 
@@ -352,15 +797,49 @@ mrb_bitmap_radial_blur(mrb_state *mrb, mrb_value self)
 static mrb_value
 mrb_bitmap_draw_text(mrb_state *mrb, mrb_value self)
 {
+  mrb_int argc;
+  mrb_value *argv;
+  rf_rec rect;
+  mrb_int align = 0;
   rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
+  mrb_get_args(mrb, "*", &argv, &argc);
+  if (argc == 2 || argc == 3)
+  {
+    rect = *mrb_get_rect(mrb, argv[0]);
+    if (argc == 3) align = mrb_int(mrb, argv[2]);
+  }
+  else if (argc == 5 || argc == 6)
+  {
+    rect = (rf_rec){ mrb_to_flo(mrb, argv[0]), mrb_to_flo(mrb, argv[1]), mrb_to_flo(mrb, argv[2]), mrb_to_flo(mrb, argv[3]) };
+    if (argc == 6) align = mrb_int(mrb, argv[5]);
+  }
+  else
+  {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "Wrong number of arguments expected 2, 3, 5 or 6");
+  }
+  mrb_value text = mrb_obj_as_string(mrb, argv[argc == 2 || argc == 5 ? argc - 1 : argc - 2]);
+  // The default font has no glyphs on the CPU to draw from
+  if (!bmp->font || !mrb_font_cpu_p(bmp->font)) return mrb_nil_value();
+  rf_image *image = mrb_bitmap_get_mutable_image(mrb, bmp);
+  rf_rec touched = { 0 };
+  if (mrb_font_draw_text(mrb, bmp->font, image, rect, RSTRING_PTR(text), RSTRING_LEN(text), (int)align, &touched))
+  {
+    mrb_bitmap_mark_dirty(bmp, touched);
+  }
   return mrb_nil_value();
 }
 
 static mrb_value
 mrb_bitmap_text_size(mrb_state *mrb, mrb_value self)
 {
+  mrb_value text;
   rf_bitmap *bmp = mrb_get_bitmap(mrb, self);
-  return mrb_nil_value();
+  mrb_get_args(mrb, "o", &text);
+  text = mrb_obj_as_string(mrb, text);
+  mrb_value font = mrb_iv_get(mrb, self, FONT);
+  mrb_float width = mrb_to_flo(mrb, mrb_funcall(mrb, font, "measure_text", 1, text));
+  mrb_int height = bmp->font ? bmp->font->size : 0;
+  return mrb_rect_new(mrb, 0, 0, (mrb_int)ceil(width), height);
 }
 
 static mrb_value
@@ -403,6 +882,14 @@ mrb_init_orgf_bitmap(mrb_state *mrb)
   mrb_define_method(mrb, bitmap, "disposed?", mrb_bitmap_disposedQ, MRB_ARGS_NONE());
   mrb_define_method(mrb, bitmap, "dispose", mrb_bitmap_dispose, MRB_ARGS_NONE());
 
+  mrb_define_method(mrb, bitmap, "pinned?", mrb_bitmap_pinnedQ, MRB_ARGS_NONE());
+  mrb_define_method(mrb, bitmap, "pinned=", mrb_bitmap_set_pinned, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, bitmap, "resident?", mrb_bitmap_residentQ, MRB_ARGS_NONE());
+  mrb_define_method(mrb, bitmap, "tiled?", mrb_bitmap_tiledQ, MRB_ARGS_NONE());
+  mrb_define_method(mrb, bitmap, "texture_format", mrb_bitmap_get_texture_format, MRB_ARGS_NONE());
+  mrb_define_method(mrb, bitmap, "texture_format=", mrb_bitmap_set_texture_format, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, bitmap, "collision_mask", mrb_bitmap_collision_mask, MRB_ARGS_OPT(1));
+
   mrb_define_method(mrb, bitmap, "block_transfer", mrb_bitmap_blt, MRB_ARGS_REQ(4)|MRB_ARGS_OPT(1));
   mrb_define_method(mrb, bitmap, "blt", mrb_bitmap_blt, MRB_ARGS_REQ(4)|MRB_ARGS_OPT(1));
   mrb_define_method(mrb, bitmap, "stretch_blt", mrb_bitmap_stretch_blt, MRB_ARGS_REQ(3)|MRB_ARGS_OPT(1));
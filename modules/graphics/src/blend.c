@@ -0,0 +1,173 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+
+#include <orgf/blend.h>
+#include <orgf/simd.h>
+#include <orgf/stats.h>
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#ifndef GL_ONE
+#define GL_ONE 1
+#endif
+
+#ifndef GL_ONE_MINUS_SRC_ALPHA
+#define GL_ONE_MINUS_SRC_ALPHA 0x0303
+#endif
+
+#ifndef GL_DST_COLOR
+#define GL_DST_COLOR 0x0306
+#endif
+
+enum premultiplied_blend
+{
+  BLEND_UNKNOWN,
+  BLEND_OVER,
+  BLEND_MULTIPLY,
+};
+
+static mrb_bool premultiplied = FALSE;
+static enum premultiplied_blend applied = BLEND_UNKNOWN;
+
+mrb_bool
+mrb_get_premultiplied_alpha(void)
+{
+  return premultiplied;
+}
+
+void
+mrb_set_premultiplied_alpha(mrb_bool value)
+{
+  premultiplied = value;
+  applied = BLEND_UNKNOWN;
+}
+
+void
+mrb_reset_blend_state(void)
+{
+  applied = BLEND_UNKNOWN;
+}
+
+// c * a / 255, rounded, without a division
+static inline unsigned char
+multiply(unsigned int c, unsigned int a)
+{
+  unsigned int t = c * a + 128;
+  return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+#ifdef ORGF_SIMD_SSE2
+static inline __m128i
+premultiply_half(__m128i v, __m128i rgb_mask, __m128i alpha_one)
+{
+  // Each pixel's alpha in its four lanes, except alpha itself is multiplied by 255
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+  a = _mm_or_si128(_mm_and_si128(a, rgb_mask), alpha_one);
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(v, a), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+#endif
+
+void
+mrb_premultiply_pixels(unsigned char *pixels, size_t count)
+{
+  size_t i = 0;
+#ifdef ORGF_SIMD_SSE2
+  __m128i zero = _mm_setzero_si128();
+  __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pixels + i * 4));
+    __m128i lo = premultiply_half(_mm_unpacklo_epi8(v, zero), rgb_mask, alpha_one);
+    __m128i hi = premultiply_half(_mm_unpackhi_epi8(v, zero), rgb_mask, alpha_one);
+    _mm_storeu_si128((__m128i *)(pixels + i * 4), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < count; ++i)
+  {
+    unsigned char *p = pixels + i * 4;
+    if (p[3] == 255) continue;
+    p[0] = multiply(p[0], p[3]);
+    p[1] = multiply(p[1], p[3]);
+    p[2] = multiply(p[2], p[3]);
+  }
+}
+
+void
+mrb_premultiply_image(rf_image *image)
+{
+  size_t count = (size_t)image->width * (size_t)image->height;
+  unsigned char *p = image->data;
+  switch (image->format)
+  {
+    case RF_UNCOMPRESSED_R8G8B8A8:
+      mrb_premultiply_pixels(p, count);
+      break;
+    case RF_UNCOMPRESSED_GRAY_ALPHA:
+      for (size_t i = 0; i < count; ++i) p[i * 2] = multiply(p[i * 2], p[i * 2 + 1]);
+      break;
+    default:
+      break;
+  }
+}
+
+void
+mrb_unpremultiply_pixels(unsigned char *pixels, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    unsigned char *p = pixels + i * 4;
+    unsigned int a = p[3];
+    if (a == 255) continue;
+    for (int c = 0; c < 3; ++c)
+    {
+      unsigned int value = a ? (p[c] * 255 + a / 2) / a : 0;
+      p[c] = (unsigned char)(value > 255 ? 255 : value);
+    }
+  }
+}
+
+rf_color
+mrb_blend_color(rf_color color, rf_blend_mode mode)
+{
+  if (!premultiplied) return color;
+  return (rf_color){
+    multiply(color.r, color.a),
+    multiply(color.g, color.a),
+    multiply(color.b, color.a),
+    mode == RF_BLEND_ADDITIVE ? 0 : color.a
+  };
+}
+
+static void
+apply_blend_mode(rf_blend_mode mode)
+{
+  if (!premultiplied)
+  {
+    rf_begin_blend_mode(mode);
+    return;
+  }
+  enum premultiplied_blend blend = mode == RF_BLEND_MULTIPLIED ? BLEND_MULTIPLY : BLEND_OVER;
+  if (blend == applied) return;
+  rf_gfx_draw();
+  rf_gl.BlendFunc(blend == BLEND_MULTIPLY ? GL_DST_COLOR : GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  applied = blend;
+}
+
+void
+mrb_begin_blend_mode(rf_blend_mode mode)
+{
+  apply_blend_mode(mode);
+  // The same mode again doesn't flush, the reason given for it is dropped
+  ORGF_STATS_SETTLE();
+}
+
+void
+mrb_end_blend_mode(void)
+{
+  if (premultiplied) apply_blend_mode(RF_BLEND_ALPHA);
+  else rf_end_blend_mode();
+  ORGF_STATS_SETTLE();
+}
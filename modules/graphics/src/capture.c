@@ -0,0 +1,467 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <physfs.h>
+
+#include <orgf/file.h>
+#include <orgf/thread.h>
+#include <orgf/readback.h>
+#include <orgf/capture.h>
+
+#define FRAME_FREE 0
+#define FRAME_QUEUED 1
+#define FRAME_ENCODED 2
+#define FRAME_WRITTEN 3
+
+#define E_FILE_ERROR mrb_exc_get(mrb, "FileError")
+#define PHYSFS_ERROR_STR PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode())
+
+#define STORED_BLOCK_SIZE 65535
+
+static uint32_t crc_table[256];
+static mrb_bool crc_table_ready = FALSE;
+
+static void
+init_crc_table(void)
+{
+  if (crc_table_ready) return;
+  for (uint32_t n = 0; n < 256; ++n)
+  {
+    uint32_t c = n;
+    for (int k = 0; k < 8; ++k)
+    {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    crc_table[n] = c;
+  }
+  crc_table_ready = TRUE;
+}
+
+static uint32_t
+crc32(const unsigned char *data, size_t size)
+{
+  uint32_t c = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i)
+  {
+    c = crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+  }
+  return c ^ 0xFFFFFFFFu;
+}
+
+static inline unsigned char *
+put_u32(unsigned char *out, uint32_t value)
+{
+  out[0] = (unsigned char)(value >> 24);
+  out[1] = (unsigned char)(value >> 16);
+  out[2] = (unsigned char)(value >> 8);
+  out[3] = (unsigned char)value;
+  return out + 4;
+}
+
+typedef struct
+{
+  unsigned char *out;
+  size_t         remaining;
+  size_t         block_left;
+  uint32_t       a, b;
+} stored_stream;
+
+static void
+stored_write(stored_stream *s, const unsigned char *data, size_t size)
+{
+  while (size)
+  {
+    if (!s->block_left)
+    {
+      size_t block = s->remaining < STORED_BLOCK_SIZE ? s->remaining : STORED_BLOCK_SIZE;
+      *(s->out++) = s->remaining == block ? 1 : 0;
+      *(s->out++) = (unsigned char)(block & 0xFF);
+      *(s->out++) = (unsigned char)(block >> 8);
+      *(s->out++) = (unsigned char)(~block & 0xFF);
+      *(s->out++) = (unsigned char)((~block >> 8) & 0xFF);
+      s->block_left = block;
+    }
+    size_t chunk = size < s->block_left ? size : s->block_left;
+    memcpy(s->out, data, chunk);
+    for (size_t i = 0; i < chunk; ++i)
+    {
+      s->a += data[i];
+      s->b += s->a;
+      // Reduce well before the 32 bit sums can overflow
+      if ((i & 4095) == 4095)
+      {
+        s->a %= 65521;
+        s->b %= 65521;
+      }
+    }
+    s->a %= 65521;
+    s->b %= 65521;
+    s->out += chunk;
+    data += chunk;
+    size -= chunk;
+    s->remaining -= chunk;
+    s->block_left -= chunk;
+  }
+}
+
+/* Rows come from the render texture bottom up. The image data goes into
+   stored deflate blocks, which keeps the encoder cheap at the cost of size. */
+static void
+encode_png(rf_capture *capture, rf_capture_frame *frame)
+{
+  static const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+  size_t w = (size_t)capture->width, h = (size_t)capture->height;
+  size_t stride = w * 4;
+  size_t raw_size = h * (stride + 1);
+  size_t blocks = (raw_size + STORED_BLOCK_SIZE - 1) / STORED_BLOCK_SIZE;
+  size_t zlib_size = 2 + blocks * 5 + raw_size + 4;
+  size_t size = sizeof signature + (12 + 13) + (12 + zlib_size) + 12;
+  unsigned char *data = malloc(size);
+  frame->data = data;
+  frame->size = data ? size : 0;
+  if (!data) return;
+
+  unsigned char *out = data;
+  memcpy(out, signature, sizeof signature);
+  out += sizeof signature;
+
+  unsigned char *chunk = out;
+  out = put_u32(out, 13);
+  memcpy(out, "IHDR", 4);
+  out = put_u32(out + 4, (uint32_t)w);
+  out = put_u32(out, (uint32_t)h);
+  *(out++) = 8; // bit depth
+  *(out++) = 6; // RGBA
+  *(out++) = 0;
+  *(out++) = 0;
+  *(out++) = 0;
+  out = put_u32(out, crc32(chunk + 4, 17));
+
+  chunk = out;
+  out = put_u32(out, (uint32_t)zlib_size);
+  memcpy(out, "IDAT", 4);
+  out += 4;
+  *(out++) = 0x78;
+  *(out++) = 0x01;
+  stored_stream s = { out, raw_size, 0, 1, 0 };
+  static const unsigned char filter = 0;
+  for (size_t y = 0; y < h; ++y)
+  {
+    stored_write(&s, &filter, 1);
+    stored_write(&s, frame->pixels + (h - 1 - y) * stride, stride);
+  }
+  out = put_u32(s.out, (s.b << 16) | s.a);
+  out = put_u32(out, crc32(chunk + 4, zlib_size + 4));
+
+  chunk = out;
+  out = put_u32(out, 0);
+  memcpy(out, "IEND", 4);
+  out = put_u32(out + 4, crc32(chunk + 4, 4));
+}
+
+/* Full range BT.601 with 4:2:0 chroma, averaged over each 2x2 block. */
+static void
+encode_y4m(rf_capture *capture, rf_capture_frame *frame)
+{
+  static const char header[] = "FRAME\n";
+  int w = capture->width, h = capture->height;
+  int cw = (w + 1) / 2, ch = (h + 1) / 2;
+  size_t stride = (size_t)w * 4;
+  size_t size = (sizeof header - 1) + (size_t)w * h + (size_t)cw * ch * 2;
+  unsigned char *data = malloc(size);
+  frame->data = data;
+  frame->size = data ? size : 0;
+  if (!data) return;
+
+  memcpy(data, header, sizeof header - 1);
+  unsigned char *py = data + sizeof header - 1;
+  unsigned char *pu = py + (size_t)w * h;
+  unsigned char *pv = pu + (size_t)cw * ch;
+  for (int y = 0; y < h; ++y)
+  {
+    const unsigned char *row = frame->pixels + (size_t)(h - 1 - y) * stride;
+    for (int x = 0; x < w; ++x)
+    {
+      const unsigned char *p = row + x * 4;
+      *(py++) = (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+    }
+  }
+  for (int y = 0; y < ch; ++y)
+  {
+    int y0 = 2 * y, y1 = 2 * y + 1 < h ? 2 * y + 1 : 2 * y;
+    const unsigned char *r0 = frame->pixels + (size_t)(h - 1 - y0) * stride;
+    const unsigned char *r1 = frame->pixels + (size_t)(h - 1 - y1) * stride;
+    for (int x = 0; x < cw; ++x)
+    {
+      int x0 = 2 * x * 4, x1 = (2 * x + 1 < w ? 2 * x + 1 : 2 * x) * 4;
+      int r = (r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2) >> 2;
+      int g = (r0[x0 + 1] + r0[x1 + 1] + r1[x0 + 1] + r1[x1 + 1] + 2) >> 2;
+      int b = (r0[x0 + 2] + r0[x1 + 2] + r1[x0 + 2] + r1[x1 + 2] + 2) >> 2;
+      *(pu++) = (unsigned char)(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+      *(pv++) = (unsigned char)(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+    }
+  }
+}
+
+static void
+capture_worker(void *data)
+{
+  rf_capture *capture = data;
+  long seen = 0;
+  for (;;)
+  {
+    long job = orgf_atomic_load(&(capture->next_job));
+    rf_capture_frame *frame = &(capture->frames[job % ORGF_CAPTURE_SLOTS]);
+    if (orgf_atomic_load(&(frame->state)) == FRAME_QUEUED && frame->sequence == job)
+    {
+      if (!orgf_atomic_cas(&(capture->next_job), job, job + 1)) continue;
+      if (capture->format == RF_CAPTURE_Y4M)
+      {
+        encode_y4m(capture, frame);
+      }
+      else
+      {
+        encode_png(capture, frame);
+      }
+      frame->encoded_at = orgf_time_ns();
+      orgf_atomic_store(&(frame->state), FRAME_ENCODED);
+      orgf_signal_raise(capture->encoded);
+      continue;
+    }
+    if (!orgf_atomic_load(&(capture->running))) break;
+    seen = orgf_signal_wait(capture->queued, seen);
+  }
+}
+
+/* Runs on the writer thread, so it talks to PhysFS directly instead of
+   going through mruby. */
+static mrb_bool
+write_frame(rf_capture *capture, rf_capture_frame *frame)
+{
+  PHYSFS_File *file = capture->stream;
+  if (!file)
+  {
+    char name[1024];
+    size_t len = strlen(capture->path);
+    const char *separator = len && capture->path[len - 1] == '/' ? "" : "/";
+    int size = snprintf(name, sizeof name, "%s%s%06d.png", capture->path, separator, (int)frame->frame);
+    if (size < 0 || (size_t)size >= sizeof name) return FALSE;
+    file = PHYSFS_openWrite(name);
+    if (!file) return FALSE;
+  }
+  mrb_bool written = PHYSFS_writeBytes(file, frame->data, frame->size) == (PHYSFS_sint64)frame->size;
+  if (file != capture->stream && !PHYSFS_close(file)) written = FALSE;
+  return written;
+}
+
+/* Frames are written in the order they were captured, whichever worker
+   finished them first. */
+static void
+capture_writer(void *data)
+{
+  rf_capture *capture = data;
+  long seen = 0;
+  for (;;)
+  {
+    rf_capture_frame *frame = &(capture->frames[capture->write_tail % ORGF_CAPTURE_SLOTS]);
+    if (orgf_atomic_load(&(frame->state)) == FRAME_ENCODED)
+    {
+      frame->written = frame->data && write_frame(capture, frame);
+      capture->write_tail += 1;
+      orgf_atomic_store(&(frame->state), FRAME_WRITTEN);
+      continue;
+    }
+    if (!orgf_atomic_load(&(capture->writing))) break;
+    seen = orgf_signal_wait(capture->encoded, seen);
+  }
+}
+
+/* Hands written slots back to the capture, the stats are only ever touched
+   on the main thread. */
+static void
+reclaim_frames(rf_capture *capture)
+{
+  for (;;)
+  {
+    rf_capture_frame *frame = &(capture->frames[capture->tail % ORGF_CAPTURE_SLOTS]);
+    if (orgf_atomic_load(&(frame->state)) != FRAME_WRITTEN) break;
+    if (frame->written)
+    {
+      capture->stats.written += 1;
+    }
+    else
+    {
+      capture->stats.failed += 1;
+    }
+    free(frame->data);
+    frame->data = NULL;
+    uint64_t latency = frame->encoded_at - frame->queued_at;
+    capture->stats.latency_total += latency;
+    if (latency > capture->stats.latency_max) capture->stats.latency_max = latency;
+    capture->tail += 1;
+    orgf_atomic_store(&(frame->state), FRAME_FREE);
+  }
+}
+
+static void
+collect_readbacks(rf_capture *capture, mrb_bool wait)
+{
+  mrb_bool queued = FALSE;
+  while (capture->readback_tail < capture->readback_head)
+  {
+    mrb_int index = capture->readback_tail % ORGF_CAPTURE_READBACKS;
+    rf_readback *readback = &(capture->readbacks[index]);
+    if (!wait && !mrb_readback_ready(readback)) break;
+    capture->readback_tail += 1;
+    rf_capture_frame *frame = &(capture->frames[capture->head % ORGF_CAPTURE_SLOTS]);
+    if (orgf_atomic_load(&(frame->state)) != FRAME_FREE)
+    {
+      // Encoders are behind, the game loop never waits for them
+      mrb_readback_finish(readback, NULL);
+      capture->stats.dropped += 1;
+      continue;
+    }
+    mrb_readback_finish(readback, frame->pixels);
+    frame->sequence = capture->head;
+    frame->frame = capture->readback_frames[index];
+    frame->queued_at = orgf_time_ns();
+    capture->head += 1;
+    capture->stats.captured += 1;
+    orgf_atomic_store(&(frame->state), FRAME_QUEUED);
+    queued = TRUE;
+  }
+  if (queued) orgf_signal_raise(capture->queued);
+}
+
+rf_capture *
+mrb_capture_start(mrb_state *mrb, const char *path, mrb_int every, int width, int height, mrb_int frame_rate)
+{
+  size_t len = strlen(path);
+  enum rf_capture_format format = RF_CAPTURE_PNG;
+  if (len > 4 && !strcmp(path + len - 4, ".y4m")) format = RF_CAPTURE_Y4M;
+  PHYSFS_File *stream = NULL;
+  if (format == RF_CAPTURE_Y4M)
+  {
+    char header[96];
+    mrb_int fps = frame_rate / every;
+    if (fps < 1) fps = 1;
+    stream = PHYSFS_openWrite(path);
+    if (!stream) mrb_raisef(mrb, E_FILE_ERROR, "Unable to open file '%s' (%s)", path, PHYSFS_ERROR_STR);
+    int header_size = snprintf(header, sizeof header, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, (int)fps);
+    if (PHYSFS_writeBytes(stream, header, (PHYSFS_uint64)header_size) < header_size)
+    {
+      const char *error = PHYSFS_ERROR_STR;
+      PHYSFS_close(stream);
+      mrb_raisef(mrb, E_FILE_ERROR, "Unable to write file (%s)", error);
+    }
+  }
+  else
+  {
+    mrb_file_mkdir(mrb, path);
+  }
+
+  init_crc_table();
+  rf_capture *capture = mrb_malloc(mrb, sizeof *capture);
+  memset(capture, 0, sizeof *capture);
+  capture->format = format;
+  capture->stream = stream;
+  capture->width = width;
+  capture->height = height;
+  capture->every = every;
+  capture->path = mrb_malloc(mrb, len + 1);
+  memcpy(capture->path, path, len + 1);
+  for (int i = 0; i < ORGF_CAPTURE_SLOTS; ++i)
+  {
+    capture->frames[i].pixels = mrb_malloc(mrb, (size_t)width * height * 4);
+  }
+  for (int i = 0; i < ORGF_CAPTURE_READBACKS; ++i)
+  {
+    mrb_readback_init(&(capture->readbacks[i]));
+  }
+
+  if (!orgf_signal_init(&(capture->queued)) || !orgf_signal_init(&(capture->encoded)))
+  {
+    mrb_capture_stop(mrb, capture);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "Failed to start capture workers");
+  }
+
+  // One core stays free for the game loop itself, the writer mostly waits on the disk
+  int workers = orgf_cpu_count() - 1;
+  if (workers < 1) workers = 1;
+  if (workers > ORGF_CAPTURE_MAX_WORKERS) workers = ORGF_CAPTURE_MAX_WORKERS;
+  capture->running = 1;
+  capture->writing = 1;
+  for (int i = 0; i < workers; ++i)
+  {
+    if (!orgf_thread_start(&(capture->workers[i]), capture_worker, capture)) break;
+    capture->worker_count += 1;
+  }
+  capture->writer_started = capture->worker_count && orgf_thread_start(&(capture->writer), capture_writer, capture);
+  if (!capture->writer_started)
+  {
+    mrb_capture_stop(mrb, capture);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "Failed to start capture workers");
+  }
+  return capture;
+}
+
+void
+mrb_capture_frame(mrb_state *mrb, rf_capture *capture, rf_render_texture2d target)
+{
+  if (capture->ticks % capture->every == 0)
+  {
+    mrb_bool full = capture->readback_head - capture->readback_tail >= ORGF_CAPTURE_READBACKS;
+    mrb_bool resized = target.texture.width != capture->width || target.texture.height != capture->height;
+    if (full || resized)
+    {
+      capture->stats.dropped += 1;
+    }
+    else
+    {
+      mrb_int index = capture->readback_head % ORGF_CAPTURE_READBACKS;
+      mrb_readback_start(&(capture->readbacks[index]), target);
+      capture->readback_frames[index] = capture->ticks / capture->every;
+      capture->readback_head += 1;
+    }
+  }
+  capture->ticks += 1;
+  collect_readbacks(capture, FALSE);
+  reclaim_frames(capture);
+}
+
+void
+mrb_capture_stop(mrb_state *mrb, rf_capture *capture)
+{
+  collect_readbacks(capture, TRUE);
+  orgf_atomic_store(&(capture->running), 0);
+  if (capture->queued) orgf_signal_raise(capture->queued);
+  for (int i = 0; i < capture->worker_count; ++i)
+  {
+    orgf_thread_join(capture->workers[i]);
+  }
+  // Every queued frame is encoded by now, the writer drains them before it quits
+  orgf_atomic_store(&(capture->writing), 0);
+  if (capture->encoded) orgf_signal_raise(capture->encoded);
+  if (capture->writer_started) orgf_thread_join(capture->writer);
+  reclaim_frames(capture);
+  mrb_bool closed = capture->stream ? PHYSFS_close(capture->stream) != 0 : TRUE;
+  const char *error = closed ? NULL : PHYSFS_ERROR_STR;
+  if (capture->queued) orgf_signal_destroy(capture->queued);
+  if (capture->encoded) orgf_signal_destroy(capture->encoded);
+  for (int i = 0; i < ORGF_CAPTURE_READBACKS; ++i)
+  {
+    mrb_readback_free(&(capture->readbacks[i]));
+  }
+  for (int i = 0; i < ORGF_CAPTURE_SLOTS; ++i)
+  {
+    free(capture->frames[i].data);
+    mrb_free(mrb, capture->frames[i].pixels);
+  }
+  mrb_free(mrb, capture->path);
+  mrb_free(mrb, capture);
+  if (!closed) mrb_raisef(mrb, E_FILE_ERROR, "Unable to close file (%s)", error);
+}
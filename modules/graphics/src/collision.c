@@ -0,0 +1,135 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <orgf/collision.h>
+#include <orgf/simd.h>
+
+#ifdef ORGF_SIMD_SSE2
+/* Alpha of 16 RGBA pixels compared against the threshold, one bit each. */
+static inline uint64_t
+solid_rgba16(const unsigned char *src, __m128i threshold)
+{
+  __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(src)), 24);
+  __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(src + 16)), 24);
+  __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(src + 32)), 24);
+  __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(src + 48)), 24);
+  __m128i alpha = _mm_packus_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(a2, a3));
+  __m128i solid = _mm_cmpeq_epi8(_mm_max_epu8(alpha, threshold), alpha);
+  return (uint64_t)(unsigned)_mm_movemask_epi8(solid);
+}
+#endif
+
+static void
+build_row(const unsigned char *ORGF_RESTRICT src, uint64_t *ORGF_RESTRICT row, int width, int bpp, int offset, int threshold)
+{
+  int x = 0;
+#ifdef ORGF_SIMD_SSE2
+  if (bpp == 4)
+  {
+    __m128i vthreshold = _mm_set1_epi8((char)threshold);
+    for (; x + 16 <= width; x += 16)
+    {
+      row[x >> 6] |= solid_rgba16(src + x * 4, vthreshold) << (x & 63);
+    }
+  }
+#endif
+  for (; x < width; ++x)
+  {
+    if (src[x * bpp + offset] >= threshold) row[x >> 6] |= (uint64_t)1 << (x & 63);
+  }
+}
+
+rf_collision_mask *
+mrb_collision_mask_new(mrb_state *mrb, rf_image *image, int threshold)
+{
+  if (threshold < 1) threshold = 1;
+  if (threshold > 255) threshold = 255;
+  rf_collision_mask *mask = mrb_malloc(mrb, sizeof *mask);
+  mask->width = image->width;
+  mask->height = image->height;
+  mask->stride = (image->width + 63) / 64;
+  mask->threshold = threshold;
+  size_t words = (size_t)mask->stride * (size_t)mask->height;
+  mask->bits = mrb_malloc(mrb, words ? words * sizeof(uint64_t) : sizeof(uint64_t));
+  int bpp, offset;
+  switch (image->format)
+  {
+    case RF_UNCOMPRESSED_R8G8B8A8: bpp = 4; offset = 3; break;
+    case RF_UNCOMPRESSED_GRAY_ALPHA: bpp = 2; offset = 1; break;
+    default: bpp = 0; offset = 0; break;
+  }
+  memset(mask->bits, 0, words * sizeof(uint64_t));
+  if (!bpp || !image->data)
+  {
+    // Without an alpha channel every pixel is solid
+    for (int y = 0; y < mask->height; ++y)
+    {
+      uint64_t *row = mask->bits + (size_t)y * mask->stride;
+      for (int x = 0; x < mask->width; x += 64)
+      {
+        int count = mask->width - x;
+        row[x >> 6] = count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+      }
+    }
+    return mask;
+  }
+  const unsigned char *pixels = image->data;
+  for (int y = 0; y < mask->height; ++y)
+  {
+    build_row(pixels + (size_t)y * image->width * bpp, mask->bits + (size_t)y * mask->stride,
+              mask->width, bpp, offset, threshold);
+  }
+  return mask;
+}
+
+void
+mrb_collision_mask_free(mrb_state *mrb, rf_collision_mask *mask)
+{
+  if (!mask) return;
+  mrb_free(mrb, mask->bits);
+  mrb_free(mrb, mask);
+}
+
+static inline uint64_t
+reverse_bits(uint64_t v)
+{
+  v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+  v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+  v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+  v = ((v >> 16) & 0x0000FFFF0000FFFFULL) | ((v & 0x0000FFFF0000FFFFULL) << 16);
+  return (v >> 32) | (v << 32);
+}
+
+static uint64_t
+extract(rf_collision_mask *mask, const uint64_t *row, int x, int count)
+{
+  if (count <= 0) return 0;
+  if (x < 0)
+  {
+    if (x + count <= 0) return 0;
+    return extract(mask, row, 0, count + x) << -x;
+  }
+  int word = x >> 6;
+  int shift = x & 63;
+  if (word >= mask->stride) return 0;
+  uint64_t v = row[word] >> shift;
+  if (shift && word + 1 < mask->stride) v |= row[word + 1] << (64 - shift);
+  if (count < 64) v &= ((uint64_t)1 << count) - 1;
+  return v;
+}
+
+uint64_t
+mrb_collision_mask_row(rf_collision_mask *mask, int x, int y, int count, mrb_bool flip)
+{
+  if (y < 0 || y >= mask->height || count <= 0) return 0;
+  if (count > 64) count = 64;
+  const uint64_t *row = mask->bits + (size_t)y * mask->stride;
+  if (!flip) return extract(mask, row, x, count);
+  // Read x - count + 1 .. x and mirror, so bit 0 is the pixel at x
+  uint64_t v = extract(mask, row, x - count + 1, count);
+  return reverse_bits(v) >> (64 - count);
+}
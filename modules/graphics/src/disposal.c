@@ -0,0 +1,99 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <string.h>
+
+#include <orgf/disposal.h>
+#include <orgf/thread.h>
+
+static rf_disposal_queue queue = { NULL, 0, 0, 0, ORGF_DISPOSAL_BUDGET };
+
+rf_disposal_queue *
+mrb_get_disposal_queue(void)
+{
+  return &queue;
+}
+
+static void
+push(mrb_state *mrb, rf_disposal *entry)
+{
+  if (!queue.open) return;
+  if (queue.head + queue.count >= queue.capa)
+  {
+    // Drained entries at the front make room before the array grows
+    if (queue.head)
+    {
+      memmove(queue.entries, queue.entries + queue.head, (size_t)queue.count * sizeof *queue.entries);
+      queue.head = 0;
+    }
+    if (queue.count >= queue.capa)
+    {
+      mrb_int capa = queue.capa ? queue.capa * 2 : 64;
+      queue.entries = mrb_realloc(mrb, queue.entries, (size_t)capa * sizeof *queue.entries);
+      queue.capa = capa;
+    }
+  }
+  queue.entries[queue.head + queue.count] = *entry;
+  queue.count += 1;
+  queue.queued += 1;
+  queue.queued_bytes += entry->bytes;
+}
+
+void
+mrb_dispose_texture(mrb_state *mrb, rf_texture2d texture, size_t bytes)
+{
+  if (!texture.id) return;
+  rf_disposal entry = { RF_DISPOSE_TEXTURE };
+  entry.texture = texture;
+  entry.bytes = bytes;
+  push(mrb, &entry);
+}
+
+void
+mrb_dispose_render_texture(mrb_state *mrb, rf_render_texture2d target, size_t bytes)
+{
+  if (!target.id && !target.texture.id) return;
+  rf_disposal entry = { RF_DISPOSE_RENDER_TEXTURE };
+  entry.target = target;
+  entry.bytes = bytes;
+  push(mrb, &entry);
+}
+
+static void
+release(rf_disposal *entry)
+{
+  if (entry->type == RF_DISPOSE_TEXTURE) rf_unload_texture(entry->texture);
+  else rf_unload_render_texture(entry->target);
+  queue.released += 1;
+  queue.released_bytes += entry->bytes;
+}
+
+void
+mrb_disposal_drain(mrb_state *mrb, mrb_bool all)
+{
+  uint64_t start = orgf_time_ns();
+  while (queue.count > 0)
+  {
+    release(queue.entries + queue.head);
+    queue.head += 1;
+    queue.count -= 1;
+    if (!all && orgf_time_ns() - start >= queue.budget) break;
+  }
+  if (!queue.count) queue.head = 0;
+}
+
+void
+mrb_disposal_open(void)
+{
+  queue.open = TRUE;
+}
+
+void
+mrb_disposal_close(mrb_state *mrb)
+{
+  mrb_disposal_drain(mrb, TRUE);
+  mrb_free(mrb, queue.entries);
+  queue.entries = NULL;
+  queue.capa = 0;
+  queue.open = FALSE;
+}
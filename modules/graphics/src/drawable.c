@@ -1,6 +1,7 @@
 #include <mruby.h>
 
 #include <orgf/drawable.h>
+#include <orgf/stats.h>
 
 static int
 sort_by_z(const void *a, const void *b)
@@ -32,8 +33,10 @@ mrb_container_init(mrb_state *mrb, rf_container *container)
 {
   container->base.z = 0;
   container->base.container = NULL;
+  container->base.tick = (rf_drawable_update_callback)mrb_container_tick;
   container->base.update = (rf_drawable_update_callback)mrb_container_update;
   container->base.draw   = (rf_drawable_draw_callback)mrb_container_draw_children;
+  container->base.draw_run = NULL;
   container->items_capa = 7;
   container->items_size = 0;
   container->items = mrb_malloc(mrb, 7 * sizeof(*(container->items)));
@@ -91,14 +94,34 @@ mrb_container_remove_child(mrb_state *mrb, rf_container *parent, rf_drawable *ch
   }
 }
 
-void
-mrb_container_update(mrb_state *mrb, rf_container *container)
+static void
+sort_items(rf_container *container)
 {
   if (container->dirty)
   {
     container->dirty = FALSE;
     qsort(container->items, container->items_size, sizeof(*(container->items)), sort_by_z);
   }
+}
+
+void
+mrb_container_tick(mrb_state *mrb, rf_container *container)
+{
+  sort_items(container);
+  for (mrb_int i = 0; i < container->items_size; ++i)
+  {
+    rf_drawable *item = container->items[i];
+    if (item->visible && item->tick)
+    {
+      item->tick(mrb, item);
+    }
+  }
+}
+
+void
+mrb_container_update(mrb_state *mrb, rf_container *container)
+{
+  sort_items(container);
   for (mrb_int i = 0; i < container->items_size; ++i)
   {
     rf_drawable *item = container->items[i];
@@ -119,13 +142,24 @@ mrb_container_draw_children(mrb_state *mrb, rf_container *container)
   for (mrb_int i = 0; i < container->items_size; ++i)
   {
     rf_drawable *item = container->items[i];
-    if (item->visible)
+    if (item->draw_run)
     {
-      rf_drawable_draw_callback draw = item->draw;
-      if (draw)
-      {
-        draw(mrb, container->items[i]);
-      }
+      // Consecutive drawables of the same kind draw as one run, culling their own
+      mrb_int end = i + 1;
+      while (end < container->items_size && container->items[end]->draw_run == item->draw_run) ++end;
+      ORGF_STATS_ADD(visited, end - i);
+      item->draw_run(mrb, container->items + i, end - i);
+      i = end - 1;
+      continue;
+    }
+    ORGF_STATS_ADD(visited, 1);
+    if (item->visible && item->draw)
+    {
+      item->draw(mrb, container->items[i]);
+    }
+    else
+    {
+      ORGF_STATS_ADD(culled, 1);
     }
   }
 }
@@ -1,25 +1,62 @@
 #include <mruby.h>
 #include <mruby/class.h>
 #include <mruby/data.h>
+#include <mruby/hash.h>
 #include <mruby/string.h>
 #include <mruby/variable.h>
 
 #include <orgf/alloc.h>
+#include <orgf/color.h>
 #include <orgf/file.h>
 #include <orgf/font.h>
+#include <orgf/glyphs.h>
+#include <orgf/graphics.h>
+#include <orgf/sdf.h>
+#include <orgf/thread.h>
 
 #include <rayfork.h>
+#include <math.h>
+#include <string.h>
 
 #define NAME mrb_intern_lit(mrb, "#name")
 #define SIZE mrb_intern_lit(mrb, "#size")
+#define COLOR mrb_intern_lit(mrb, "#color")
+#define OUT_COLOR mrb_intern_lit(mrb, "#out_color")
+
+static rf_font_face *faces = NULL;
+static rf_font_stats stats = { 0 };
+
+rf_font_stats *
+mrb_get_font_stats(void)
+{
+  return &stats;
+}
+
+static void
+release_face(mrb_state *mrb, rf_font_face *face)
+{
+  face->refs -= 1;
+  if (face->refs > 0) return;
+  rf_font_face **link = &faces;
+  while (*link != face) link = &((*link)->next);
+  *link = face->next;
+  stats.faces -= 1;
+  stats.face_bytes -= (size_t)face->field.width * (size_t)face->field.height;
+  mrb_free(mrb, face->field.data);
+  mrb_free(mrb, face->font.glyphs);
+  mrb_free(mrb, face->path);
+  mrb_free(mrb, face);
+}
 
 static void
 free_font(mrb_state *mrb, void *ptr)
 {
   if (ptr)
   {
-    rf_font *font = (rf_font *)ptr;
-    rf_unload_font(*font, mrb_get_allocator(mrb));
+    rf_text_font *font = (rf_text_font *)ptr;
+    // The default font belongs to rayfork and outlives every Font using it
+    if (font->face) release_face(mrb, font->face);
+    if (font->glyphs) mrb_glyph_source_release(mrb, font->glyphs);
     mrb_free(mrb, font);
   }
 }
@@ -32,14 +69,118 @@ static const char *FONT_EXTENSIONS[] = {
   NULL,
 };
 
+/* Rasterizes every glyph on the CPU, padded by the spread, and turns each
+   one into its own cell of the field. */
+static void
+build_field(mrb_state *mrb, rf_font_face *face, rf_cached_glyph **base, mrb_int count)
+{
+  int spread = ORGF_SDF_SPREAD;
+  int atlas_width = ORGF_SDF_ATLAS_WIDTH;
+  rf_glyph_info *glyphs = mrb_malloc(mrb, (count ? count : 1) * sizeof *glyphs);
+  // Shelf packing, every glyph keeps spread pixels of room for its field
+  int x = 0, y = 0, shelf = 0;
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    int w = base[i]->width + spread * 2;
+    int h = base[i]->height + spread * 2;
+    if (w > atlas_width) atlas_width = w;
+    if (x + w > atlas_width)
+    {
+      x = 0;
+      y += shelf;
+      shelf = 0;
+    }
+    glyphs[i] = (rf_glyph_info){ 0 };
+    glyphs[i].codepoint = base[i]->codepoint;
+    glyphs[i].rec = (rf_rec){ x, y, w, h };
+    glyphs[i].offset_x = base[i]->offset_x - spread;
+    glyphs[i].offset_y = base[i]->offset_y - spread;
+    glyphs[i].advance_x = (int)(base[i]->advance + 0.5f);
+    x += w;
+    if (h > shelf) shelf = h;
+  }
+  int atlas_height = y + shelf;
+  unsigned char *field = mrb_malloc(mrb, (size_t)atlas_width * (size_t)(atlas_height ? atlas_height : 1));
+  memset(field, 0, (size_t)atlas_width * (size_t)atlas_height);
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    int w = (int)glyphs[i].rec.width, h = (int)glyphs[i].rec.height;
+    unsigned char *cell = mrb_malloc(mrb, (size_t)w * (size_t)h * 2);
+    unsigned char *out = cell + (size_t)w * h;
+    memset(cell, 0, (size_t)w * h);
+    mrb_glyph_rasterize_into(base[i], cell + (size_t)spread * w + spread, w);
+    mrb_sdf_generate(mrb, cell, w, h, spread, out);
+    for (int j = 0; j < h; ++j)
+    {
+      memcpy(field + (size_t)((int)glyphs[i].rec.y + j) * atlas_width + (int)glyphs[i].rec.x, out + (size_t)j * w, w);
+    }
+    mrb_free(mrb, cell);
+  }
+  face->font = (rf_font){ 0 };
+  face->font.base_size = ORGF_SDF_BASE_SIZE;
+  face->font.glyphs = glyphs;
+  face->font.glyphs_count = (int)count;
+  face->font.valid = true;
+  face->field = (rf_image){ 0 };
+  face->field.data = field;
+  face->field.width = atlas_width;
+  face->field.height = atlas_height;
+  face->field.format = RF_UNCOMPRESSED_GRAYSCALE;
+  face->field.valid = true;
+}
+
+/* Everything happens on the CPU, so faces load before Graphics starts too. */
+static rf_font_face *
+load_face(mrb_state *mrb, const char *path)
+{
+  for (rf_font_face *face = faces; face; face = face->next)
+  {
+    if (strcmp(face->path, path)) continue;
+    face->refs += 1;
+    stats.face_hits += 1;
+    return face;
+  }
+  uint64_t start = orgf_time_ns();
+  rf_glyph_source *source = mrb_glyph_source_load(mrb, path, FONT_EXTENSIONS);
+  if (!source) return NULL;
+  // The printable ASCII range, the characters rayfork loads by default
+  char text[ORGF_SDF_CODEPOINTS];
+  rf_cached_glyph *glyphs[ORGF_SDF_CODEPOINTS];
+  for (int i = 0; i < ORGF_SDF_CODEPOINTS; ++i) text[i] = (char)(ORGF_SDF_FIRST_CODEPOINT + i);
+  mrb_int count = mrb_glyph_cache_layout(mrb, source, ORGF_SDF_BASE_SIZE, text, ORGF_SDF_CODEPOINTS, glyphs, FALSE);
+  rf_font_face *face = mrb_malloc(mrb, sizeof *face);
+  size_t len = strlen(path);
+  face->path = mrb_malloc(mrb, len + 1);
+  memcpy(face->path, path, len + 1);
+  face->refs = 1;
+  build_field(mrb, face, glyphs, count);
+  // The metrics were copied, only the field is needed from now on
+  mrb_glyph_source_release(mrb, source);
+  face->next = faces;
+  faces = face;
+  stats.faces += 1;
+  stats.face_bytes += (size_t)face->field.width * (size_t)face->field.height;
+  stats.face_time += orgf_time_ns() - start;
+  return face;
+}
+
+/* rayfork's own font, which only exists once Graphics made its context. */
+static rf_font *
+context_font(mrb_state *mrb, rf_text_font *font)
+{
+  if (!font->font.valid && mrb_graphics_is_open(mrb)) font->font = rf_get_default_font();
+  return &(font->font);
+}
+
 static mrb_value
 mrb_font_initialize(mrb_state *mrb, mrb_value self)
 {
-  mrb_bool antialias;
+  mrb_bool antialias, sdf;
   mrb_int size;
   const char *filename;
-  mrb_int argc = mrb_get_args(mrb, "|zib", &filename, &size, &antialias);
+  mrb_int argc = mrb_get_args(mrb, "|zibb", &filename, &size, &antialias, &sdf);
   DATA_TYPE(self) = &mrb_font_data_type;
+  if (argc < 4) sdf = mrb_get_default_font_sdf(mrb);
   if (argc < 3) antialias = mrb_get_default_font_antialias(mrb);
   if (argc < 2) size = mrb_get_default_font_size(mrb);
   if (argc < 1) filename = mrb_get_default_font_name(mrb);
@@ -54,24 +195,40 @@ mrb_font_initialize(mrb_state *mrb, mrb_value self)
   {
     mrb_raise(mrb, E_ARGUMENT_ERROR, "Font size must be positive");
   }
-  rf_allocator alloc = mrb_get_allocator(mrb);
-  rf_io_callbacks io = mrb_get_io_callbacks_for_extensions(mrb, FONT_EXTENSIONS);
-  rf_font_antialias aa = antialias ? RF_FONT_ANTIALIAS : RF_FONT_NO_ANTIALIAS;
-  rf_font *data = mrb_malloc(mrb, sizeof *data);
+  rf_text_font *data = mrb_malloc(mrb, sizeof *data);
+  memset(data, 0, sizeof *data);
   DATA_PTR(self) = data;
+  data->size = size;
+  data->antialias = antialias;
   if (filename)
   {
     int arena = mrb_gc_arena_save(mrb);
     const char *new_filename = mrb_filesystem_join(mrb, "Fonts", filename);
-    *data = rf_load_ttf_font_from_file(new_filename, (int)size, aa, alloc, alloc, io);
+    if (sdf) data->face = load_face(mrb, new_filename);
+    if (data->face)
+    {
+      data->font = data->face->font;
+    }
+    else
+    {
+      // Glyphs are rasterized as text needs them, whatever the size
+      data->glyphs = mrb_glyph_source_load(mrb, new_filename, FONT_EXTENSIONS);
+      if (!data->glyphs) mrb_raisef(mrb, E_LOAD_ERROR, "Cannot load font '%s'", filename);
+    }
     mrb_iv_set(mrb, self, NAME, mrb_str_new_cstr(mrb, filename));
     mrb_gc_arena_restore(mrb, arena);
   }
   else
   {
-    *data = rf_get_default_font();
+    context_font(mrb, data);
     mrb_iv_set(mrb, self, NAME, mrb_nil_value());
   }
+  mrb_value color = mrb_color_white(mrb);
+  mrb_value out_color = mrb_color_new(mrb, 0, 0, 0, 128);
+  data->color = mrb_get_color(mrb, color);
+  data->out_color = mrb_get_color(mrb, out_color);
+  mrb_iv_set(mrb, self, COLOR, color);
+  mrb_iv_set(mrb, self, OUT_COLOR, out_color);
   mrb_iv_set(mrb, self, SIZE, mrb_fixnum_value(size));
   return self;
 }
@@ -88,32 +245,437 @@ mrb_font_get_size(mrb_state *mrb, mrb_value self)
   return mrb_iv_get(mrb, self, SIZE);
 }
 
+static mrb_value
+mrb_font_get_color(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, COLOR);
+}
+
+static mrb_value
+mrb_font_get_out_color(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, OUT_COLOR);
+}
+
+static mrb_value
+mrb_font_get_outline(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_font(mrb, self)->outline);
+}
+
+static mrb_value
+mrb_font_set_outline(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  mrb_get_args(mrb, "b", &value);
+  mrb_get_font(mrb, self)->outline = value;
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_font_get_shadow(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_font(mrb, self)->shadow);
+}
+
+static mrb_value
+mrb_font_set_shadow(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  mrb_get_args(mrb, "b", &value);
+  mrb_get_font(mrb, self)->shadow = value;
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_font_sdfQ(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_font(mrb, self)->face ? TRUE : FALSE);
+}
+
+static rf_glyph_info *
+find_glyph(rf_font *font, int codepoint)
+{
+  for (int i = 0; i < font->glyphs_count; ++i)
+  {
+    if (font->glyphs[i].codepoint == codepoint) return font->glyphs + i;
+  }
+  return NULL;
+}
+
+static inline float
+glyph_advance(rf_glyph_info *glyph)
+{
+  // Glyphs the font gives no advance take their own width
+  return glyph->advance_x ? (float)glyph->advance_x : glyph->rec.width - ORGF_SDF_SPREAD * 2;
+}
+
+static float
+face_text_width(rf_font_face *face, const char *text, mrb_int length)
+{
+  float width = 0;
+  mrb_int i = 0;
+  while (i < length)
+  {
+    rf_glyph_info *glyph = find_glyph(&(face->font), mrb_next_codepoint(text, length, &i));
+    if (glyph) width += glyph_advance(glyph);
+  }
+  return width;
+}
+
+static float
+cached_text_width(mrb_state *mrb, rf_glyph_source *source, int size, const char *text, mrb_int length)
+{
+  rf_cached_glyph **glyphs = mrb_malloc(mrb, (length ? length : 1) * sizeof *glyphs);
+  // Measuring only needs the metrics, nothing gets rasterized
+  mrb_int count = mrb_glyph_cache_layout(mrb, source, size, text, length, glyphs, FALSE);
+  float width = 0;
+  for (mrb_int i = 0; i < count; ++i) width += glyphs[i]->advance;
+  mrb_free(mrb, glyphs);
+  return width;
+}
+
 static mrb_value
 mrb_font_measure_text(mrb_state *mrb, mrb_value self)
 {
   const char *text;
   mrb_int height;
-  rf_font *font = mrb_get_font(mrb, self);
+  rf_text_font *font = mrb_get_font(mrb, self);
   if (mrb_get_args(mrb, "z|i", &text, &height) < 2)
   {
-    height = font->base_size;
+    height = font->face || font->glyphs ? font->size : context_font(mrb, font)->base_size;
   }
-  rf_sizef size = rf_measure_text(*font, text, (float)rf_font_height(*font, (float)height), 0);
+  if (font->glyphs)
+  {
+    if (height < 1) return mrb_float_value(mrb, 0);
+    return mrb_float_value(mrb, cached_text_width(mrb, font->glyphs, (int)height, text, (mrb_int)strlen(text)));
+  }
+  if (font->face)
+  {
+    float scale = (float)height / (float)font->face->font.base_size;
+    return mrb_float_value(mrb, face_text_width(font->face, text, (mrb_int)strlen(text)) * scale);
+  }
+  rf_font *base = context_font(mrb, font);
+  if (!base->valid) return mrb_float_value(mrb, 0);
+  rf_sizef size = rf_measure_text(*base, text, (float)rf_font_height(*base, (float)height), 0);
   return mrb_float_value(mrb, size.width);
 }
 
+/* Grows touched to hold the pixels from x0, y0 up to x1, y1. */
+static void
+touch(rf_rec *touched, int x0, int y0, int x1, int y1)
+{
+  if (!touched || x1 <= x0 || y1 <= y0) return;
+  if (touched->width <= 0 || touched->height <= 0)
+  {
+    *touched = (rf_rec){ x0, y0, x1 - x0, y1 - y0 };
+    return;
+  }
+  float right = touched->x + touched->width, bottom = touched->y + touched->height;
+  if (x0 < touched->x) touched->x = x0;
+  if (y0 < touched->y) touched->y = y0;
+  if (x1 > right) right = x1;
+  if (y1 > bottom) bottom = y1;
+  touched->width = right - touched->x;
+  touched->height = bottom - touched->y;
+}
+
+static inline float
+smoothstep(float edge0, float edge1, float x)
+{
+  float t = (x - edge0) / (edge1 - edge0);
+  t = t < 0 ? 0 : t > 1 ? 1 : t;
+  return t * t * (3 - 2 * t);
+}
+
+/* Bilinear sample of the field inside one glyph's cell, 0 outside it. */
+static float
+sample_field(rf_image *field, rf_rec cell, float u, float v)
+{
+  u -= 0.5f;
+  v -= 0.5f;
+  int x0 = (int)floorf(u), y0 = (int)floorf(v);
+  float fx = u - x0, fy = v - y0;
+  const unsigned char *data = field->data;
+  float value = 0;
+  for (int j = 0; j < 2; ++j)
+  {
+    int y = y0 + j;
+    if (y < cell.y || y >= cell.y + cell.height) continue;
+    for (int i = 0; i < 2; ++i)
+    {
+      int x = x0 + i;
+      if (x < cell.x || x >= cell.x + cell.width) continue;
+      float weight = (i ? fx : 1 - fx) * (j ? fy : 1 - fy);
+      value += weight * data[(size_t)y * field->width + x];
+    }
+  }
+  return value / 255.0f;
+}
+
+/* Coverage of a distance d against an edge, soft on both sides of it
+   unless the font turns antialiasing off. */
+static inline float
+edge_coverage(rf_text_font *font, float edge, float soft, float d)
+{
+  if (!font->antialias) return d >= edge ? 1.0f : 0.0f;
+  return smoothstep(edge - soft, edge + soft, d);
+}
+
+static inline void
+blend_pixel(unsigned char *p, rf_color color, float coverage)
+{
+  float sa = coverage * color.a / 255.0f;
+  if (sa <= 0) return;
+  float da = p[3] / 255.0f;
+  float oa = sa + da * (1 - sa);
+  unsigned char c[3] = { color.r, color.g, color.b };
+  for (int k = 0; k < 3; ++k) p[k] = (unsigned char)((c[k] * sa + p[k] * da * (1 - sa)) / oa + 0.5f);
+  p[3] = (unsigned char)(oa * 255 + 0.5f);
+}
+
+/* The same smoothstep a distance field shader would run, evaluated for the
+   pixels a glyph covers, with a one pixel outline and shadow. Fonts without
+   antialias cut the field at its edge instead. */
+static void
+draw_glyph(rf_text_font *font, rf_glyph_info *glyph, rf_image *image, float qx, float qy, float scale, rf_rec clip,
+           rf_rec *touched)
+{
+  rf_image *field = &(font->face->field);
+  rf_rec cell = glyph->rec;
+  float pixel = 1.0f / (ORGF_SDF_SPREAD * 2 * scale);
+  float soft = pixel * 0.5f;
+  float outline = font->outline ? pixel : 0;
+  int x0 = (int)floorf(qx), y0 = (int)floorf(qy);
+  int x1 = (int)ceilf(qx + cell.width * scale) + 1, y1 = (int)ceilf(qy + cell.height * scale) + 1;
+  if (x0 < clip.x) x0 = (int)clip.x;
+  if (y0 < clip.y) y0 = (int)clip.y;
+  if (x1 > clip.x + clip.width) x1 = (int)(clip.x + clip.width);
+  if (y1 > clip.y + clip.height) y1 = (int)(clip.y + clip.height);
+  touch(touched, x0, y0, x1, y1);
+  rf_color fill = *(font->color);
+  rf_color out = *(font->out_color);
+  rf_color shadow = { 0, 0, 0, fill.a };
+  unsigned char *pixels = image->data;
+  for (int y = y0; y < y1; ++y)
+  {
+    float v = cell.y + (y + 0.5f - qy) / scale;
+    for (int x = x0; x < x1; ++x)
+    {
+      float u = cell.x + (x + 0.5f - qx) / scale;
+      unsigned char *p = pixels + ((size_t)y * image->width + x) * 4;
+      if (font->shadow)
+      {
+        float ds = sample_field(field, cell, u - 1 / scale, v - 1 / scale);
+        blend_pixel(p, shadow, edge_coverage(font, 0.5f - outline, soft, ds));
+      }
+      float d = sample_field(field, cell, u, v);
+      if (font->outline) blend_pixel(p, out, edge_coverage(font, 0.5f - outline, soft, d));
+      blend_pixel(p, fill, edge_coverage(font, 0.5f, soft, d));
+    }
+  }
+}
+
+static void
+draw_face_run(rf_text_font *font, rf_image *image, float x, float y, rf_rec clip, const char *text, mrb_int length,
+              rf_rec *touched)
+{
+  rf_font_face *face = font->face;
+  float scale = (float)font->size / (float)face->font.base_size;
+  mrb_int i = 0;
+  while (i < length)
+  {
+    rf_glyph_info *glyph = find_glyph(&(face->font), mrb_next_codepoint(text, length, &i));
+    if (!glyph) continue;
+    draw_glyph(font, glyph, image, x + glyph->offset_x * scale, y + glyph->offset_y * scale, scale, clip, touched);
+    x += glyph_advance(glyph) * scale;
+  }
+}
+
+static inline float
+coverage_at(rf_text_font *font, rf_cached_glyph *glyph, int x, int y)
+{
+  if (x < 0 || y < 0 || x >= glyph->width || y >= glyph->height) return 0;
+  unsigned char value = mrb_cached_glyph_row(glyph, y)[x];
+  if (!font->antialias) return value >= 128 ? 1.0f : 0.0f;
+  return value / 255.0f;
+}
+
+/* Blends the cached coverage of a glyph with its top left corner at gx, gy,
+   the outline grows it by one pixel and the shadow sits one pixel down right. */
+static void
+blit_glyph(rf_text_font *font, rf_cached_glyph *glyph, rf_image *image, int gx, int gy, rf_rec clip, rf_rec *touched)
+{
+  int x0 = gx - 1, y0 = gy - 1;
+  int x1 = gx + glyph->width + 2, y1 = gy + glyph->height + 2;
+  if (x0 < clip.x) x0 = (int)clip.x;
+  if (y0 < clip.y) y0 = (int)clip.y;
+  if (x1 > clip.x + clip.width) x1 = (int)(clip.x + clip.width);
+  if (y1 > clip.y + clip.height) y1 = (int)(clip.y + clip.height);
+  touch(touched, x0, y0, x1, y1);
+  rf_color fill = *(font->color);
+  rf_color out = *(font->out_color);
+  rf_color shadow = { 0, 0, 0, fill.a };
+  unsigned char *pixels = image->data;
+  for (int y = y0; y < y1; ++y)
+  {
+    int v = y - gy;
+    for (int x = x0; x < x1; ++x)
+    {
+      int u = x - gx;
+      unsigned char *p = pixels + ((size_t)y * image->width + x) * 4;
+      if (font->shadow) blend_pixel(p, shadow, coverage_at(font, glyph, u - 1, v - 1));
+      if (font->outline)
+      {
+        float edge = 0;
+        for (int j = -1; j <= 1; ++j)
+        {
+          for (int i = -1; i <= 1; ++i)
+          {
+            float c = coverage_at(font, glyph, u + i, v + j);
+            if (c > edge) edge = c;
+          }
+        }
+        blend_pixel(p, out, edge);
+      }
+      blend_pixel(p, fill, coverage_at(font, glyph, u, v));
+    }
+  }
+}
+
+static void
+draw_cached_run(mrb_state *mrb, rf_text_font *font, rf_image *image, float x, float y, rf_rec clip,
+                const char *text, mrb_int length, rf_rec *touched)
+{
+  rf_cached_glyph **glyphs = mrb_malloc(mrb, (length ? length : 1) * sizeof *glyphs);
+  mrb_int count = mrb_glyph_cache_layout(mrb, font->glyphs, (int)font->size, text, length, glyphs, TRUE);
+  int top = (int)floorf(y + 0.5f);
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    rf_cached_glyph *glyph = glyphs[i];
+    if (glyph->page >= 0)
+    {
+      blit_glyph(font, glyph, image, (int)floorf(x + 0.5f) + glyph->offset_x, top + glyph->offset_y, clip, touched);
+    }
+    x += glyph->advance;
+  }
+  mrb_free(mrb, glyphs);
+}
+
+float
+mrb_font_text_width(mrb_state *mrb, rf_text_font *font, const char *text, mrb_int length)
+{
+  if (font->glyphs) return cached_text_width(mrb, font->glyphs, (int)font->size, text, length);
+  if (font->face)
+  {
+    float scale = (float)font->size / (float)font->face->font.base_size;
+    return face_text_width(font->face, text, length) * scale;
+  }
+  return 0;
+}
+
+void
+mrb_font_draw_run(mrb_state *mrb, rf_text_font *font, rf_image *image, float x, float y, rf_rec clip,
+                  const char *text, mrb_int length, rf_rec *touched)
+{
+  if (clip.x < 0) { clip.width += clip.x; clip.x = 0; }
+  if (clip.y < 0) { clip.height += clip.y; clip.y = 0; }
+  if (clip.x + clip.width > image->width) clip.width = image->width - clip.x;
+  if (clip.y + clip.height > image->height) clip.height = image->height - clip.y;
+  if (clip.width <= 0 || clip.height <= 0) return;
+  if (font->face) draw_face_run(font, image, x, y, clip, text, length, touched);
+  else if (font->glyphs) draw_cached_run(mrb, font, image, x, y, clip, text, length, touched);
+}
+
+mrb_bool
+mrb_font_draw_text(mrb_state *mrb, rf_text_font *font, rf_image *image, rf_rec rect, const char *text, mrb_int length,
+                   int align, rf_rec *touched)
+{
+  if (!mrb_font_cpu_p(font) || !image->data || image->format != RF_UNCOMPRESSED_R8G8B8A8) return FALSE;
+  float x = rect.x;
+  if (align)
+  {
+    float width = mrb_font_text_width(mrb, font, text, length);
+    if (align == 1) x += (rect.width - width) / 2;
+    else if (align == 2) x += rect.width - width;
+  }
+  float y = rect.y + (rect.height - (float)font->size) / 2;
+  mrb_font_draw_run(mrb, font, image, x, y, rect, text, length, touched);
+  return TRUE;
+}
+
+static mrb_value
+mrb_font_s_atlas_stats(mrb_state *mrb, mrb_value self)
+{
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "sdf_faces")), mrb_fixnum_value(stats.faces));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "sdf_bytes")), mrb_fixnum_value((mrb_int)stats.face_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "sdf_time")), mrb_float_value(mrb, (mrb_float)stats.face_time / 1e6));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "sdf_hits")), mrb_fixnum_value(stats.face_hits));
+  return hash;
+}
+
+static mrb_value
+mrb_font_s_glyph_cache_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_glyph_cache *cache = mrb_get_glyph_cache();
+  mrb_value hash = mrb_hash_new(mrb);
+  size_t page_bytes = (size_t)cache->page_count * ORGF_GLYPH_PAGE_SIZE * ORGF_GLYPH_PAGE_SIZE;
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "pages")), mrb_fixnum_value(cache->page_count));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "page_bytes")), mrb_fixnum_value((mrb_int)page_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "glyphs")), mrb_fixnum_value(cache->glyphs));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "sources")), mrb_fixnum_value(cache->sources));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "source_bytes")), mrb_fixnum_value((mrb_int)cache->source_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "rasterizations")), mrb_fixnum_value(cache->rasterizations));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "recycled")), mrb_fixnum_value(cache->recycled));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "hits")), mrb_fixnum_value(cache->hits));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "misses")), mrb_fixnum_value(cache->misses));
+  return hash;
+}
+
+static mrb_value
+mrb_font_s_get_glyph_pages(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_get_glyph_cache()->page_limit);
+}
+
+static mrb_value
+mrb_font_s_set_glyph_pages(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  mrb_get_args(mrb, "i", &value);
+  if (value < 1)
+  {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "At least one glyph page is needed");
+  }
+  mrb_glyph_cache_set_page_limit(mrb, value);
+  return mrb_fixnum_value(value);
+}
+
 void
 mrb_init_orgf_font(mrb_state *mrb)
 {
   struct RClass *font = mrb_define_class(mrb, "Font", mrb->object_class);
   MRB_SET_INSTANCE_TT(font, MRB_TT_DATA);
 
-  mrb_define_method(mrb, font, "initialize", mrb_font_initialize, MRB_ARGS_OPT(3));
+  mrb_define_method(mrb, font, "initialize", mrb_font_initialize, MRB_ARGS_OPT(4));
 
   mrb_define_method(mrb, font, "name", mrb_font_get_name, MRB_ARGS_NONE());
   mrb_define_method(mrb, font, "size", mrb_font_get_size, MRB_ARGS_NONE());
+  mrb_define_method(mrb, font, "color", mrb_font_get_color, MRB_ARGS_NONE());
+  mrb_define_method(mrb, font, "out_color", mrb_font_get_out_color, MRB_ARGS_NONE());
+  mrb_define_method(mrb, font, "outline", mrb_font_get_outline, MRB_ARGS_NONE());
+  mrb_define_method(mrb, font, "outline=", mrb_font_set_outline, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, font, "shadow", mrb_font_get_shadow, MRB_ARGS_NONE());
+  mrb_define_method(mrb, font, "shadow=", mrb_font_set_shadow, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, font, "sdf?", mrb_font_sdfQ, MRB_ARGS_NONE());
 
   mrb_define_method(mrb, font, "measure_text", mrb_font_measure_text, MRB_ARGS_REQ(1));
+
+  mrb_define_class_method(mrb, font, "atlas_stats", mrb_font_s_atlas_stats, MRB_ARGS_NONE());
+  mrb_define_class_method(mrb, font, "glyph_cache_stats", mrb_font_s_glyph_cache_stats, MRB_ARGS_NONE());
+  mrb_define_class_method(mrb, font, "glyph_pages", mrb_font_s_get_glyph_pages, MRB_ARGS_NONE());
+  mrb_define_class_method(mrb, font, "glyph_pages=", mrb_font_s_set_glyph_pages, MRB_ARGS_REQ(1));
 }
 
 const char *
@@ -141,3 +703,10 @@ mrb_get_default_font_antialias(mrb_state *mrb)
   struct RClass *font = mrb_class_get(mrb, "Font");
   return mrb_bool(mrb_funcall(mrb, mrb_obj_value(font), "default_antialias", 0));
 }
+
+mrb_bool
+mrb_get_default_font_sdf(mrb_state *mrb)
+{
+  struct RClass *font = mrb_class_get(mrb, "Font");
+  return mrb_bool(mrb_funcall(mrb, mrb_obj_value(font), "default_sdf", 0));
+}
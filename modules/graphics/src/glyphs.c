@@ -0,0 +1,322 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <orgf/file.h>
+#include <orgf/glyphs.h>
+#include <orgf/stats.h>
+
+// stb_truetype comes with rayfork, kept static so it can't clash with rayfork's copy
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_STATIC
+#include <stb_truetype.h>
+
+static rf_glyph_cache cache = { { NULL }, NULL, 0, ORGF_GLYPH_PAGES };
+static rf_glyph_source *sources = NULL;
+
+rf_glyph_cache *
+mrb_get_glyph_cache(void)
+{
+  return &cache;
+}
+
+static inline size_t
+glyph_bucket(rf_glyph_source *source, int size, int codepoint)
+{
+  uintptr_t h = (uintptr_t)source >> 4;
+  h = h * 31 + (uintptr_t)size;
+  h = h * 2654435761u + (uintptr_t)codepoint;
+  return (size_t)(h ^ (h >> 16)) % ORGF_GLYPH_BUCKETS;
+}
+
+static void
+reset_page(rf_glyph_page *page)
+{
+  page->shelf_x = 0;
+  page->shelf_y = 0;
+  page->shelf_height = 0;
+  page->glyphs = 0;
+}
+
+static void
+recycle_page(mrb_int index)
+{
+  // The metrics stay, only the coverage goes away
+  for (int i = 0; i < ORGF_GLYPH_BUCKETS; ++i)
+  {
+    for (rf_cached_glyph *glyph = cache.buckets[i]; glyph; glyph = glyph->next)
+    {
+      if (glyph->page == index) glyph->page = -1;
+    }
+  }
+  reset_page(cache.pages + index);
+  cache.recycled += 1;
+}
+
+void
+mrb_glyph_cache_set_page_limit(mrb_state *mrb, mrb_int limit)
+{
+  if (limit < 1) limit = 1;
+  cache.page_limit = limit;
+  while (cache.page_count > limit)
+  {
+    cache.page_count -= 1;
+    recycle_page(cache.page_count);
+    mrb_free(mrb, cache.pages[cache.page_count].pixels);
+  }
+}
+
+rf_glyph_source *
+mrb_glyph_source_load(mrb_state *mrb, const char *path, const char **extensions)
+{
+  for (rf_glyph_source *source = sources; source; source = source->next)
+  {
+    if (strcmp(source->path, path)) continue;
+    source->refs += 1;
+    return source;
+  }
+  mrb_file *file = mrb_file_open_read_with_extensions(mrb, path, extensions);
+  size_t size = mrb_file_length(file);
+  unsigned char *data = mrb_malloc(mrb, size ? size : 1);
+  size_t read = mrb_file_read(file, size, (char *)data);
+  mrb_file_close(file);
+  stbtt_fontinfo *info = mrb_malloc(mrb, sizeof *info);
+  int offset = read == size ? stbtt_GetFontOffsetForIndex(data, 0) : -1;
+  if (offset < 0 || !stbtt_InitFont(info, data, offset))
+  {
+    mrb_free(mrb, info);
+    mrb_free(mrb, data);
+    return NULL;
+  }
+  rf_glyph_source *source = mrb_malloc(mrb, sizeof *source);
+  size_t len = strlen(path);
+  source->path = mrb_malloc(mrb, len + 1);
+  memcpy(source->path, path, len + 1);
+  source->data = data;
+  source->data_size = size;
+  source->info = info;
+  source->refs = 1;
+  source->next = sources;
+  sources = source;
+  cache.sources += 1;
+  cache.source_bytes += size;
+  return source;
+}
+
+void
+mrb_glyph_source_release(mrb_state *mrb, rf_glyph_source *source)
+{
+  source->refs -= 1;
+  if (source->refs > 0) return;
+  for (int i = 0; i < ORGF_GLYPH_BUCKETS; ++i)
+  {
+    rf_cached_glyph **link = cache.buckets + i;
+    while (*link)
+    {
+      rf_cached_glyph *glyph = *link;
+      if (glyph->source != source)
+      {
+        link = &(glyph->next);
+        continue;
+      }
+      *link = glyph->next;
+      if (glyph->page >= 0)
+      {
+        // A page left without glyphs starts over empty
+        rf_glyph_page *page = cache.pages + glyph->page;
+        page->glyphs -= 1;
+        if (page->glyphs <= 0) reset_page(page);
+      }
+      cache.glyphs -= 1;
+      mrb_free(mrb, glyph);
+    }
+  }
+  rf_glyph_source **link = &sources;
+  while (*link != source) link = &((*link)->next);
+  *link = source->next;
+  cache.sources -= 1;
+  cache.source_bytes -= source->data_size;
+  mrb_free(mrb, source->info);
+  mrb_free(mrb, source->data);
+  mrb_free(mrb, source->path);
+  mrb_free(mrb, source);
+}
+
+static rf_cached_glyph *
+find_glyph(mrb_state *mrb, rf_glyph_source *source, int size, int codepoint)
+{
+  rf_cached_glyph **bucket = cache.buckets + glyph_bucket(source, size, codepoint);
+  for (rf_cached_glyph *glyph = *bucket; glyph; glyph = glyph->next)
+  {
+    if (glyph->source == source && glyph->size == size && glyph->codepoint == codepoint) return glyph;
+  }
+  stbtt_fontinfo *info = source->info;
+  float scale = stbtt_ScaleForPixelHeight(info, (float)size);
+  int ascent, descent, gap, advance, bearing, x0, y0, x1, y1;
+  stbtt_GetFontVMetrics(info, &ascent, &descent, &gap);
+  stbtt_GetCodepointHMetrics(info, codepoint, &advance, &bearing);
+  stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+  rf_cached_glyph *glyph = mrb_malloc(mrb, sizeof *glyph);
+  glyph->source = source;
+  glyph->size = size;
+  glyph->codepoint = codepoint;
+  glyph->page = -1;
+  glyph->x = 0;
+  glyph->y = 0;
+  glyph->width = x1 - x0;
+  glyph->height = y1 - y0;
+  glyph->offset_x = x0;
+  glyph->offset_y = (int)(ascent * scale + 0.5f) + y0;
+  glyph->advance = advance * scale;
+  glyph->next = *bucket;
+  *bucket = glyph;
+  cache.glyphs += 1;
+  return glyph;
+}
+
+static mrb_bool
+place(rf_glyph_page *page, int width, int height, int *x, int *y)
+{
+  int shelf_x = page->shelf_x, shelf_y = page->shelf_y, shelf_height = page->shelf_height;
+  if (shelf_x + width > ORGF_GLYPH_PAGE_SIZE)
+  {
+    shelf_x = 0;
+    shelf_y += shelf_height;
+    shelf_height = 0;
+  }
+  if (shelf_y + height > ORGF_GLYPH_PAGE_SIZE) return FALSE;
+  *x = shelf_x;
+  *y = shelf_y;
+  page->shelf_x = shelf_x + width;
+  page->shelf_y = shelf_y;
+  page->shelf_height = height > shelf_height ? height : shelf_height;
+  return TRUE;
+}
+
+static mrb_int
+add_page(mrb_state *mrb)
+{
+  cache.pages = mrb_realloc(mrb, cache.pages, (size_t)(cache.page_count + 1) * sizeof *cache.pages);
+  rf_glyph_page *page = cache.pages + cache.page_count;
+  page->pixels = mrb_malloc(mrb, (size_t)ORGF_GLYPH_PAGE_SIZE * ORGF_GLYPH_PAGE_SIZE);
+  reset_page(page);
+  page->last_used = cache.batch;
+  return cache.page_count++;
+}
+
+/* A page with room for the glyph: any page with space left, then a new one
+   while under the limit, then the least recently used one is recycled.
+   When every page holds glyphs of this text the limit is exceeded instead. */
+static mrb_int
+allocate(mrb_state *mrb, int width, int height, int *x, int *y)
+{
+  for (mrb_int i = 0; i < cache.page_count; ++i)
+  {
+    if (place(cache.pages + i, width, height, x, y)) return i;
+  }
+  mrb_int index = -1;
+  if (cache.page_count >= cache.page_limit)
+  {
+    for (mrb_int i = 0; i < cache.page_count; ++i)
+    {
+      if (cache.pages[i].last_used >= cache.batch) continue;
+      if (index < 0 || cache.pages[i].last_used < cache.pages[index].last_used) index = i;
+    }
+    if (index >= 0) recycle_page(index);
+  }
+  if (index < 0) index = add_page(mrb);
+  place(cache.pages + index, width, height, x, y);
+  return index;
+}
+
+static inline mrb_bool
+needs_coverage(rf_cached_glyph *glyph)
+{
+  // Blank glyphs have nothing to rasterize, glyphs bigger than a page are laid out but never drawn
+  return glyph->page < 0 && glyph->width > 0 && glyph->height > 0 &&
+         glyph->width + ORGF_GLYPH_PADDING <= ORGF_GLYPH_PAGE_SIZE &&
+         glyph->height + ORGF_GLYPH_PADDING <= ORGF_GLYPH_PAGE_SIZE;
+}
+
+static void
+rasterize_glyph(mrb_state *mrb, rf_cached_glyph *glyph)
+{
+  int x, y;
+  mrb_int index = allocate(mrb, glyph->width + ORGF_GLYPH_PADDING, glyph->height + ORGF_GLYPH_PADDING, &x, &y);
+  rf_glyph_page *page = cache.pages + index;
+  stbtt_fontinfo *info = glyph->source->info;
+  float scale = stbtt_ScaleForPixelHeight(info, (float)glyph->size);
+  stbtt_MakeCodepointBitmap(info, page->pixels + (size_t)y * ORGF_GLYPH_PAGE_SIZE + x, glyph->width, glyph->height,
+                            ORGF_GLYPH_PAGE_SIZE, scale, scale, glyph->codepoint);
+  glyph->page = (int)index;
+  glyph->x = x;
+  glyph->y = y;
+  page->glyphs += 1;
+  page->last_used = cache.batch;
+  cache.rasterizations += 1;
+  ORGF_STATS_ADD(glyph_rasterizations, 1);
+}
+
+void
+mrb_glyph_rasterize_into(rf_cached_glyph *glyph, unsigned char *pixels, int stride)
+{
+  if (glyph->width <= 0 || glyph->height <= 0) return;
+  stbtt_fontinfo *info = glyph->source->info;
+  float scale = stbtt_ScaleForPixelHeight(info, (float)glyph->size);
+  stbtt_MakeCodepointBitmap(info, pixels, glyph->width, glyph->height, stride, scale, scale, glyph->codepoint);
+}
+
+static int
+compare_missing(const void *a, const void *b)
+{
+  const rf_cached_glyph *ga = *(rf_cached_glyph *const *)a;
+  const rf_cached_glyph *gb = *(rf_cached_glyph *const *)b;
+  // Tallest first packs the shelves tighter, equal glyphs end up next to each other
+  if (ga->height != gb->height) return gb->height - ga->height;
+  return ga < gb ? -1 : ga > gb ? 1 : 0;
+}
+
+mrb_int
+mrb_glyph_cache_layout(mrb_state *mrb, rf_glyph_source *source, int size, const char *text, mrb_int length,
+                       rf_cached_glyph **glyphs, mrb_bool rasterize)
+{
+  mrb_int count = 0, missing = 0;
+  mrb_int i = 0;
+  cache.batch += 1;
+  while (i < length)
+  {
+    rf_cached_glyph *glyph = find_glyph(mrb, source, size, mrb_next_codepoint(text, length, &i));
+    glyphs[count++] = glyph;
+    if (!rasterize) continue;
+    if (glyph->page >= 0)
+    {
+      cache.pages[glyph->page].last_used = cache.batch;
+      cache.hits += 1;
+    }
+    else if (needs_coverage(glyph))
+    {
+      missing += 1;
+    }
+  }
+  if (!missing) return count;
+  // Every glyph the text lacks is rasterized in one go, before any page
+  // it already uses could be picked for recycling
+  rf_cached_glyph **queue = mrb_malloc(mrb, (size_t)missing * sizeof *queue);
+  missing = 0;
+  for (mrb_int j = 0; j < count; ++j)
+  {
+    if (needs_coverage(glyphs[j])) queue[missing++] = glyphs[j];
+  }
+  qsort(queue, (size_t)missing, sizeof *queue, compare_missing);
+  for (mrb_int j = 0; j < missing; ++j)
+  {
+    if (j && queue[j] == queue[j - 1]) continue;
+    cache.misses += 1;
+    rasterize_glyph(mrb, queue[j]);
+  }
+  mrb_free(mrb, queue);
+  return count;
+}
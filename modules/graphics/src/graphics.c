@@ -5,18 +5,28 @@
 #include <mruby/string.h>
 #include <mruby/object.h>
 #include <mruby/error.h>
+#include <mruby/hash.h>
 
 #include <rayfork.h>
+#include <string.h>
 
 #include <orgf/alloc.h>
 #include <orgf/bitmap.h>
+#include <orgf/blend.h>
+#include <orgf/disposal.h>
+#include <orgf/quads.h>
+#include <orgf/residency.h>
+#include <orgf/targets.h>
+#include <orgf/texformat.h>
+#include <orgf/tiles.h>
 #include <orgf/file.h>
 #include <orgf/drawable.h>
+#include <orgf/capture.h>
+#include <orgf/movie.h>
 #include <orgf/graphics.h>
 
 #define CONFIG mrb_intern_lit(mrb, "#config")
 #define TITLE mrb_intern_lit(mrb, "#title")
-#define LAST_UPDATE mrb_intern_lit(mrb, "#last_update")
 
 static void
 config_free(mrb_state *mrb, void *p)
@@ -63,6 +73,13 @@ mrb_get_dt(mrb_state *mrb)
   return get_config(mrb, graphics)->dt;
 }
 
+mrb_bool
+mrb_graphics_is_open(mrb_state *mrb)
+{
+  mrb_value graphics = mrb_obj_value(mrb_module_get(mrb, "Graphics"));
+  return get_config(mrb, graphics)->is_open;
+}
+
 rf_sizef
 mrb_get_graphics_size(mrb_state *mrb)
 {
@@ -71,6 +88,13 @@ mrb_get_graphics_size(mrb_state *mrb)
   return (rf_sizef){ (float)config->width, (float)config->height };
 }
 
+rf_resolution *
+mrb_get_graphics_resolution(mrb_state *mrb)
+{
+  mrb_value graphics = mrb_obj_value(mrb_module_get(mrb, "Graphics"));
+  return &(get_config(mrb, graphics)->resolution);
+}
+
 static mrb_value
 mrb_graphics_get_width(mrb_state *mrb, mrb_value self)
 {
@@ -123,6 +147,7 @@ mrb_graphics_resize_screen(mrb_state *mrb, mrb_value self)
   {
     rf_unload_render_texture(config->render_texture);
     config->render_texture = rf_load_render_texture((int)config->width, (int)config->height);
+    rf_set_texture_filter(config->render_texture.texture, config->resolution.filter);
 #ifdef ORGF_PLATFORM_GLFW
     glfwSetWindowSize(config->window, (int)width, (int)height);
 #endif
@@ -195,69 +220,43 @@ mrb_graphics_fadeout(mrb_state *mrb, mrb_value self)
   return mrb_nil_value();
 }
 
-#define GL_RGBA 0x1908
-#define GL_UNSIGNED_BYTE 0x1401
-
-#define rf_gl (rf_get_context()->gfx_ctx.gl)
-
-static mrb_value
-mrb_graphics_freeze(mrb_state *mrb, mrb_value self)
-{
-  rf_graphics_config *config = get_config(mrb, self);
-  if (config->is_frozen) return mrb_nil_value();
-  config->is_frozen = TRUE;
-  size_t size = config->width * config->height;
-  rf_color *buffer = mrb_malloc(mrb, size * sizeof *buffer);
-  rf_gl.ReadPixels(0, 0, config->width, config->height, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-  for (size_t i = 0; i < size; ++i)
-  {
-    buffer[i].a = 255; // remove transparency
-  }
-  rf_image image;
-  image.data   = buffer;
-  image.width  = config->width;
-  image.height = config->height;
-  image.format = RF_UNCOMPRESSED_R8G8B8A8;
-  image.valid  = true;
-  config->frozen_img = rf_load_texture_from_image(image);
-  rf_unload_image(image, mrb_get_allocator(mrb));
-  return mrb_nil_value();
-}
-
 static mrb_value
 mrb_graphics_frame_reset(mrb_state *mrb, mrb_value self)
 {
   rf_graphics_config *config = get_config(mrb, self);
-  mrb_value last_update = mrb_iv_get(mrb, self, LAST_UPDATE);
-  mrb_value now = mrb_funcall(mrb, mrb_obj_value(mrb_class_get(mrb, "Time")), "now", 0);
-  config->dt = mrb_float(mrb_Float(mrb, mrb_funcall(mrb, now, "-", 1, last_update)));
-  mrb_iv_set(mrb, self, LAST_UPDATE, now);
+  uint64_t present = ORGF_STATS_NOW();
 #ifdef ORGF_PLATFORM_GLFW
-  glfwSwapBuffers(config->window);
+  // A skipped frame left the back buffer untouched, so there is nothing to show
+  if (!config->draw_skipped) glfwSwapBuffers(config->window);
   glfwPollEvents();
   if (glfwWindowShouldClose(config->window)) {
     exit(0);
   }
 #endif
+  ORGF_STATS_ADD(present_time, ORGF_STATS_NOW() - present);
+  if (mrb_active_stats) mrb_stats_commit(mrb_active_stats);
+  config->draw_skipped = FALSE;
+  mrb_pacer_wait(&(config->pacer), config->frame_rate);
+  config->dt = mrb_pacer_tick(&(config->pacer), config->frame_rate);
+  rf_resolution *resolution = &(config->resolution);
+  if (config->capture)
+  {
+    // Captures record the whole render texture, so they keep the full resolution
+    if (resolution->scale < 1) mrb_resolution_set_scale(resolution, 1);
+  }
+  else
+  {
+    uint64_t period = 1000000000ull / (uint64_t)(config->frame_rate > 0 ? config->frame_rate : 60);
+    mrb_resolution_frame(resolution, (uint64_t)(config->dt * 1e9), period);
+  }
   return mrb_nil_value();
 }
 
-static const float corners[4][2] = {
-  // Bottom-left corner for texture and quad
-  { 0, 1 },
-  // Bottom-right corner for texture and quad
-  { 0, 0 },
-  // Top-right corner for texture and quad
-  { 1, 0 },
-  // Top-left corner for texture and quad
-  { 1, 1 }          
-};
-
 static rf_shader transition_shader;
 
 static struct
 {
-  int transition_texture, left;
+  int transition_texture, left, premultiplied;
 } transition_shader_locations;
 
 static mrb_bool transition_shader_init = FALSE;
@@ -278,6 +277,7 @@ static const char *transition_frag =
   "uniform sampler2D texture0;"
   "uniform sampler2D transition;"
   "uniform float left;"
+  "uniform float premultiplied;"
   "uniform vec4 col_diffuse;"
   "void main()"
   "{"
@@ -289,7 +289,7 @@ static const char *transition_frag =
   "    vec4 texel_color = texture(texture0, frag_tex_coord);"
 #endif
   "    float gray = (0.3 * tt.r) + (0.59 * tt.g) + (0.11 * tt.b);"
-  "    if (gray <= left) texel_color.a = 0;"
+  "    if (gray <= left) texel_color = texel_color * vec4(vec3(1.0 - premultiplied), 0.0);"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
   "    frag_color = texel_color*col_diffuse*frag_color;"
 #elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
@@ -305,25 +305,85 @@ init_transition_shader()
     transition_shader = rf_gfx_load_shader(NULL, transition_frag);
     transition_shader_locations.left = rf_gfx_get_shader_location(transition_shader, "left");
     transition_shader_locations.transition_texture = rf_gfx_get_shader_location(transition_shader, "transition");
+    transition_shader_locations.premultiplied = rf_gfx_get_shader_location(transition_shader, "premultiplied");
     transition_shader_init = true;
   }
 }
 
+static rf_shader opaque_shader;
+
+static mrb_bool opaque_shader_init = FALSE;
+
+static const char *opaque_frag =
+#if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
+  "#version 100\n"
+  "precision mediump float;"
+  "varying vec2 frag_tex_coord;"
+  "varying vec4 frag_color;"
+#elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+  "#version 330\n"
+  "precision mediump float;"
+  "in vec2 frag_tex_coord;"
+  "in vec4 frag_color;"
+  "out vec4 final_color;"
+#endif
+  "uniform sampler2D texture0;"
+  "uniform vec4 col_diffuse;"
+  "void main()"
+  "{"
+#if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
+  "    vec4 texel_color = texture2D(texture0, frag_tex_coord);"
+  "    frag_color = vec4(texel_color.rgb*col_diffuse.rgb*frag_color.rgb, 1.0);"
+#elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+  "    vec4 texel_color = texture(texture0, frag_tex_coord);"
+  "    final_color = vec4(texel_color.rgb*col_diffuse.rgb*frag_color.rgb, 1.0);"
+#endif
+"}";
+
+static inline void
+init_opaque_shader()
+{
+  if (!opaque_shader_init)
+  {
+    opaque_shader = rf_gfx_load_shader(NULL, opaque_frag);
+    opaque_shader_init = true;
+  }
+}
+
 static inline void
 bind_transition_shader(rf_texture2d texture, float left)
 {
   rf_gfx_set_shader_value(
     transition_shader, transition_shader_locations.left, &left, RF_UNIFORM_FLOAT
   );
+  float premultiplied = mrb_get_premultiplied_alpha() ? 1.0f : 0.0f;
+  rf_gfx_set_shader_value(
+    transition_shader, transition_shader_locations.premultiplied, &premultiplied, RF_UNIFORM_FLOAT
+  );
 }
 
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
 #define GL_TEXTURE0 0x84C0
 #define GL_TEXTURE2 0x84C2
 #define GL_TEXTURE_2D 0x0DE1
 
+/* The part of the screen's render texture the last frame was drawn into. */
+static rf_vec2
+screen_region(rf_graphics_config *config)
+{
+  rf_texture2d tex = config->render_texture.texture;
+  int w, h;
+  mrb_resolution_region(&(config->resolution), tex.width, tex.height, &w, &h);
+  return (rf_vec2){ (float)w / (float)tex.width, (float)h / (float)tex.height };
+}
+
 static void
-draw_screen(rf_texture2d tex, rf_color color, rf_texture2d *texture)
+draw_screen(rf_texture2d tex, rf_vec2 region, rf_color color, rf_texture2d *texture)
 {
+  // The region is the top left corner, which is the top of the texture's rows
+  float u = region.x, v = 1.0f - region.y;
+  color = mrb_blend_color(color, RF_BLEND_ALPHA);
   rf_gfx_enable_texture(tex.id);
   // TODO: Fix image transition not actually working
   if (texture)
@@ -340,51 +400,179 @@ draw_screen(rf_texture2d tex, rf_color color, rf_texture2d *texture)
     rf_gfx_begin(RF_QUADS);
       rf_gfx_color4ub(color.a, color.g, color.b, color.a);
       // Bottom-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[0][0], corners[0][1]);
+      rf_gfx_tex_coord2f(0.0f, 1.0f);
       rf_gfx_vertex2f(0.0f, 0.0f);
       // Bottom-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[1][0], corners[1][1]);
+      rf_gfx_tex_coord2f(0.0f, v);
       rf_gfx_vertex2f(0.0f, tex.height);
       // Top-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[2][0], corners[2][1]);
+      rf_gfx_tex_coord2f(u, v);
       rf_gfx_vertex2f(tex.width, tex.height);
       // Top-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[3][0], corners[3][1]);
+      rf_gfx_tex_coord2f(u, 1.0f);
       rf_gfx_vertex2f(tex.width, 0.0f);
     rf_gfx_end();
   rf_gfx_pop_matrix();
   rf_gfx_disable_texture();
 }
 
+static void
+copy_screen(rf_texture2d tex, rf_vec2 region, float width, float height)
+{
+  float u = region.x, v = 1.0f - region.y;
+  // Unlike draw_screen the quad is not flipped, so the copy ends up with the
+  // same row order as a loaded image.
+  rf_gfx_enable_texture(tex.id);
+  rf_gfx_begin(RF_QUADS);
+    rf_gfx_color4ub(255, 255, 255, 255);
+    rf_gfx_tex_coord2f(0.0f, v);
+    rf_gfx_vertex2f(0.0f, 0.0f);
+    rf_gfx_tex_coord2f(0.0f, 1.0f);
+    rf_gfx_vertex2f(0.0f, height);
+    rf_gfx_tex_coord2f(u, 1.0f);
+    rf_gfx_vertex2f(width, height);
+    rf_gfx_tex_coord2f(u, v);
+    rf_gfx_vertex2f(width, 0.0f);
+  rf_gfx_end();
+  rf_gfx_disable_texture();
+}
+
+static mrb_value
+mrb_graphics_freeze(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  if (config->is_frozen) return mrb_nil_value();
+  config->is_frozen = TRUE;
+  // The last frame is still in the render texture, so it is copied on the GPU
+  // into a pooled target held until the transition, the shader drops the transparency.
+  rf_texture2d source = config->render_texture.texture;
+  rf_render_target *frozen = &(config->frozen_render);
+  mrb_render_target_acquire(mrb, frozen, source.width, source.height, TRUE);
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
+  rf_begin_render_to_texture(frozen->target);
+  ORGF_STATS_SETTLE();
+    rf_clear(RF_BLANK);
+    rf_begin_shader(opaque_shader);
+      draw_screen(source, screen_region(config), RF_WHITE, 0);
+    rf_end_shader();
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
+  rf_end_render_to_texture();
+  ORGF_STATS_SETTLE();
+  return mrb_nil_value();
+}
+
+static void
+end_frame(mrb_state *mrb, rf_graphics_config *config)
+{
+  // Whatever the GC finalized during the frame is unloaded here, outside of drawing
+  mrb_disposal_drain(mrb, FALSE);
+  mrb_residency_end_frame(mrb);
+  mrb_render_target_end_frame(mrb);
+  mrb_tiled_texture_end_frame(mrb);
+  config->frame_count += 1;
+}
+
 static mrb_value
 mrb_graphics_update(mrb_state *mrb, mrb_value self)
 {
   mrb_graphics_frame_reset(mrb, self);
   rf_graphics_config *config = get_config(mrb, self);
+  uint64_t start = ORGF_STATS_NOW();
+  mrb_container_tick(mrb, &(config->container));
+  if (mrb_pacer_should_skip(&(config->pacer)))
+  {
+    // Viewports and windows render their passes in update, a skipped frame only ticks
+    ORGF_STATS_ADD(update_time, ORGF_STATS_NOW() - start);
+    config->draw_skipped = TRUE;
+    end_frame(mrb, config);
+    return mrb_nil_value();
+  }
   rf_begin();
   mrb_container_update(mrb, &(config->container));
+  uint64_t updated = ORGF_STATS_NOW();
+  ORGF_STATS_ADD(update_time, updated - start);
   rf_clear(RF_BLANK);
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
   rf_begin_render_to_texture(config->render_texture);
+  ORGF_STATS_SETTLE();
     rf_clear(RF_BLANK);
+    mrb_resolution_begin(&(config->resolution), config->render_texture.texture.width, config->render_texture.texture.height);
     mrb_container_draw_children(mrb, &(config->container));
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
   rf_end_render_to_texture();
+  ORGF_STATS_SETTLE();
+  if (config->capture) mrb_capture_frame(mrb, config->capture, config->render_texture);
   rf_texture2d tex;
+  rf_vec2 region = { 1, 1 };
   if (config->is_frozen)
   {
-    tex = config->frozen_img;
+    tex = config->frozen_render.target.texture;
   }
   else
   {
     tex = config->render_texture.texture;
+    region = screen_region(config);
   }
-  draw_screen(tex, (rf_color){255, 255, 255, config->brightness}, 0);
+  // A frame without drawables would otherwise composite with whatever blending was left set
+  mrb_begin_blend_mode(RF_BLEND_ALPHA);
+    draw_screen(tex, region, (rf_color){255, 255, 255, config->brightness}, 0);
+  mrb_end_blend_mode();
+  ORGF_STATS_FLUSH(RF_FLUSH_FRAME);
   rf_end();
-  config->frame_count += 1;  
+  ORGF_STATS_SETTLE();
+  ORGF_STATS_ADD(draw_time, ORGF_STATS_NOW() - updated);
+  end_frame(mrb, config);
   return mrb_nil_value();
 }
 
 
 
+static void
+unload_transitions(rf_graphics_config *config, mrb_state *mrb)
+{
+  for (int i = 0; i < ORGF_TRANSITION_CACHE_SIZE; ++i)
+  {
+    rf_transition_entry *entry = &(config->transitions[i]);
+    if (!entry->name) continue;
+    rf_unload_texture(entry->texture);
+    mrb_free(mrb, entry->name);
+    entry->name = NULL;
+    entry->last_used = 0;
+  }
+}
+
+static rf_texture2d
+get_transition_texture(mrb_state *mrb, rf_graphics_config *config, const char *name)
+{
+  rf_transition_entry *slot = &(config->transitions[0]);
+  config->transition_clock += 1;
+  for (int i = 0; i < ORGF_TRANSITION_CACHE_SIZE; ++i)
+  {
+    rf_transition_entry *entry = &(config->transitions[i]);
+    if (entry->name && !strcmp(entry->name, name))
+    {
+      entry->last_used = config->transition_clock;
+      return entry->texture;
+    }
+    if (entry->last_used < slot->last_used) slot = entry;
+  }
+  const char *new_name = mrb_filesystem_join(mrb, "Graphics", name);
+  rf_io_callbacks io = mrb_get_io_callbacks_for_extensions(mrb, MRB_IMAGE_EXTENSIONS);
+  rf_texture2d texture = rf_load_texture_from_file(new_name, mrb_get_allocator(mrb), io);
+  if (!texture.valid) mrb_raisef(mrb, E_ARGUMENT_ERROR, "Failed to load transition '%s'", name);
+  if (slot->name)
+  {
+    rf_unload_texture(slot->texture);
+    mrb_free(mrb, slot->name);
+  }
+  size_t len = strlen(name);
+  slot->name = mrb_malloc(mrb, len + 1);
+  memcpy(slot->name, name, len + 1);
+  slot->texture = texture;
+  slot->last_used = config->transition_clock;
+  return texture;
+}
+
 static mrb_value
 mrb_graphics_transition(mrb_state *mrb, mrb_value self)
 {
@@ -396,18 +584,24 @@ mrb_graphics_transition(mrb_state *mrb, mrb_value self)
   if (argc < 3) vague = 40;
   if (argc < 2) name = NULL;
   if (argc < 1) duration = 0.17;
+  mrb_container_tick(mrb, &(config->container));
   mrb_container_update(mrb, &(config->container));
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
   rf_begin_render_to_texture(config->render_texture);
+  ORGF_STATS_SETTLE();
     rf_clear(RF_BLANK);
+    mrb_resolution_begin(&(config->resolution), config->render_texture.texture.width, config->render_texture.texture.height);
     mrb_container_draw_children(mrb, &(config->container));
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
   rf_end_render_to_texture();
+  ORGF_STATS_SETTLE();
+  rf_vec2 region = screen_region(config);
+  rf_vec2 full = { 1, 1 };
   if (duration > 0)
   {
     if (name)
     {
-      const char *new_name = mrb_filesystem_join(mrb, "Graphics", name);
-      rf_io_callbacks io = mrb_get_io_callbacks_for_extensions(mrb, MRB_IMAGE_EXTENSIONS);
-      rf_texture2d transition_texture = rf_load_texture_from_file(new_name, mrb_get_allocator(mrb), io);
+      rf_texture2d transition_texture = get_transition_texture(mrb, config, name);
       mrb_float dt = duration;
       while (dt > 0)
       {
@@ -416,17 +610,21 @@ mrb_graphics_transition(mrb_state *mrb, mrb_value self)
         float left = (float)(dt / duration);
         rf_begin();
           rf_clear(RF_BLANK);
-          draw_screen(config->render_texture.texture, RF_RAYWHITE, 0);
-          rf_begin_blend_mode(RF_BLEND_ALPHA);
+          draw_screen(config->render_texture.texture, region, RF_RAYWHITE, 0);
+          ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+          mrb_begin_blend_mode(RF_BLEND_ALPHA);
             rf_begin_shader(transition_shader);
               bind_transition_shader(transition_texture, 1.0f - left);
-              draw_screen(config->frozen_img, RF_RAYWHITE, &transition_texture);
+              draw_screen(config->frozen_render.target.texture, full, RF_RAYWHITE, &transition_texture);
+            ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
             rf_end_shader();
-          rf_end_blend_mode();
+            ORGF_STATS_SETTLE();
+          mrb_end_blend_mode();
+        ORGF_STATS_FLUSH(RF_FLUSH_FRAME);
         rf_end();
+        ORGF_STATS_SETTLE();
         mrb_graphics_frame_reset(mrb, self);
       }
-      rf_unload_texture(transition_texture);
     }
     else
     {
@@ -438,29 +636,164 @@ mrb_graphics_transition(mrb_state *mrb, mrb_value self)
         mrb_int left = (mrb_int)(255 * dt / duration);
         mrb_int bg = config->brightness * left / 255;
         rf_begin();
-          draw_screen(config->render_texture.texture, (rf_color){255, 255, 255, config->brightness}, 0);
-          rf_begin_blend_mode(RF_BLEND_ALPHA);
-            draw_screen(config->frozen_img, (rf_color){255, 255, 255, bg}, 0);
-          rf_end_blend_mode();
+          draw_screen(config->render_texture.texture, region, (rf_color){255, 255, 255, config->brightness}, 0);
+          mrb_begin_blend_mode(RF_BLEND_ALPHA);
+            draw_screen(config->frozen_render.target.texture, full, (rf_color){255, 255, 255, bg}, 0);
+          mrb_end_blend_mode();
+        ORGF_STATS_FLUSH(RF_FLUSH_FRAME);
         rf_end();
+        ORGF_STATS_SETTLE();
         mrb_graphics_frame_reset(mrb, self);
       }
     }
   }
-  rf_unload_texture(config->frozen_img);
   config->is_frozen = FALSE;
+  mrb_render_target_release(&(config->frozen_render));
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_graphics_clear_transition_cache(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  unload_transitions(config, mrb);
   return mrb_nil_value();
 }
 
 static mrb_value
 mrb_graphics_snap_to_bitmap(mrb_state *mrb, mrb_value self)
 {
+  mrb_float scale = 1;
+  mrb_get_args(mrb, "|f", &scale);
+  if (scale <= 0 || scale > 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "Scale must be between 0 and 1");
+  rf_graphics_config *config = get_config(mrb, self);
+  if (!config->is_open) return mrb_nil_value();
+  rf_texture2d source = config->is_frozen ? config->frozen_render.target.texture : config->render_texture.texture;
+  int width = (int)(source.width * scale);
+  int height = (int)(source.height * scale);
+  if (width < 1) width = 1;
+  if (height < 1) height = 1;
+  rf_render_texture2d target = rf_load_render_texture(width, height);
+  rf_vec2 region = config->is_frozen ? (rf_vec2){ 1, 1 } : screen_region(config);
+  mrb_bool scaled = width != (int)(source.width * region.x) || height != (int)(source.height * region.y);
+  if (scaled) rf_set_texture_filter(source, RF_FILTER_BILINEAR);
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
+  rf_begin_render_to_texture(target);
+  ORGF_STATS_SETTLE();
+    rf_clear(RF_BLANK);
+    copy_screen(source, region, (float)width, (float)height);
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
+  rf_end_render_to_texture();
+  ORGF_STATS_SETTLE();
+  // The screen's texture keeps the filter it presents with
+  if (scaled) rf_set_texture_filter(source, config->is_frozen ? RF_FILTER_POINT : config->resolution.filter);
+  return mrb_bitmap_new_from_render_texture(mrb, target);
+}
+
+static void
+stop_capture(mrb_state *mrb, rf_graphics_config *config)
+{
+  rf_capture *capture = config->capture;
+  if (!capture) return;
+  config->capture = NULL;
+  mrb_capture_stop(mrb, capture);
+  config->capture_stats = capture->stats;
+}
+
+static mrb_value
+mrb_graphics_start_capture(mrb_state *mrb, mrb_value self)
+{
+  const char *path;
+  mrb_value options = mrb_nil_value();
+  mrb_int every = 1;
+  mrb_get_args(mrb, "z|H", &path, &options);
+  if (!mrb_nil_p(options))
+  {
+    mrb_value value = mrb_hash_get(mrb, options, mrb_symbol_value(mrb_intern_lit(mrb, "every")));
+    if (!mrb_nil_p(value)) every = mrb_int(mrb, value);
+  }
+  if (every < 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "Capture interval must be positive");
+  rf_graphics_config *config = get_config(mrb, self);
+  if (!config->is_open) mrb_raise(mrb, E_RUNTIME_ERROR, "The game screen is not open");
+  stop_capture(mrb, config);
+  rf_texture2d screen = config->render_texture.texture;
+  config->capture = mrb_capture_start(mrb, path, every, screen.width, screen.height, config->frame_rate);
+  config->capture_stats = (rf_capture_stats){ 0 };
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_graphics_stop_capture(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  stop_capture(mrb, config);
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_graphics_capturingQ(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_bool_value(config->capture ? TRUE : FALSE);
+}
+
+static mrb_value
+mrb_graphics_capture_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  rf_capture_stats stats = config->capture ? config->capture->stats : config->capture_stats;
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_float average = stats.written ? (mrb_float)stats.latency_total / (mrb_float)stats.written / 1000000.0 : 0;
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "captured")), mrb_fixnum_value(stats.captured));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "dropped")), mrb_fixnum_value(stats.dropped));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "written")), mrb_fixnum_value(stats.written));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "failed")), mrb_fixnum_value(stats.failed));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "average_latency")), mrb_float_value(mrb, average));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "max_latency")), mrb_float_value(mrb, (mrb_float)stats.latency_max / 1000000.0));
+  return hash;
+}
+
+typedef struct
+{
+  mrb_value            self;
+  rf_graphics_config  *config;
+  rf_movie            *movie;
+} movie_playback;
+
+static mrb_value
+play_movie_loop(mrb_state *mrb, mrb_value data)
+{
+  movie_playback *playback = mrb_cptr(data);
+  rf_graphics_config *config = playback->config;
+  while (!mrb_movie_finished(playback->movie))
+  {
+    mrb_movie_update(mrb, playback->movie, config->dt, TRUE);
+    rf_begin();
+      rf_clear(RF_BLACK);
+      mrb_movie_draw(playback->movie, (float)config->width, (float)config->height);
+    ORGF_STATS_FLUSH(RF_FLUSH_FRAME);
+    rf_end();
+    ORGF_STATS_SETTLE();
+    mrb_graphics_frame_reset(mrb, playback->self);
+  }
   return mrb_nil_value();
 }
 
 static mrb_value
 mrb_graphics_play_movie(mrb_state *mrb, mrb_value self)
 {
+  const char *name;
+  mrb_bool error;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "z", &name);
+  if (!config->is_open) return mrb_nil_value();
+  movie_playback playback;
+  playback.self = self;
+  playback.config = config;
+  playback.movie = mrb_movie_open(mrb, mrb_filesystem_join(mrb, "Movies", name));
+  mrb_value result = mrb_protect(mrb, play_movie_loop, mrb_cptr_value(mrb, &playback), &error);
+  mrb_movie_close(mrb, playback.movie);
+  if (error) mrb_exc_raise(mrb, result);
   return mrb_nil_value();
 }
 
@@ -525,6 +858,603 @@ mrb_graphics_set_brightness(mrb_state *mrb, mrb_value self)
   return mrb_fixnum_value(value);
 }
 
+static void
+apply_vsync(rf_graphics_config *config)
+{
+#ifdef ORGF_PLATFORM_GLFW
+  switch (config->pacer.vsync)
+  {
+    case RF_VSYNC_OFF:
+      glfwSwapInterval(0);
+      break;
+    case RF_VSYNC_ADAPTIVE:
+      if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+      {
+        glfwSwapInterval(-1);
+      }
+      else
+      {
+        // Without tear control adaptive sync falls back to plain vsync
+        glfwSwapInterval(1);
+      }
+      break;
+    default:
+      glfwSwapInterval(1);
+      break;
+  }
+#endif
+}
+
+static mrb_value
+mrb_graphics_get_vsync(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  switch (config->pacer.vsync)
+  {
+    case RF_VSYNC_OFF:
+      return mrb_symbol_value(mrb_intern_lit(mrb, "off"));
+    case RF_VSYNC_ADAPTIVE:
+      return mrb_symbol_value(mrb_intern_lit(mrb, "adaptive"));
+    default:
+      return mrb_symbol_value(mrb_intern_lit(mrb, "on"));
+  }
+}
+
+static mrb_value
+mrb_graphics_set_vsync(mrb_state *mrb, mrb_value self)
+{
+  mrb_value value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "o", &value);
+  if (mrb_symbol_p(value))
+  {
+    mrb_sym mode = mrb_symbol(value);
+    if (mode == mrb_intern_lit(mrb, "off"))
+    {
+      config->pacer.vsync = RF_VSYNC_OFF;
+    }
+    else if (mode == mrb_intern_lit(mrb, "on"))
+    {
+      config->pacer.vsync = RF_VSYNC_ON;
+    }
+    else if (mode == mrb_intern_lit(mrb, "adaptive"))
+    {
+      config->pacer.vsync = RF_VSYNC_ADAPTIVE;
+    }
+    else
+    {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "Vsync must be :on, :off or :adaptive");
+    }
+  }
+  else
+  {
+    config->pacer.vsync = mrb_test(value) ? RF_VSYNC_ON : RF_VSYNC_OFF;
+  }
+  if (config->is_open) apply_vsync(config);
+  return value;
+}
+
+static mrb_value
+mrb_graphics_get_frame_skip(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  if (!config->pacer.frame_skip) return mrb_false_value();
+  return mrb_fixnum_value(config->pacer.max_skip);
+}
+
+static mrb_value
+mrb_graphics_set_frame_skip(mrb_state *mrb, mrb_value self)
+{
+  mrb_value value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "o", &value);
+  if (mrb_fixnum_p(value))
+  {
+    mrb_int max_skip = mrb_fixnum(value);
+    config->pacer.frame_skip = max_skip > 0;
+    if (max_skip > 0) config->pacer.max_skip = max_skip;
+  }
+  else
+  {
+    config->pacer.frame_skip = mrb_test(value);
+  }
+  config->pacer.skipped_in_row = 0;
+  return value;
+}
+
+static mrb_value
+mrb_graphics_get_skipped_frames(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_fixnum_value(config->pacer.skipped);
+}
+
+static mrb_value
+mrb_graphics_frame_time(mrb_state *mrb, mrb_value self)
+{
+  mrb_float percentile;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "f", &percentile);
+  return mrb_float_value(mrb, mrb_pacer_percentile(&(config->pacer), percentile));
+}
+
+static mrb_value
+mrb_graphics_frame_times(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  rf_frame_pacer *pacer = &(config->pacer);
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "average")), mrb_float_value(mrb, mrb_pacer_average(pacer)));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "p50")), mrb_float_value(mrb, mrb_pacer_percentile(pacer, 50)));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "p90")), mrb_float_value(mrb, mrb_pacer_percentile(pacer, 90)));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "p99")), mrb_float_value(mrb, mrb_pacer_percentile(pacer, 99)));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "max")), mrb_float_value(mrb, mrb_pacer_percentile(pacer, 100)));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "samples")), mrb_fixnum_value(pacer->sample_count));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_get_dynamic_resolution(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_bool_value(config->resolution.enabled);
+}
+
+static mrb_value
+mrb_graphics_set_dynamic_resolution(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "b", &value);
+  config->resolution.enabled = value;
+  // Turned off it goes back to full resolution, turned on it measures from scratch
+  mrb_resolution_set_scale(&(config->resolution), value ? config->resolution.scale : 1);
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_graphics_get_resolution_scale(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_float_value(mrb, config->resolution.scale);
+}
+
+static mrb_value
+mrb_graphics_set_resolution_scale(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "f", &value);
+  if (value <= 0 || value > 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "Resolution scale must be between 0 and 1");
+  mrb_resolution_set_scale(&(config->resolution), (float)value);
+  return mrb_float_value(mrb, config->resolution.scale);
+}
+
+static mrb_value
+mrb_graphics_get_min_resolution_scale(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_float_value(mrb, config->resolution.min_scale);
+}
+
+static mrb_value
+mrb_graphics_set_min_resolution_scale(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "f", &value);
+  if (value <= 0 || value > 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "Resolution scale must be between 0 and 1");
+  config->resolution.min_scale = (float)value;
+  mrb_resolution_set_scale(&(config->resolution), config->resolution.scale);
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_graphics_get_resolution_filter(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  if (config->resolution.filter == RF_FILTER_POINT) return mrb_symbol_value(mrb_intern_lit(mrb, "nearest"));
+  return mrb_symbol_value(mrb_intern_lit(mrb, "bilinear"));
+}
+
+static mrb_value
+mrb_graphics_set_resolution_filter(mrb_state *mrb, mrb_value self)
+{
+  mrb_sym value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "n", &value);
+  if (value == mrb_intern_lit(mrb, "nearest"))
+  {
+    config->resolution.filter = RF_FILTER_POINT;
+  }
+  else if (value == mrb_intern_lit(mrb, "bilinear"))
+  {
+    config->resolution.filter = RF_FILTER_BILINEAR;
+  }
+  else
+  {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "Resolution filter must be :nearest or :bilinear");
+  }
+  if (config->is_open) rf_set_texture_filter(config->render_texture.texture, config->resolution.filter);
+  return mrb_symbol_value(value);
+}
+
+static mrb_value
+mrb_graphics_resolution_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_resolution *resolution = &(get_config(mrb, self)->resolution);
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "scale")), mrb_float_value(mrb, resolution->scale));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "downscales")), mrb_fixnum_value(resolution->downscales));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "upscales")), mrb_fixnum_value(resolution->upscales));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "patience")), mrb_fixnum_value(resolution->patience));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_stats_to_hash(mrb, &(config->stats));
+}
+
+static mrb_value
+mrb_graphics_get_stats_enabled(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_bool_value(config->stats_enabled);
+}
+
+static mrb_value
+mrb_graphics_set_stats_enabled(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "b", &value);
+#ifdef ORGF_NO_GRAPHICS_STATS
+  value = FALSE;
+#endif
+  config->stats_enabled = value;
+  if (config->is_open)
+  {
+    if (value)
+    {
+      mrb_stats_enable(&(config->stats));
+    }
+    else
+    {
+      mrb_stats_disable();
+    }
+  }
+  return mrb_bool_value(value);
+}
+
+static void
+check_batch_change(mrb_state *mrb, rf_graphics_config *config)
+{
+  if (config->is_open) mrb_raise(mrb, E_RUNTIME_ERROR, "The render batch can only be configured before the game starts");
+}
+
+static mrb_value
+mrb_graphics_get_batch_size(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_fixnum_value(config->batch.size);
+}
+
+static mrb_value
+mrb_graphics_set_batch_size(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "i", &value);
+  check_batch_change(mrb, config);
+  if (value < ORGF_BATCH_FULL_SLACK) value = ORGF_BATCH_FULL_SLACK;
+  if (value > ORGF_BATCH_MAX_SIZE) value = ORGF_BATCH_MAX_SIZE;
+  config->batch.size = value;
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+mrb_graphics_get_batch_buffers(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return mrb_fixnum_value(config->batch.buffers);
+}
+
+static mrb_value
+mrb_graphics_set_batch_buffers(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "i", &value);
+  check_batch_change(mrb, config);
+  if (value < 1) value = 1;
+  if (value > ORGF_BATCH_MAX_BUFFERS) value = ORGF_BATCH_MAX_BUFFERS;
+  config->batch.buffers = value;
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+batch_streaming_value(mrb_state *mrb, rf_graphics_config *config)
+{
+  if (config->batch.streaming == RF_BATCH_ORPHAN) return mrb_symbol_value(mrb_intern_lit(mrb, "orphan"));
+  return mrb_symbol_value(mrb_intern_lit(mrb, "rotate"));
+}
+
+static mrb_value
+mrb_graphics_get_batch_streaming(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  return batch_streaming_value(mrb, config);
+}
+
+static mrb_value
+mrb_graphics_set_batch_streaming(mrb_state *mrb, mrb_value self)
+{
+  mrb_sym value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "n", &value);
+  check_batch_change(mrb, config);
+  if (value == mrb_intern_lit(mrb, "orphan"))
+  {
+    config->batch.streaming = RF_BATCH_ORPHAN;
+  }
+  else if (value == mrb_intern_lit(mrb, "rotate"))
+  {
+    config->batch.streaming = RF_BATCH_ROTATE;
+  }
+  else
+  {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "Batch streaming must be :rotate or :orphan");
+  }
+  return mrb_symbol_value(value);
+}
+
+static mrb_value
+mrb_graphics_batch_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "size")), mrb_fixnum_value(config->batch.size));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "buffers")), mrb_fixnum_value(config->batch.buffers));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "streaming")), batch_streaming_value(mrb, config));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "flushes")), mrb_fixnum_value(config->batch_stats.flushes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "full_flushes")), mrb_fixnum_value(config->batch_stats.full_flushes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "orphaned")), mrb_fixnum_value(config->batch_stats.orphaned));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_get_vram_budget(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value((mrb_int)mrb_get_residency()->budget);
+}
+
+static mrb_value
+mrb_graphics_set_vram_budget(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  mrb_get_args(mrb, "i", &value);
+  if (value < 0) value = 0;
+  mrb_get_residency()->budget = (size_t)value;
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+mrb_graphics_residency_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_residency *residency = mrb_get_residency();
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "budget")), mrb_fixnum_value((mrb_int)residency->budget));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "resident_bytes")), mrb_fixnum_value((mrb_int)residency->resident_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "bitmaps")), mrb_fixnum_value(residency->tracked));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "resident")), mrb_fixnum_value(residency->resident));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "pinned")), mrb_fixnum_value(residency->pinned));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "evictions")), mrb_fixnum_value(residency->evictions));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "reloads")), mrb_fixnum_value(residency->reloads));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "avoided_uploads")), mrb_fixnum_value(residency->avoided_uploads));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_memory_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_residency *residency = mrb_get_residency();
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "image_bytes")), mrb_fixnum_value((mrb_int)residency->image_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "texture_bytes")), mrb_fixnum_value((mrb_int)residency->resident_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "released_bytes")), mrb_fixnum_value((mrb_int)residency->released_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "released")), mrb_fixnum_value(residency->released));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "recovered")), mrb_fixnum_value(residency->recovered));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "reduced_textures")), mrb_fixnum_value(residency->reduced));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_render_target_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_render_target_pool *pool = mrb_get_render_target_pool();
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "targets")), mrb_fixnum_value(pool->count));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "in_use")), mrb_fixnum_value(pool->in_use));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "bytes")), mrb_fixnum_value((mrb_int)pool->bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "hits")), mrb_fixnum_value(pool->hits));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "allocations")), mrb_fixnum_value(pool->allocations));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "trims")), mrb_fixnum_value(pool->trims));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_get_texture_format(mrb_state *mrb, mrb_value self)
+{
+  return mrb_texture_format_value(mrb, mrb_get_texture_policy()->format);
+}
+
+static mrb_value
+mrb_graphics_set_texture_format(mrb_state *mrb, mrb_value self)
+{
+  mrb_value value;
+  mrb_get_args(mrb, "o", &value);
+  enum rf_texture_format format = mrb_get_texture_format(mrb, value);
+  mrb_get_texture_policy()->format = format == RF_TEXTURE_DEFAULT ? RF_TEXTURE_RGBA8888 : format;
+  return value;
+}
+
+static mrb_value
+mrb_graphics_set_directory_texture_format(mrb_state *mrb, mrb_value self)
+{
+  const char *directory;
+  mrb_value value;
+  mrb_get_args(mrb, "zo", &directory, &value);
+  enum rf_texture_format format = mrb_get_texture_format(mrb, value);
+  // Bitmap sources are stored joined with the Graphics folder
+  int arena = mrb_gc_arena_save(mrb);
+  mrb_texture_policy_set(mrb, mrb_filesystem_join(mrb, "Graphics", directory), format);
+  mrb_gc_arena_restore(mrb, arena);
+  return value;
+}
+
+static mrb_value
+mrb_graphics_get_texture_dither(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_texture_policy()->dither);
+}
+
+static mrb_value
+mrb_graphics_set_texture_dither(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  mrb_get_args(mrb, "b", &value);
+  mrb_get_texture_policy()->dither = value;
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_graphics_get_premultiplied_alpha(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_premultiplied_alpha());
+}
+
+static mrb_value
+mrb_graphics_set_premultiplied_alpha(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  rf_graphics_config *config = get_config(mrb, self);
+  mrb_get_args(mrb, "b", &value);
+  // Textures already uploaded and the shaders would disagree on their colors
+  if (config->is_open) mrb_raise(mrb, E_RUNTIME_ERROR, "Premultiplied alpha can only be changed before the game starts");
+  mrb_set_premultiplied_alpha(value);
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_graphics_get_max_texture_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_get_max_texture_size());
+}
+
+static mrb_value
+mrb_graphics_set_max_texture_size(mrb_state *mrb, mrb_value self)
+{
+  mrb_value value;
+  mrb_get_args(mrb, "o", &value);
+  // Lowering it only affects bitmaps uploaded from then on, nil goes back to the GPU limit
+  mrb_get_tile_cache()->max_size = mrb_nil_p(value) ? 0 : (int)mrb_int(mrb, value);
+  return value;
+}
+
+static mrb_value
+mrb_graphics_get_tile_budget(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value((mrb_int)mrb_get_tile_cache()->budget);
+}
+
+static mrb_value
+mrb_graphics_set_tile_budget(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  mrb_get_args(mrb, "i", &value);
+  if (value < 0) mrb_raise(mrb, E_ARGUMENT_ERROR, "tile budget can't be negative");
+  // Only tile textures count, the decoded pixels of tiled bitmaps stay in RAM regardless
+  mrb_get_tile_cache()->budget = (size_t)value;
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+mrb_graphics_get_disposal_budget(mrb_state *mrb, mrb_value self)
+{
+  return mrb_float_value(mrb, (mrb_float)mrb_get_disposal_queue()->budget / 1e6);
+}
+
+static mrb_value
+mrb_graphics_set_disposal_budget(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  if (value < 0) mrb_raise(mrb, E_ARGUMENT_ERROR, "disposal budget can't be negative");
+  mrb_get_disposal_queue()->budget = (uint64_t)(value * 1e6);
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_graphics_disposal_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_disposal_queue *queue = mrb_get_disposal_queue();
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "queued")), mrb_fixnum_value(queue->queued));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "released")), mrb_fixnum_value(queue->released));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "pending")), mrb_fixnum_value(queue->count));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "queued_bytes")), mrb_fixnum_value((mrb_int)queue->queued_bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "released_bytes")), mrb_fixnum_value((mrb_int)queue->released_bytes));
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_get_sprite_threads(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_get_quad_threads());
+}
+
+static mrb_value
+mrb_graphics_set_sprite_threads(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  mrb_get_args(mrb, "i", &value);
+  if (value < 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "sprite threads must be at least 1");
+  mrb_set_quad_threads(value);
+  return mrb_fixnum_value(mrb_get_quad_threads());
+}
+
+/* Sprites per millisecond the corner kernels reach with 1, 2 and 4 threads. */
+static mrb_value
+mrb_graphics_sprite_benchmark(mrb_state *mrb, mrb_value self)
+{
+  mrb_int count = 100000;
+  mrb_get_args(mrb, "|i", &count);
+  if (count < 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "sprite count must be positive");
+  mrb_value hash = mrb_hash_new(mrb);
+  for (mrb_int threads = 1; threads <= 4; threads *= 2)
+  {
+    double rate = mrb_sprite_quads_benchmark(mrb, count, threads);
+    mrb_hash_set(mrb, hash, mrb_fixnum_value(threads), mrb_float_value(mrb, (mrb_float)rate));
+  }
+  return hash;
+}
+
+static mrb_value
+mrb_graphics_tile_stats(mrb_state *mrb, mrb_value self)
+{
+  rf_tile_cache *cache = mrb_get_tile_cache();
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "tiled_bitmaps")), mrb_fixnum_value(cache->textures));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "resident_tiles")), mrb_fixnum_value(cache->resident));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "bytes")), mrb_fixnum_value((mrb_int)cache->bytes));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "uploads")), mrb_fixnum_value(cache->uploads));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "evictions")), mrb_fixnum_value(cache->evictions));
+  return hash;
+}
+
 static mrb_value
 mrb_config_initialize(mrb_state *mrb, mrb_value self)
 {
@@ -537,6 +1467,22 @@ mrb_config_initialize(mrb_state *mrb, mrb_value self)
   config->is_open = 0;
   config->is_frozen = 0;
   config->data = NULL;
+  config->frozen_render = (rf_render_target){ 0 };
+  config->transition_clock = 0;
+  config->capture = NULL;
+  config->capture_stats = (rf_capture_stats){ 0 };
+  config->draw_skipped = FALSE;
+  config->stats_enabled = FALSE;
+  config->stats = (rf_graphics_stats){ 0 };
+  mrb_pacer_init(&(config->pacer));
+  config->batch_stats = (rf_batch_stats){ 0 };
+  mrb_batch_config_init(&(config->batch));
+  mrb_resolution_init(&(config->resolution));
+  for (int i = 0; i < ORGF_TRANSITION_CACHE_SIZE; ++i)
+  {
+    config->transitions[i].name = NULL;
+    config->transitions[i].last_used = 0;
+  }
   mrb_container_init(mrb, &(config->container));
   DATA_TYPE(self) = &config_type;
   DATA_PTR(self) = config;
@@ -588,7 +1534,7 @@ mrb_start_game(mrb_state *mrb, mrb_value self)
   center_window(config->window, glfwGetPrimaryMonitor());
   if (!config->window) mrb_raise(mrb, E_RUNTIME_ERROR, "Failed to create game screen");
   glfwMakeContextCurrent(config->window);
-  glfwSwapInterval(1);
+  apply_vsync(config);
   gladLoadGL();
   config->data = RF_DEFAULT_GFX_BACKEND_INIT_DATA;
 #endif
@@ -596,25 +1542,37 @@ mrb_start_game(mrb_state *mrb, mrb_value self)
   config->context.logger_filter = RF_LOG_TYPE_ALL;
   config->context.logger = RF_DEFAULT_LOGGER;
   rf_init_gfx((int)config->width, (int)config->height, config->data);
+  mrb_reset_blend_state();
   init_transition_shader();
+  init_opaque_shader();
   rf_allocator alloc = mrb_get_allocator(mrb);
-  config->render_batch = rf_create_default_render_batch(alloc);
+  config->render_batch = mrb_batch_create(&(config->batch), &(config->batch_stats), alloc);
   rf_set_active_render_batch(&(config->render_batch));
+  // Stats wrap the procs the batch installed, so they go in after it
+  if (config->stats_enabled) mrb_stats_enable(&(config->stats));
   config->is_open = 1;
+  mrb_disposal_open();
   config->render_texture = rf_load_render_texture((int)config->width, (int)config->height);
-  mrb_value tc = mrb_obj_value(mrb_class_get(mrb, "Time"));
-  mrb_iv_set(mrb, mrb_obj_value(graphics), LAST_UPDATE, mrb_funcall(mrb, tc, "now", 0));
+  rf_set_texture_filter(config->render_texture.texture, config->resolution.filter);
+  mrb_pacer_reset(&(config->pacer));
   config->dt = 0;
   mrb_bool error;
   mrb_value ret = mrb_protect(mrb, call_block, block, &error);
   if (error) mrb_exc_raise(mrb, ret);
+  stop_capture(mrb, config);
+  mrb_stats_disable();
   config->is_open = 0;
+  unload_transitions(config, mrb);
+  mrb_render_target_release(&(config->frozen_render));
+  mrb_render_target_pool_clear(mrb);
+  mrb_disposal_close(mrb);
+  mrb_quad_workers_stop();
 #ifdef ORGF_PLATFORM_GLFW
   glfwDestroyWindow(config->window);
   config->window = NULL;
   glfwTerminate();
 #endif
-  rf_unload_render_batch(config->render_batch, alloc);
+  mrb_batch_unload(config->render_batch, alloc);
   return mrb_nil_value();
 }
 
@@ -641,16 +1599,75 @@ mrb_init_orgf_graphics(mrb_state *mrb)
   mrb_define_module_function(mrb, graphics, "frame_count=", mrb_graphics_set_frame_count, MRB_ARGS_REQ(1));
   mrb_define_module_function(mrb, graphics, "brightness=", mrb_graphics_set_brightness, MRB_ARGS_REQ(1));
 
+  mrb_define_module_function(mrb, graphics, "vsync", mrb_graphics_get_vsync, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "vsync=", mrb_graphics_set_vsync, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "frame_skip", mrb_graphics_get_frame_skip, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "frame_skip=", mrb_graphics_set_frame_skip, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "skipped_frames", mrb_graphics_get_skipped_frames, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "frame_time", mrb_graphics_frame_time, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "frame_times", mrb_graphics_frame_times, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "dynamic_resolution", mrb_graphics_get_dynamic_resolution, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "dynamic_resolution=", mrb_graphics_set_dynamic_resolution, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "resolution_scale", mrb_graphics_get_resolution_scale, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "resolution_scale=", mrb_graphics_set_resolution_scale, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "min_resolution_scale", mrb_graphics_get_min_resolution_scale, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "min_resolution_scale=", mrb_graphics_set_min_resolution_scale, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "resolution_filter", mrb_graphics_get_resolution_filter, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "resolution_filter=", mrb_graphics_set_resolution_filter, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "resolution_stats", mrb_graphics_resolution_stats, MRB_ARGS_NONE());
+
+  mrb_define_module_function(mrb, graphics, "stats", mrb_graphics_stats, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "stats_enabled?", mrb_graphics_get_stats_enabled, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "stats_enabled=", mrb_graphics_set_stats_enabled, MRB_ARGS_REQ(1));
+
+  mrb_define_module_function(mrb, graphics, "batch_size", mrb_graphics_get_batch_size, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "batch_size=", mrb_graphics_set_batch_size, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "batch_buffers", mrb_graphics_get_batch_buffers, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "batch_buffers=", mrb_graphics_set_batch_buffers, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "batch_streaming", mrb_graphics_get_batch_streaming, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "batch_streaming=", mrb_graphics_set_batch_streaming, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "batch_stats", mrb_graphics_batch_stats, MRB_ARGS_NONE());
+
+  mrb_define_module_function(mrb, graphics, "vram_budget", mrb_graphics_get_vram_budget, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "vram_budget=", mrb_graphics_set_vram_budget, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "residency_stats", mrb_graphics_residency_stats, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "memory_stats", mrb_graphics_memory_stats, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "render_target_stats", mrb_graphics_render_target_stats, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "texture_format", mrb_graphics_get_texture_format, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "texture_format=", mrb_graphics_set_texture_format, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "set_texture_format", mrb_graphics_set_directory_texture_format, MRB_ARGS_REQ(2));
+  mrb_define_module_function(mrb, graphics, "texture_dither", mrb_graphics_get_texture_dither, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "texture_dither=", mrb_graphics_set_texture_dither, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "premultiplied_alpha", mrb_graphics_get_premultiplied_alpha, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "premultiplied_alpha=", mrb_graphics_set_premultiplied_alpha, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "max_texture_size", mrb_graphics_get_max_texture_size, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "max_texture_size=", mrb_graphics_set_max_texture_size, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "tile_budget", mrb_graphics_get_tile_budget, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "tile_budget=", mrb_graphics_set_tile_budget, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "tile_stats", mrb_graphics_tile_stats, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "disposal_budget", mrb_graphics_get_disposal_budget, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "disposal_budget=", mrb_graphics_set_disposal_budget, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "disposal_stats", mrb_graphics_disposal_stats, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "sprite_threads", mrb_graphics_get_sprite_threads, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "sprite_threads=", mrb_graphics_set_sprite_threads, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, graphics, "sprite_benchmark", mrb_graphics_sprite_benchmark, MRB_ARGS_OPT(1));
+
   mrb_define_module_function(mrb, graphics, "wait", mrb_graphics_wait, MRB_ARGS_REQ(1));
   mrb_define_module_function(mrb, graphics, "freeze", mrb_graphics_freeze, MRB_ARGS_NONE());
-  mrb_define_module_function(mrb, graphics, "snap_to_bitmap", mrb_graphics_snap_to_bitmap, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "snap_to_bitmap", mrb_graphics_snap_to_bitmap, MRB_ARGS_OPT(1));
   mrb_define_module_function(mrb, graphics, "frame_reset", mrb_graphics_frame_reset, MRB_ARGS_NONE());
   mrb_define_module_function(mrb, graphics, "play_movie", mrb_graphics_play_movie, MRB_ARGS_REQ(1));
 
+  mrb_define_module_function(mrb, graphics, "start_capture", mrb_graphics_start_capture, MRB_ARGS_REQ(1)|MRB_ARGS_OPT(1));
+  mrb_define_module_function(mrb, graphics, "stop_capture", mrb_graphics_stop_capture, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "capturing?", mrb_graphics_capturingQ, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, graphics, "capture_stats", mrb_graphics_capture_stats, MRB_ARGS_NONE());
+
   mrb_define_module_function(mrb, graphics, "fadeout", mrb_graphics_fadeout, MRB_ARGS_REQ(1));
   mrb_define_module_function(mrb, graphics, "fadein", mrb_graphics_fadein, MRB_ARGS_REQ(1));
 
   mrb_define_module_function(mrb, graphics, "transition", mrb_graphics_transition, MRB_ARGS_OPT(3));
+  mrb_define_module_function(mrb, graphics, "clear_transition_cache", mrb_graphics_clear_transition_cache, MRB_ARGS_NONE());
 
   mrb_define_module_function(mrb, graphics, "width", mrb_graphics_get_width, MRB_ARGS_NONE());
   mrb_define_module_function(mrb, graphics, "height", mrb_graphics_get_height, MRB_ARGS_NONE());
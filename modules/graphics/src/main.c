@@ -1,5 +1,7 @@
 #include <mruby.h>
 
+#include <orgf/texformat.h>
+
 void
 mrb_init_orgf_graphics(mrb_state *mrb);
 
@@ -27,6 +29,12 @@ mrb_init_orgf_plane(mrb_state *mrb);
 void
 mrb_init_orgf_window(mrb_state *mrb);
 
+void
+mrb_init_orgf_particle_emitter(mrb_state *mrb);
+
+void
+mrb_init_orgf_text_reveal(mrb_state *mrb);
+
 void
 mrb_orgf_graphics_gem_init(mrb_state *mrb)
 {
@@ -40,9 +48,12 @@ mrb_orgf_graphics_gem_init(mrb_state *mrb)
   mrb_init_orgf_sprite(mrb);
   mrb_init_orgf_plane(mrb);
   mrb_init_orgf_window(mrb);
+  mrb_init_orgf_particle_emitter(mrb);
+  mrb_init_orgf_text_reveal(mrb);
 }
 
 void
 mrb_orgf_graphics_gem_final(mrb_state *mrb)
 {
+  mrb_texture_policy_free(mrb);
 }
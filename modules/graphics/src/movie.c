@@ -0,0 +1,340 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PL_MPEG_IMPLEMENTATION
+#include <pl_mpeg.h>
+
+#include <orgf/file.h>
+#include <orgf/thread.h>
+#include <orgf/movie.h>
+#include <orgf/stats.h>
+
+#define CHUNK_FREE 0
+#define CHUNK_FILLED 1
+
+#define FRAME_FREE 0
+#define FRAME_READY 1
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#define GL_TEXTURE0 0x84C0
+#define GL_TEXTURE1 0x84C1
+#define GL_TEXTURE2 0x84C2
+#define GL_TEXTURE_2D 0x0DE1
+
+const char *MRB_MOVIE_EXTENSIONS[] = {
+  "",
+  ".mpg",
+  ".mpeg",
+  NULL
+};
+
+static rf_shader yuv_shader;
+
+static struct
+{
+  int cb, cr;
+} yuv_shader_locations;
+
+static mrb_bool yuv_shader_ready = FALSE;
+
+static const char *yuv_frag =
+#if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
+  "#version 100\n"
+  "precision mediump float;"
+  "varying vec2 frag_tex_coord;"
+  "varying vec4 frag_color;"
+#elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+  "#version 330\n"
+  "precision mediump float;"
+  "in vec2 frag_tex_coord;"
+  "in vec4 frag_color;"
+  "out vec4 final_color;"
+#endif
+  "uniform sampler2D texture0;"
+  "uniform sampler2D cb;"
+  "uniform sampler2D cr;"
+  "uniform vec4 col_diffuse;"
+  "void main()"
+  "{"
+#if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
+  "    float y = texture2D(texture0, frag_tex_coord).r;"
+  "    float u = texture2D(cb, frag_tex_coord).r - 0.5;"
+  "    float v = texture2D(cr, frag_tex_coord).r - 0.5;"
+#elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+  "    float y = texture(texture0, frag_tex_coord).r;"
+  "    float u = texture(cb, frag_tex_coord).r - 0.5;"
+  "    float v = texture(cr, frag_tex_coord).r - 0.5;"
+#endif
+  "    y = 1.16438 * (y - 0.0627451);"
+  "    vec4 texel_color = vec4(y + 1.59603 * v, y - 0.39176 * u - 0.81297 * v, y + 2.01723 * u, 1.0);"
+#if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
+  "    gl_FragColor = texel_color*col_diffuse*frag_color;"
+#elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+  "    final_color = texel_color*col_diffuse*frag_color;"
+#endif
+"}";
+
+static void
+init_yuv_shader(void)
+{
+  int cb_unit = 1, cr_unit = 2;
+  yuv_shader = rf_gfx_load_shader(NULL, yuv_frag);
+  yuv_shader_locations.cb = rf_gfx_get_shader_location(yuv_shader, "cb");
+  yuv_shader_locations.cr = rf_gfx_get_shader_location(yuv_shader, "cr");
+  rf_gfx_set_shader_value(yuv_shader, yuv_shader_locations.cb, &cb_unit, RF_UNIFORM_INT);
+  rf_gfx_set_shader_value(yuv_shader, yuv_shader_locations.cr, &cr_unit, RF_UNIFORM_INT);
+  yuv_shader_ready = TRUE;
+}
+
+static void
+load_chunk(plm_buffer_t *buffer, void *user)
+{
+  rf_movie *movie = user;
+  for (;;)
+  {
+    // The end mark is read first, so a chunk filled right before it is never missed
+    long end_of_file = orgf_atomic_load(&(movie->end_of_file));
+    rf_movie_chunk *chunk = &(movie->chunks[movie->chunk_tail % ORGF_MOVIE_CHUNKS]);
+    if (orgf_atomic_load(&(chunk->state)) == CHUNK_FILLED)
+    {
+      plm_buffer_write(buffer, chunk->data, chunk->size);
+      movie->chunk_tail += 1;
+      orgf_atomic_store(&(chunk->state), CHUNK_FREE);
+      return;
+    }
+    if (end_of_file || !orgf_atomic_load(&(movie->running)))
+    {
+      plm_buffer_signal_end(buffer);
+      return;
+    }
+    orgf_thread_sleep(1);
+  }
+}
+
+static void
+copy_plane(rf_movie_plane *dst, plm_plane_t *src)
+{
+  size_t size = (size_t)src->width * src->height;
+  if (dst->width != (int)src->width || dst->height != (int)src->height)
+  {
+    free(dst->data);
+    dst->data = malloc(size);
+    dst->width = (int)src->width;
+    dst->height = (int)src->height;
+  }
+  if (dst->data) memcpy(dst->data, src->data, size);
+}
+
+static void
+decode_movie(void *data)
+{
+  rf_movie *movie = data;
+  plm_buffer_t *buffer = plm_buffer_create_with_capacity(ORGF_MOVIE_CHUNK_SIZE * 2);
+  plm_buffer_set_load_callback(buffer, load_chunk, movie);
+  plm_t *plm = plm_create_with_buffer(buffer, TRUE);
+  plm_set_audio_enabled(plm, FALSE);
+  while (orgf_atomic_load(&(movie->running)))
+  {
+    rf_movie_frame *slot = &(movie->frames[movie->frame_head % ORGF_MOVIE_FRAMES]);
+    if (orgf_atomic_load(&(slot->state)) != FRAME_FREE)
+    {
+      orgf_thread_sleep(1);
+      continue;
+    }
+    plm_frame_t *frame = plm_decode_video(plm);
+    if (!frame) break;
+    slot->time = frame->time;
+    slot->width = (int)frame->width;
+    slot->height = (int)frame->height;
+    copy_plane(&(slot->planes[0]), &(frame->y));
+    copy_plane(&(slot->planes[1]), &(frame->cb));
+    copy_plane(&(slot->planes[2]), &(frame->cr));
+    movie->frame_head += 1;
+    orgf_atomic_store(&(slot->state), FRAME_READY);
+  }
+  plm_destroy(plm);
+  orgf_atomic_store(&(movie->decoded_all), 1);
+}
+
+static void
+fill_chunks(mrb_state *mrb, rf_movie *movie)
+{
+  while (!orgf_atomic_load(&(movie->end_of_file)))
+  {
+    rf_movie_chunk *chunk = &(movie->chunks[movie->chunk_head % ORGF_MOVIE_CHUNKS]);
+    if (orgf_atomic_load(&(chunk->state)) != CHUNK_FREE) break;
+    size_t size = mrb_file_read(movie->file, ORGF_MOVIE_CHUNK_SIZE, (char *)chunk->data);
+    if (!size)
+    {
+      orgf_atomic_store(&(movie->end_of_file), 1);
+      break;
+    }
+    chunk->size = size;
+    movie->chunk_head += 1;
+    orgf_atomic_store(&(chunk->state), CHUNK_FILLED);
+  }
+}
+
+static rf_texture2d
+load_plane_texture(rf_movie_plane *plane)
+{
+  rf_image image;
+  image.data   = plane->data;
+  image.width  = plane->width;
+  image.height = plane->height;
+  image.format = RF_UNCOMPRESSED_GRAYSCALE;
+  image.valid  = true;
+  rf_texture2d texture = rf_load_texture_from_image(image);
+  rf_set_texture_filter(texture, RF_FILTER_BILINEAR);
+  return texture;
+}
+
+static void
+upload_frame(rf_movie *movie, rf_movie_frame *frame)
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    rf_movie_plane *plane = &(frame->planes[i]);
+    rf_texture2d *texture = &(movie->textures[i]);
+    if (!plane->data) return;
+    if (texture->width != plane->width || texture->height != plane->height)
+    {
+      if (texture->id) rf_unload_texture(*texture);
+      *texture = load_plane_texture(plane);
+    }
+    else
+    {
+      rf_update_texture(*texture, plane->data, plane->width * plane->height);
+    }
+  }
+  movie->width = frame->width;
+  movie->height = frame->height;
+}
+
+rf_movie *
+mrb_movie_open(mrb_state *mrb, const char *name)
+{
+  mrb_file *file = mrb_file_open_read_with_extensions(mrb, name, MRB_MOVIE_EXTENSIONS);
+  rf_movie *movie = mrb_malloc(mrb, sizeof *movie);
+  memset(movie, 0, sizeof *movie);
+  movie->file = file;
+  movie->running = 1;
+  fill_chunks(mrb, movie);
+  if (!orgf_thread_start(&(movie->decoder), decode_movie, movie))
+  {
+    mrb_file_close(file);
+    mrb_free(mrb, movie);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "Failed to start movie decoder");
+  }
+  return movie;
+}
+
+void
+mrb_movie_update(mrb_state *mrb, rf_movie *movie, mrb_float dt, mrb_bool upload)
+{
+  fill_chunks(mrb, movie);
+  // Only the newest frame that is already due gets shown, older ones are late.
+  rf_movie_frame *due = NULL;
+  for (;;)
+  {
+    rf_movie_frame *frame = &(movie->frames[movie->frame_tail % ORGF_MOVIE_FRAMES]);
+    if (orgf_atomic_load(&(frame->state)) != FRAME_READY) break;
+    if (!movie->started)
+    {
+      movie->clock = frame->time;
+      movie->started = TRUE;
+    }
+    if (frame->time > movie->clock) break;
+    if (due)
+    {
+      orgf_atomic_store(&(due->state), FRAME_FREE);
+      movie->dropped += 1;
+    }
+    due = frame;
+    movie->frame_tail += 1;
+  }
+  if (due)
+  {
+    if (upload) upload_frame(movie, due);
+    orgf_atomic_store(&(due->state), FRAME_FREE);
+    movie->presented += 1;
+  }
+  if (movie->started) movie->clock += dt;
+}
+
+void
+mrb_movie_draw(rf_movie *movie, float width, float height)
+{
+  if (!movie->textures[0].id || !movie->width || !movie->height) return;
+  if (!yuv_shader_ready) init_yuv_shader();
+
+  float sx = width / (float)movie->width;
+  float sy = height / (float)movie->height;
+  float scale = sx < sy ? sx : sy;
+  float w = movie->width * scale;
+  float h = movie->height * scale;
+  float x = (width - w) / 2;
+  float y = (height - h) / 2;
+  // Planes are padded to whole macroblocks
+  float u = (float)movie->width / (float)movie->textures[0].width;
+  float v = (float)movie->height / (float)movie->textures[0].height;
+
+  rf_gl.ActiveTexture(GL_TEXTURE1);
+  rf_gl.BindTexture(GL_TEXTURE_2D, movie->textures[1].id);
+  rf_gl.ActiveTexture(GL_TEXTURE2);
+  rf_gl.BindTexture(GL_TEXTURE_2D, movie->textures[2].id);
+  rf_gl.ActiveTexture(GL_TEXTURE0);
+  rf_begin_shader(yuv_shader);
+    rf_gfx_enable_texture(movie->textures[0].id);
+    rf_gfx_begin(RF_QUADS);
+      rf_gfx_color4ub(255, 255, 255, 255);
+      rf_gfx_tex_coord2f(0.0f, 0.0f);
+      rf_gfx_vertex2f(x, y);
+      rf_gfx_tex_coord2f(0.0f, v);
+      rf_gfx_vertex2f(x, y + h);
+      rf_gfx_tex_coord2f(u, v);
+      rf_gfx_vertex2f(x + w, y + h);
+      rf_gfx_tex_coord2f(u, 0.0f);
+      rf_gfx_vertex2f(x + w, y);
+    rf_gfx_end();
+    rf_gfx_disable_texture();
+  // Ending the shader flushes the batch while the chroma planes are still bound
+  ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
+  rf_end_shader();
+  ORGF_STATS_SETTLE();
+  rf_gl.ActiveTexture(GL_TEXTURE1);
+  rf_gl.BindTexture(GL_TEXTURE_2D, 0);
+  rf_gl.ActiveTexture(GL_TEXTURE2);
+  rf_gl.BindTexture(GL_TEXTURE_2D, 0);
+  rf_gl.ActiveTexture(GL_TEXTURE0);
+}
+
+mrb_bool
+mrb_movie_finished(rf_movie *movie)
+{
+  if (!orgf_atomic_load(&(movie->decoded_all))) return FALSE;
+  rf_movie_frame *frame = &(movie->frames[movie->frame_tail % ORGF_MOVIE_FRAMES]);
+  return orgf_atomic_load(&(frame->state)) != FRAME_READY;
+}
+
+void
+mrb_movie_close(mrb_state *mrb, rf_movie *movie)
+{
+  mrb_file *file = movie->file;
+  orgf_atomic_store(&(movie->running), 0);
+  orgf_thread_join(movie->decoder);
+  for (int i = 0; i < ORGF_MOVIE_FRAMES; ++i)
+  {
+    for (int j = 0; j < 3; ++j) free(movie->frames[i].planes[j].data);
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    if (movie->textures[i].id) rf_unload_texture(movie->textures[i]);
+  }
+  mrb_free(mrb, movie);
+  mrb_file_close(file);
+}
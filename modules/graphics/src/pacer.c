@@ -0,0 +1,130 @@
+#include <mruby.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <orgf/thread.h>
+#include <orgf/pacer.h>
+
+#define NS_PER_SECOND 1000000000ull
+#define NS_PER_MS 1000000ull
+
+static inline uint64_t
+frame_period(mrb_int frame_rate)
+{
+  return NS_PER_SECOND / (uint64_t)(frame_rate > 0 ? frame_rate : 60);
+}
+
+static int
+compare_samples(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+void
+mrb_pacer_init(rf_frame_pacer *pacer)
+{
+  memset(pacer, 0, sizeof *pacer);
+  pacer->vsync = RF_VSYNC_ON;
+  pacer->max_skip = 2;
+  pacer->sleep_overshoot = NS_PER_MS;
+}
+
+void
+mrb_pacer_reset(rf_frame_pacer *pacer)
+{
+  pacer->last_frame = orgf_time_ns();
+  pacer->deadline = 0;
+  pacer->skipped_in_row = 0;
+  pacer->sample_count = 0;
+  pacer->sample_index = 0;
+}
+
+void
+mrb_pacer_wait(rf_frame_pacer *pacer, mrb_int frame_rate)
+{
+  uint64_t period = frame_period(frame_rate);
+  uint64_t now = orgf_time_ns();
+  // Frame skip may only catch up a few frames, a plain limiter none at all
+  uint64_t lag = pacer->frame_skip ? period * (uint64_t)(pacer->max_skip + 1) : 0;
+  if (!pacer->deadline) pacer->deadline = pacer->last_frame + period;
+  if (now > pacer->deadline + lag)
+  {
+    pacer->deadline = now + period;
+    return;
+  }
+  // Sleep while the deadline is further away than a sleep could overshoot
+  while (pacer->deadline > now && pacer->deadline - now > pacer->sleep_overshoot + ORGF_PACER_SPIN_NS)
+  {
+    orgf_thread_sleep(1);
+    uint64_t after = orgf_time_ns();
+    uint64_t slept = after - now;
+    uint64_t overshoot = slept > NS_PER_MS ? slept - NS_PER_MS : 0;
+    if (overshoot > pacer->sleep_overshoot)
+    {
+      pacer->sleep_overshoot = overshoot;
+    }
+    else
+    {
+      pacer->sleep_overshoot -= (pacer->sleep_overshoot - overshoot) / 16;
+    }
+    now = after;
+  }
+  while (now < pacer->deadline) now = orgf_time_ns();
+  pacer->deadline += period;
+}
+
+mrb_float
+mrb_pacer_tick(rf_frame_pacer *pacer, mrb_int frame_rate)
+{
+  uint64_t now = orgf_time_ns();
+  uint64_t elapsed = pacer->last_frame ? now - pacer->last_frame : frame_period(frame_rate);
+  pacer->last_frame = now;
+  pacer->samples[pacer->sample_index] = elapsed;
+  pacer->sample_index = (pacer->sample_index + 1) % ORGF_PACER_SAMPLES;
+  if (pacer->sample_count < ORGF_PACER_SAMPLES) pacer->sample_count += 1;
+  return (mrb_float)elapsed / (mrb_float)NS_PER_SECOND;
+}
+
+mrb_bool
+mrb_pacer_should_skip(rf_frame_pacer *pacer)
+{
+  if (!pacer->frame_skip || !pacer->deadline) return FALSE;
+  uint64_t now = orgf_time_ns();
+  // Already late for the next frame, but never starve the screen for too long
+  if (now > pacer->deadline && pacer->skipped_in_row < pacer->max_skip)
+  {
+    pacer->skipped_in_row += 1;
+    pacer->skipped += 1;
+    return TRUE;
+  }
+  pacer->skipped_in_row = 0;
+  return FALSE;
+}
+
+mrb_float
+mrb_pacer_percentile(rf_frame_pacer *pacer, mrb_float percentile)
+{
+  uint64_t sorted[ORGF_PACER_SAMPLES];
+  mrb_int count = pacer->sample_count;
+  if (!count) return 0;
+  if (percentile < 0) percentile = 0;
+  if (percentile > 100) percentile = 100;
+  memcpy(sorted, pacer->samples, sizeof(uint64_t) * count);
+  qsort(sorted, (size_t)count, sizeof(uint64_t), compare_samples);
+  mrb_int rank = (mrb_int)(percentile / 100 * count + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > count) rank = count;
+  return (mrb_float)sorted[rank - 1] / (mrb_float)NS_PER_MS;
+}
+
+mrb_float
+mrb_pacer_average(rf_frame_pacer *pacer)
+{
+  uint64_t total = 0;
+  if (!pacer->sample_count) return 0;
+  for (mrb_int i = 0; i < pacer->sample_count; ++i) total += pacer->samples[i];
+  return (mrb_float)total / (mrb_float)pacer->sample_count / (mrb_float)NS_PER_MS;
+}
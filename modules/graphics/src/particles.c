@@ -0,0 +1,822 @@
+#include <mruby.h>
+#include <mruby/data.h>
+#include <mruby/variable.h>
+#include <mruby/class.h>
+#include <mruby/array.h>
+
+#include <rayfork.h>
+#include <math.h>
+#include <string.h>
+
+#include <orgf/simd.h>
+#include <orgf/blend.h>
+#include <orgf/drawable.h>
+#include <orgf/point.h>
+#include <orgf/rect.h>
+#include <orgf/color.h>
+#include <orgf/bitmap.h>
+#include <orgf/particles.h>
+#include <orgf/viewport.h>
+#include <orgf/graphics.h>
+
+#define BITMAP mrb_intern_cstr(mrb, "#bitmap")
+#define SRC_RECT mrb_intern_cstr(mrb, "#src_rect")
+#define POSITION mrb_intern_cstr(mrb, "#position")
+#define AREA mrb_intern_cstr(mrb, "#area")
+#define GRAVITY mrb_intern_cstr(mrb, "#gravity")
+#define START_COLOR mrb_intern_cstr(mrb, "#start_color")
+#define END_COLOR mrb_intern_cstr(mrb, "#end_color")
+#define VIEWPORT mrb_intern_cstr(mrb, "#viewport")
+
+#define DEFAULT_CAPACITY 1024
+#define MAX_CAPACITY (1 << 20)
+#define QUADS_PER_BATCH 1024
+
+static void
+free_particles(mrb_state *mrb, rf_particles *particles)
+{
+  mrb_free(mrb, particles->x);
+  particles->x = NULL;
+  particles->size = particles->capa = 0;
+}
+
+static void
+free_particle_emitter(mrb_state *mrb, void *p)
+{
+  if (p)
+  {
+    rf_particle_emitter *emitter = p;
+    mrb_container_remove_child(mrb, emitter->base.container, p);
+    free_particles(mrb, &(emitter->particles));
+    mrb_free(mrb, emitter);
+  }
+}
+
+const struct mrb_data_type mrb_particle_emitter_data_type = {
+  "ParticleEmitter", free_particle_emitter
+};
+
+static void
+resize_particles(mrb_state *mrb, rf_particles *particles, mrb_int capa)
+{
+  // Every float field lives in the same block, one after the other,
+  // followed by the packed colors.
+  size_t floats = (size_t)capa * 9 * sizeof(float);
+  size_t colors = (size_t)capa * sizeof(rf_color);
+  char *block = mrb_malloc(mrb, floats + colors);
+  rf_particles resized;
+  resized.x        = (float *)block;
+  resized.y        = resized.x + capa;
+  resized.vx       = resized.y + capa;
+  resized.vy       = resized.vx + capa;
+  resized.life     = resized.vy + capa;
+  resized.inv_life = resized.life + capa;
+  resized.scale    = resized.inv_life + capa;
+  resized.rotation = resized.scale + capa;
+  resized.spin     = resized.rotation + capa;
+  resized.color    = (rf_color *)(block + floats);
+  resized.capa     = capa;
+  resized.size     = particles->size < capa ? particles->size : capa;
+  if (particles->x)
+  {
+    size_t n = (size_t)resized.size;
+    memcpy(resized.x, particles->x, n * sizeof(float));
+    memcpy(resized.y, particles->y, n * sizeof(float));
+    memcpy(resized.vx, particles->vx, n * sizeof(float));
+    memcpy(resized.vy, particles->vy, n * sizeof(float));
+    memcpy(resized.life, particles->life, n * sizeof(float));
+    memcpy(resized.inv_life, particles->inv_life, n * sizeof(float));
+    memcpy(resized.scale, particles->scale, n * sizeof(float));
+    memcpy(resized.rotation, particles->rotation, n * sizeof(float));
+    memcpy(resized.spin, particles->spin, n * sizeof(float));
+    memcpy(resized.color, particles->color, n * sizeof(rf_color));
+    mrb_free(mrb, particles->x);
+  }
+  *particles = resized;
+}
+
+static inline float
+random_float(rf_particle_emitter *emitter)
+{
+  uint32_t s = emitter->seed;
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  emitter->seed = s;
+  return (float)(s >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float
+random_range(rf_particle_emitter *emitter, float min, float max)
+{
+  return min + (max - min) * random_float(emitter);
+}
+
+static void
+spawn_particles(rf_particle_emitter *emitter, mrb_int count)
+{
+  rf_particles *p = &(emitter->particles);
+  mrb_int left = p->capa - p->size;
+  if (count > left) count = left;
+  for (mrb_int k = 0; k < count; ++k)
+  {
+    mrb_int i = p->size++;
+    float angle = emitter->angle + emitter->spread * (random_float(emitter) - 0.5f);
+    float speed = random_range(emitter, emitter->speed_min, emitter->speed_max);
+    float life = random_range(emitter, emitter->life_min, emitter->life_max);
+    angle *= RF_PI / 180.0f;
+    if (life <= 0) life = 0.001f;
+    p->x[i] = emitter->position->x + emitter->area->x * (random_float(emitter) - 0.5f);
+    p->y[i] = emitter->position->y + emitter->area->y * (random_float(emitter) - 0.5f);
+    p->vx[i] = cosf(angle) * speed;
+    p->vy[i] = sinf(angle) * speed;
+    p->life[i] = life;
+    p->inv_life[i] = 1.0f / life;
+    p->scale[i] = emitter->start_scale;
+    p->rotation[i] = 0;
+    p->spin[i] = emitter->spin;
+    p->color[i] = *(emitter->start_color);
+  }
+}
+
+static void
+integrate_particles(rf_particles *p, float gx, float gy, float dt)
+{
+  float *ORGF_RESTRICT x = p->x;
+  float *ORGF_RESTRICT y = p->y;
+  float *ORGF_RESTRICT vx = p->vx;
+  float *ORGF_RESTRICT vy = p->vy;
+  float *ORGF_RESTRICT life = p->life;
+  float *ORGF_RESTRICT rotation = p->rotation;
+  const float *ORGF_RESTRICT spin = p->spin;
+  mrb_int n = p->size;
+  mrb_int i = 0;
+  gx *= dt;
+  gy *= dt;
+#ifdef ORGF_SIMD_SSE2
+  __m128 vdt = _mm_set1_ps(dt);
+  __m128 vgx = _mm_set1_ps(gx);
+  __m128 vgy = _mm_set1_ps(gy);
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 nvx = _mm_add_ps(_mm_loadu_ps(vx + i), vgx);
+    __m128 nvy = _mm_add_ps(_mm_loadu_ps(vy + i), vgy);
+    _mm_storeu_ps(vx + i, nvx);
+    _mm_storeu_ps(vy + i, nvy);
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(nvx, vdt)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(nvy, vdt)));
+    _mm_storeu_ps(rotation + i, _mm_add_ps(_mm_loadu_ps(rotation + i), _mm_mul_ps(_mm_loadu_ps(spin + i), vdt)));
+    _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), vdt));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    vx[i] += gx;
+    vy[i] += gy;
+    x[i] += vx[i] * dt;
+    y[i] += vy[i] * dt;
+    rotation[i] += spin[i] * dt;
+    life[i] -= dt;
+  }
+}
+
+static void
+age_particles(rf_particle_emitter *emitter)
+{
+  rf_particles *p = &(emitter->particles);
+  const float *ORGF_RESTRICT life = p->life;
+  const float *ORGF_RESTRICT inv_life = p->inv_life;
+  float *ORGF_RESTRICT scale = p->scale;
+  rf_color *ORGF_RESTRICT color = p->color;
+  rf_color c0 = *(emitter->start_color);
+  rf_color c1 = *(emitter->end_color);
+  float s0 = emitter->start_scale;
+  float ds = emitter->end_scale - s0;
+  float dr = (float)(c1.r - c0.r), dg = (float)(c1.g - c0.g);
+  float db = (float)(c1.b - c0.b), da = (float)(c1.a - c0.a);
+  mrb_int n = p->size;
+  for (mrb_int i = 0; i < n; ++i)
+  {
+    float t = 1.0f - life[i] * inv_life[i];
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    scale[i] = s0 + ds * t;
+    color[i].r = (unsigned char)(c0.r + dr * t);
+    color[i].g = (unsigned char)(c0.g + dg * t);
+    color[i].b = (unsigned char)(c0.b + db * t);
+    color[i].a = (unsigned char)(c0.a + da * t);
+  }
+}
+
+static void
+remove_dead_particles(rf_particles *p)
+{
+  mrb_int i = 0;
+  while (i < p->size)
+  {
+    if (p->life[i] > 0)
+    {
+      ++i;
+      continue;
+    }
+    mrb_int last = --p->size;
+    p->x[i] = p->x[last];
+    p->y[i] = p->y[last];
+    p->vx[i] = p->vx[last];
+    p->vy[i] = p->vy[last];
+    p->life[i] = p->life[last];
+    p->inv_life[i] = p->inv_life[last];
+    p->scale[i] = p->scale[last];
+    p->rotation[i] = p->rotation[last];
+    p->spin[i] = p->spin[last];
+    p->color[i] = p->color[last];
+  }
+}
+
+static void
+rf_update_particle_emitter(mrb_state *mrb, rf_particle_emitter *emitter)
+{
+  float dt = (float)mrb_get_dt(mrb);
+  if (dt <= 0) return;
+  if (emitter->emitting && emitter->rate > 0)
+  {
+    emitter->pending += emitter->rate * dt;
+    mrb_int count = (mrb_int)emitter->pending;
+    emitter->pending -= (float)count;
+    spawn_particles(emitter, count);
+  }
+  if (!emitter->particles.size) return;
+  integrate_particles(&(emitter->particles), emitter->gravity->x, emitter->gravity->y, dt);
+  age_particles(emitter);
+  remove_dead_particles(&(emitter->particles));
+}
+
+static void
+rf_draw_particle_emitter(mrb_state *mrb, rf_particle_emitter *emitter)
+{
+  rf_particles *p = &(emitter->particles);
+  if (mrb_nil_p(emitter->bitmap) || !p->size) return;
+
+  rf_bitmap *bitmap = DATA_PTR(emitter->bitmap);
+  if (!bitmap) return;
+
+  mrb_refresh_bitmap(mrb, bitmap);
+  rf_texture2d texture = bitmap->texture;
+  if (texture.id <= 0) return;
+  if (!texture.valid) return;
+
+  rf_rec src = *(emitter->src_rect);
+  if (src.width <= 0 || src.height <= 0) return;
+
+  float u0 = src.x / (float)texture.width;
+  float v0 = src.y / (float)texture.height;
+  float u1 = (src.x + src.width) / (float)texture.width;
+  float v1 = (src.y + src.height) / (float)texture.height;
+  float hw = src.width / 2;
+  float hh = src.height / 2;
+
+  rf_gfx_enable_texture(texture.id);
+  ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+  mrb_begin_blend_mode(emitter->blend_mode);
+  for (mrb_int start = 0; start < p->size; start += QUADS_PER_BATCH)
+  {
+    mrb_int end = start + QUADS_PER_BATCH;
+    if (end > p->size) end = p->size;
+    if (rf_gfx_check_buffer_limit((int)(end - start) * 4)) rf_gfx_draw();
+    rf_gfx_begin(RF_QUADS);
+    for (mrb_int i = start; i < end; ++i)
+    {
+      rf_color color = mrb_blend_color(p->color[i], emitter->blend_mode);
+      float w = hw * p->scale[i];
+      float h = hh * p->scale[i];
+      float angle = p->rotation[i] * (RF_PI / 180.0f);
+      float c = cosf(angle), s = sinf(angle);
+      // a is the rotated half width axis and b the rotated half height one,
+      // so the corners are center - a - b, center - a + b, center + a + b and center + a - b
+      float ax = w * c, ay = w * s;
+      float bx = -h * s, by = h * c;
+      float cx = p->x[i], cy = p->y[i];
+      // Top-left corner for texture and quad
+      rf_gfx_color4ub(color.r, color.g, color.b, color.a);
+      rf_gfx_tex_coord2f(u0, v0);
+      rf_gfx_vertex2f(cx - ax - bx, cy - ay - by);
+      // Bottom-left corner for texture and quad
+      rf_gfx_color4ub(color.r, color.g, color.b, color.a);
+      rf_gfx_tex_coord2f(u0, v1);
+      rf_gfx_vertex2f(cx - ax + bx, cy - ay + by);
+      // Bottom-right corner for texture and quad
+      rf_gfx_color4ub(color.r, color.g, color.b, color.a);
+      rf_gfx_tex_coord2f(u1, v1);
+      rf_gfx_vertex2f(cx + ax + bx, cy + ay + by);
+      // Top-right corner for texture and quad
+      rf_gfx_color4ub(color.r, color.g, color.b, color.a);
+      rf_gfx_tex_coord2f(u1, v0);
+      rf_gfx_vertex2f(cx + ax - bx, cy + ay - by);
+    }
+    rf_gfx_end();
+  }
+  ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+  mrb_end_blend_mode();
+  rf_gfx_disable_texture();
+}
+
+static mrb_value
+mrb_particle_emitter_initialize(mrb_state *mrb, mrb_value self)
+{
+  DATA_TYPE(self) = &mrb_particle_emitter_data_type;
+  rf_particle_emitter *emitter = mrb_malloc(mrb, sizeof *emitter);
+  DATA_PTR(self) = emitter;
+  rf_container *parent;
+  emitter->base.container = NULL;
+  emitter->base.z = 0;
+  emitter->base.tick = (rf_drawable_update_callback)rf_update_particle_emitter;
+  emitter->base.update = NULL;
+  emitter->base.draw = (rf_drawable_draw_callback)rf_draw_particle_emitter;
+  emitter->base.draw_run = NULL;
+  emitter->base.visible = TRUE;
+  emitter->particles.x = NULL;
+  emitter->particles.size = 0;
+  emitter->particles.capa = 0;
+  resize_particles(mrb, &(emitter->particles), DEFAULT_CAPACITY);
+  emitter->bitmap = mrb_nil_value();
+  emitter->rate = 0;
+  emitter->pending = 0;
+  emitter->life_min = emitter->life_max = 1;
+  emitter->speed_min = emitter->speed_max = 0;
+  emitter->angle = -90;
+  emitter->spread = 0;
+  emitter->start_scale = emitter->end_scale = 1;
+  emitter->spin = 0;
+  emitter->seed = (uint32_t)(((uintptr_t)emitter >> 4) | 1);
+  emitter->blend_mode = RF_BLEND_ALPHA;
+  emitter->emitting = TRUE;
+  mrb_value position = mrb_point_new(mrb, 0, 0);
+  mrb_value area = mrb_point_new(mrb, 0, 0);
+  mrb_value gravity = mrb_point_new(mrb, 0, 0);
+  mrb_value start_color = mrb_color_white(mrb);
+  mrb_value end_color = mrb_color_white(mrb);
+  mrb_value src_rect = mrb_rect_new(mrb, 0, 0, 0, 0);
+  emitter->position = mrb_get_point(mrb, position);
+  emitter->area = mrb_get_point(mrb, area);
+  emitter->gravity = mrb_get_point(mrb, gravity);
+  emitter->start_color = mrb_get_color(mrb, start_color);
+  emitter->end_color = mrb_get_color(mrb, end_color);
+  emitter->src_rect = mrb_get_rect(mrb, src_rect);
+  mrb_iv_set(mrb, self, POSITION, position);
+  mrb_iv_set(mrb, self, AREA, area);
+  mrb_iv_set(mrb, self, GRAVITY, gravity);
+  mrb_iv_set(mrb, self, START_COLOR, start_color);
+  mrb_iv_set(mrb, self, END_COLOR, end_color);
+  mrb_iv_set(mrb, self, SRC_RECT, src_rect);
+  mrb_iv_set(mrb, self, BITMAP, mrb_nil_value());
+  mrb_value parent_value = mrb_nil_value();
+  mrb_int argc = mrb_get_args(mrb, "|o", &parent_value);
+  if (argc && !mrb_nil_p(parent_value))
+  {
+    if (!mrb_viewport_p(parent_value)) mrb_raise(mrb, E_ARGUMENT_ERROR, "parent must be a Viewport");
+    rf_viewport *viewport = mrb_get_viewport(mrb, parent_value);
+    parent = &(viewport->base);
+    mrb_iv_set(mrb, self, VIEWPORT, parent_value);
+  }
+  else
+  {
+    parent = mrb_get_graphics_container(mrb);
+    mrb_iv_set(mrb, self, VIEWPORT, mrb_nil_value());
+  }
+  mrb_container_add_child(mrb, parent, &(emitter->base));
+  return self;
+}
+
+static mrb_value
+mrb_particle_emitter_disposedQ(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(DATA_PTR(self) ? 0 : 1);
+}
+
+static mrb_value
+mrb_particle_emitter_dispose(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  free_particle_emitter(mrb, emitter);
+  DATA_PTR(self) = NULL;
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_particle_emitter_emit(mrb_state *mrb, mrb_value self)
+{
+  mrb_int count = 1;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "|i", &count);
+  if (count > 0) spawn_particles(emitter, count);
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_particle_emitter_clear(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->particles.size = 0;
+  emitter->pending = 0;
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_particle_emitter_get_count(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_fixnum_value(emitter->particles.size);
+}
+
+static mrb_value
+mrb_particle_emitter_get_capacity(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_fixnum_value(emitter->particles.capa);
+}
+
+static mrb_value
+mrb_particle_emitter_set_capacity(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "i", &value);
+  if (value < 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "Capacity must be positive");
+  if (value > MAX_CAPACITY) mrb_raisef(mrb, E_ARGUMENT_ERROR, "Capacity can't be bigger than %d", MAX_CAPACITY);
+  if (value != emitter->particles.capa)
+  {
+    resize_particles(mrb, &(emitter->particles), value);
+  }
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_z(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_fixnum_value(emitter->base.z);
+}
+
+static mrb_value
+mrb_particle_emitter_set_z(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "i", &value);
+  if (emitter->base.z != value)
+  {
+    emitter->base.z = value;
+    mrb_container_invalidate(mrb, emitter->base.container);
+  }
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_visible(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_bool_value(emitter->base.visible);
+}
+
+static mrb_value
+mrb_particle_emitter_set_visible(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "b", &value);
+  emitter->base.visible = value;
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_emitting(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_bool_value(emitter->emitting);
+}
+
+static mrb_value
+mrb_particle_emitter_set_emitting(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool value;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "b", &value);
+  emitter->emitting = value;
+  return mrb_bool_value(value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_blend_mode(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_fixnum_value(emitter->blend_mode);
+}
+
+static mrb_value
+mrb_particle_emitter_set_blend_mode(mrb_state *mrb, mrb_value self)
+{
+  mrb_int value;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "i", &value);
+  emitter->blend_mode = (rf_blend_mode)value;
+  return mrb_fixnum_value(value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_viewport(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, VIEWPORT);
+}
+
+static mrb_value
+mrb_particle_emitter_set_viewport(mrb_state *mrb, mrb_value self)
+{
+  mrb_value parent_value;
+  mrb_get_args(mrb, "o", &parent_value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  if (mrb_nil_p(parent_value))
+  {
+    mrb_container_add_child(mrb, mrb_get_graphics_container(mrb), &(emitter->base));
+    mrb_iv_set(mrb, self, VIEWPORT, parent_value);
+    return parent_value;
+  }
+  if (!mrb_viewport_p(parent_value))
+  {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "value is not a Viewport");
+  }
+  rf_viewport *view = mrb_get_viewport(mrb, parent_value);
+  mrb_container_add_child(mrb, &(view->base), &(emitter->base));
+  mrb_iv_set(mrb, self, VIEWPORT, parent_value);
+  return parent_value;
+}
+
+static mrb_value
+mrb_particle_emitter_get_bitmap(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, BITMAP);
+}
+
+static mrb_value
+mrb_particle_emitter_set_bitmap(mrb_state *mrb, mrb_value self)
+{
+  mrb_value value;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_get_args(mrb, "o", &value);
+  if (mrb_nil_p(value))
+  {
+    emitter->bitmap = mrb_nil_value();
+  }
+  else
+  {
+    if (!mrb_bitmap_p(value)) mrb_raise(mrb, E_ARGUMENT_ERROR, "value is not a Bitmap");
+    mrb_get_bitmap(mrb, value);
+    emitter->bitmap = value;
+    mrb_value src_rect = mrb_funcall(mrb, value, "rect", 0);
+    mrb_funcall(mrb, mrb_iv_get(mrb, self, SRC_RECT), "set", 1, src_rect);
+  }
+  mrb_iv_set(mrb, self, BITMAP, value);
+  return value;
+}
+
+static mrb_value
+mrb_particle_emitter_get_src_rect(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, SRC_RECT);
+}
+
+static mrb_value
+mrb_particle_emitter_get_position(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, POSITION);
+}
+
+static mrb_value
+mrb_particle_emitter_get_area(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, AREA);
+}
+
+static mrb_value
+mrb_particle_emitter_get_gravity(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, GRAVITY);
+}
+
+static mrb_value
+mrb_particle_emitter_get_start_color(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, START_COLOR);
+}
+
+static mrb_value
+mrb_particle_emitter_get_end_color(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, END_COLOR);
+}
+
+static mrb_value
+mrb_particle_emitter_get_rate(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_float_value(mrb, emitter->rate);
+}
+
+static mrb_value
+mrb_particle_emitter_set_rate(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->rate = value < 0 ? 0 : (float)value;
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_life(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_value values[] = {
+    mrb_float_value(mrb, emitter->life_min),
+    mrb_float_value(mrb, emitter->life_max)
+  };
+  return mrb_ary_new_from_values(mrb, 2, values);
+}
+
+static mrb_value
+mrb_particle_emitter_set_life(mrb_state *mrb, mrb_value self)
+{
+  mrb_float min, max;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  if (mrb_get_args(mrb, "f|f", &min, &max) < 2) max = min;
+  if (min <= 0 || max <= 0) mrb_raise(mrb, E_ARGUMENT_ERROR, "Life must be positive");
+  emitter->life_min = (float)min;
+  emitter->life_max = (float)max;
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_particle_emitter_get_speed(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  mrb_value values[] = {
+    mrb_float_value(mrb, emitter->speed_min),
+    mrb_float_value(mrb, emitter->speed_max)
+  };
+  return mrb_ary_new_from_values(mrb, 2, values);
+}
+
+static mrb_value
+mrb_particle_emitter_set_speed(mrb_state *mrb, mrb_value self)
+{
+  mrb_float min, max;
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  if (mrb_get_args(mrb, "f|f", &min, &max) < 2) max = min;
+  emitter->speed_min = (float)min;
+  emitter->speed_max = (float)max;
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_particle_emitter_get_angle(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_float_value(mrb, emitter->angle);
+}
+
+static mrb_value
+mrb_particle_emitter_set_angle(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->angle = (float)value;
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_spread(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_float_value(mrb, emitter->spread);
+}
+
+static mrb_value
+mrb_particle_emitter_set_spread(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->spread = (float)value;
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_start_scale(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_float_value(mrb, emitter->start_scale);
+}
+
+static mrb_value
+mrb_particle_emitter_set_start_scale(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->start_scale = (float)value;
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_end_scale(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_float_value(mrb, emitter->end_scale);
+}
+
+static mrb_value
+mrb_particle_emitter_set_end_scale(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->end_scale = (float)value;
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_particle_emitter_get_spin(mrb_state *mrb, mrb_value self)
+{
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  return mrb_float_value(mrb, emitter->spin);
+}
+
+static mrb_value
+mrb_particle_emitter_set_spin(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  rf_particle_emitter *emitter = mrb_get_particle_emitter(mrb, self);
+  emitter->spin = (float)value;
+  return mrb_float_value(mrb, value);
+}
+
+void
+mrb_init_orgf_particle_emitter(mrb_state *mrb)
+{
+  struct RClass *emitter = mrb_define_class(mrb, "ParticleEmitter", mrb->object_class);
+  MRB_SET_INSTANCE_TT(emitter, MRB_TT_DATA);
+
+  mrb_define_method(mrb, emitter, "initialize", mrb_particle_emitter_initialize, MRB_ARGS_OPT(1));
+
+  mrb_define_method(mrb, emitter, "disposed?", mrb_particle_emitter_disposedQ, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "dispose", mrb_particle_emitter_dispose, MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, emitter, "emit", mrb_particle_emitter_emit, MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, emitter, "clear", mrb_particle_emitter_clear, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "count", mrb_particle_emitter_get_count, MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, emitter, "capacity", mrb_particle_emitter_get_capacity, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "capacity=", mrb_particle_emitter_set_capacity, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "z", mrb_particle_emitter_get_z, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "z=", mrb_particle_emitter_set_z, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "visible", mrb_particle_emitter_get_visible, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "visible=", mrb_particle_emitter_set_visible, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "emitting", mrb_particle_emitter_get_emitting, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "emitting=", mrb_particle_emitter_set_emitting, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "blend_mode", mrb_particle_emitter_get_blend_mode, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "blend_mode=", mrb_particle_emitter_set_blend_mode, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "viewport", mrb_particle_emitter_get_viewport, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "viewport=", mrb_particle_emitter_set_viewport, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "bitmap", mrb_particle_emitter_get_bitmap, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "bitmap=", mrb_particle_emitter_set_bitmap, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, emitter, "src_rect", mrb_particle_emitter_get_src_rect, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "position", mrb_particle_emitter_get_position, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "area", mrb_particle_emitter_get_area, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "gravity", mrb_particle_emitter_get_gravity, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "start_color", mrb_particle_emitter_get_start_color, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "end_color", mrb_particle_emitter_get_end_color, MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, emitter, "rate", mrb_particle_emitter_get_rate, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "rate=", mrb_particle_emitter_set_rate, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, emitter, "life", mrb_particle_emitter_get_life, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "set_life", mrb_particle_emitter_set_life, MRB_ARGS_REQ(1)|MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, emitter, "speed", mrb_particle_emitter_get_speed, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "set_speed", mrb_particle_emitter_set_speed, MRB_ARGS_REQ(1)|MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, emitter, "angle", mrb_particle_emitter_get_angle, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "angle=", mrb_particle_emitter_set_angle, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, emitter, "spread", mrb_particle_emitter_get_spread, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "spread=", mrb_particle_emitter_set_spread, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, emitter, "start_scale", mrb_particle_emitter_get_start_scale, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "start_scale=", mrb_particle_emitter_set_start_scale, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, emitter, "end_scale", mrb_particle_emitter_get_end_scale, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "end_scale=", mrb_particle_emitter_set_end_scale, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, emitter, "spin", mrb_particle_emitter_get_spin, MRB_ARGS_NONE());
+  mrb_define_method(mrb, emitter, "spin=", mrb_particle_emitter_set_spin, MRB_ARGS_REQ(1));
+}
@@ -5,6 +5,7 @@
 
 #include <rayfork.h>
 
+#include <orgf/blend.h>
 #include <orgf/graphics.h>
 #include <orgf/drawable.h>
 #include <orgf/viewport.h>
@@ -23,7 +24,7 @@
 
 static struct
 {
-  int tone;
+  int tone, premultiplied;
 } shader_locations;
 
 static rf_shader plane_shader;
@@ -76,6 +77,7 @@ static const char * frag =
 "uniform sampler2D texture0;"
 "uniform vec4 col_diffuse;"
 "uniform vec4 tone;"
+"uniform float premultiplied;"
 "void main()"
 "{"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
@@ -84,13 +86,15 @@ static const char * frag =
 "    vec4 texel_color = texture(texture0, frag_tex_coord);"
 #endif
 "    float ta = 1 - tone.a;"
-"    texel_color.r = texel_color.r + tone.r;"
-"    texel_color.g = texel_color.g + tone.g;"
-"    texel_color.b = texel_color.b + tone.b;"
+"    float pa = mix(1.0, texel_color.a, premultiplied);" // Premultiplied texels scale the colors added to them
+"    texel_color.r = texel_color.r + tone.r * pa;"
+"    texel_color.g = texel_color.g + tone.g * pa;"
+"    texel_color.b = texel_color.b + tone.b * pa;"
 "    float gray = (0.3 * texel_color.r) + (0.59 * texel_color.g) + (0.11 * texel_color.b);"
 "    texel_color.r = texel_color.r * ta + gray * tone.a;"
 "    texel_color.g = texel_color.g * ta + gray * tone.a;"
 "    texel_color.b = texel_color.b * ta + gray * tone.a;"
+"    if (premultiplied > 0.5) texel_color.rgb = clamp(texel_color.rgb, 0.0, texel_color.a);"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
 "    frag_color = texel_color*col_diffuse*frag_color;"
 #elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
@@ -105,6 +109,7 @@ init_shader(mrb_state *mrb)
   rf_get_default_shader();
   plane_shader = rf_gfx_load_shader(NULL, frag);
   shader_locations.tone = rf_gfx_get_shader_location(plane_shader, "tone");
+  shader_locations.premultiplied = rf_gfx_get_shader_location(plane_shader, "premultiplied");
   shader_ready = TRUE;
 }
 
@@ -117,7 +122,9 @@ bind_shader(rf_plane *plane)
     (float)plane->tone->b / 255.f,
     (float)plane->tone->a / 255.f
   };
+  float premultiplied = mrb_get_premultiplied_alpha() ? 1.0f : 0.0f;
   rf_gfx_set_shader_value(plane_shader, shader_locations.tone, tone, RF_UNIFORM_VEC4);
+  rf_gfx_set_shader_value(plane_shader, shader_locations.premultiplied, &premultiplied, RF_UNIFORM_FLOAT);
 }
 
 static void
@@ -125,10 +132,10 @@ rf_draw_plane(mrb_state *mrb, rf_plane *plane)
 {
   if (!plane->bitmap) return;
 
-  mrb_refresh_bitmap(plane->bitmap);
-  rf_texture2d texture = plane->bitmap->texture;
-  if (texture.id <= 0) return;
-  if (!texture.valid) return;
+  rf_bitmap *bitmap = plane->bitmap;
+  mrb_refresh_bitmap(mrb, bitmap);
+  rf_texture2d texture = bitmap->texture;
+  if (!bitmap->tiles && (texture.id <= 0 || !texture.valid)) return;
 
   mrb_bool flip_x = FALSE, flip_y = FALSE;
 
@@ -187,10 +194,11 @@ rf_draw_plane(mrb_state *mrb, rf_plane *plane)
   mrb_int tx = 2 + vw / dst.width;
   mrb_int ty = 2 + vh / dst.height;
 
-  rf_color color = *(plane->color);
+  rf_color color = mrb_blend_color(*(plane->color), plane->blend_mode);
 
-  rf_gfx_enable_texture(texture.id);
-  rf_begin_blend_mode(plane->blend_mode);
+  if (!bitmap->tiles) rf_gfx_enable_texture(texture.id);
+  ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+  mrb_begin_blend_mode(plane->blend_mode);
   rf_begin_shader(plane_shader);
   bind_shader(plane);
   for (mrb_int j = -2; j < ty; ++j)
@@ -199,6 +207,18 @@ rf_draw_plane(mrb_state *mrb, rf_plane *plane)
     {
       float x = (float)(i * dst.width - ox);
       float y = (float)(j * dst.height - oy);
+      if (bitmap->tiles)
+      {
+        // Only the tiles of each repetition that fall inside the view are uploaded
+        rf_rec area = { -vx - x, -vy - y, vw, vh };
+        rf_rec src = { 0, 0, texture.width, texture.height };
+        rf_gfx_push_matrix();
+        rf_gfx_translatef(x, y, 0);
+        mrb_tiled_texture_draw(mrb, bitmap->tiles, mrb_bitmap_get_image(mrb, bitmap), src,
+                               dst, flip_x, flip_y, &area, color);
+        rf_gfx_pop_matrix();
+        continue;
+      }
       rf_gfx_push_matrix();
       rf_gfx_translatef(x, y, 0);
       rf_gfx_begin(RF_QUADS);
@@ -219,9 +239,11 @@ rf_draw_plane(mrb_state *mrb, rf_plane *plane)
       rf_gfx_pop_matrix();
     }
   }
+  ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
   rf_end_shader();
-  rf_end_blend_mode();
-  rf_gfx_disable_texture();
+  ORGF_STATS_SETTLE();
+  mrb_end_blend_mode();
+  if (!bitmap->tiles) rf_gfx_disable_texture();
 }
 
 static mrb_value
@@ -238,6 +260,8 @@ mrb_plane_initialize(mrb_state *mrb, mrb_value self)
   plane->base.container = NULL;
   plane->base.z = 0;
   plane->base.draw = (rf_drawable_draw_callback)rf_draw_plane;
+  plane->base.draw_run = NULL;
+  plane->base.tick = NULL;
   plane->base.update = NULL;
   plane->base.visible = FALSE;
   plane->bitmap = NULL;
@@ -0,0 +1,286 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+
+#include <orgf/quads.h>
+#include <orgf/simd.h>
+#include <orgf/thread.h>
+
+// Inputs and outputs of a quad, in floats
+#define QUAD_FLOATS 26
+
+#if defined(ORGF_SIMD_SSE2)
+#define QUADS_SIMD 1
+typedef __m128 vec4f;
+#define vec4f_load _mm_loadu_ps
+#define vec4f_store _mm_storeu_ps
+#define vec4f_add _mm_add_ps
+#define vec4f_sub _mm_sub_ps
+#define vec4f_mul _mm_mul_ps
+#elif defined(ORGF_SIMD_NEON)
+#define QUADS_SIMD 1
+typedef float32x4_t vec4f;
+#define vec4f_load vld1q_f32
+#define vec4f_store vst1q_f32
+#define vec4f_add vaddq_f32
+#define vec4f_sub vsubq_f32
+#define vec4f_mul vmulq_f32
+#endif
+
+static struct
+{
+  orgf_thread       workers[ORGF_QUADS_MAX_THREADS];
+  orgf_signal       wake;
+  mrb_int           started;
+  mrb_int           threads;
+  orgf_atomic       quit;
+  orgf_atomic       remaining;
+  orgf_atomic       done;
+  rf_sprite_quads  *job;
+} pool;
+
+void
+mrb_sprite_quads_reserve(mrb_state *mrb, rf_sprite_quads *quads, mrb_int count)
+{
+  quads->count = 0;
+  if (count <= quads->capa) return;
+  mrb_int capa = quads->capa ? quads->capa : 64;
+  while (capa < count) capa *= 2;
+  mrb_sprite_quads_free(mrb, quads);
+  float *block = mrb_malloc(mrb, (size_t)capa * QUAD_FLOATS * sizeof *block);
+  float **inputs[] = {
+    &(quads->x), &(quads->y), &(quads->left), &(quads->top), &(quads->right), &(quads->bottom),
+    &(quads->cos), &(quads->sin), &(quads->src_u0), &(quads->src_v0), &(quads->src_u1), &(quads->src_v1),
+    &(quads->inv_width), &(quads->inv_height), &(quads->u0), &(quads->v0), &(quads->u1), &(quads->v1)
+  };
+  for (size_t i = 0; i < sizeof inputs / sizeof *inputs; ++i)
+  {
+    *(inputs[i]) = block;
+    block += capa;
+  }
+  quads->vx = block;
+  quads->vy = block + capa * 4;
+  quads->color = mrb_malloc(mrb, (size_t)capa * sizeof *(quads->color));
+  quads->texture = mrb_malloc(mrb, (size_t)capa * sizeof *(quads->texture));
+  quads->blend = mrb_malloc(mrb, (size_t)capa * sizeof *(quads->blend));
+  quads->capa = capa;
+}
+
+void
+mrb_sprite_quads_free(mrb_state *mrb, rf_sprite_quads *quads)
+{
+  if (!quads->capa) return;
+  // Every float array lives in the block x starts
+  mrb_free(mrb, quads->x);
+  mrb_free(mrb, quads->color);
+  mrb_free(mrb, quads->texture);
+  mrb_free(mrb, quads->blend);
+  quads->capa = 0;
+  quads->count = 0;
+}
+
+static void
+compute_range(rf_sprite_quads *q, mrb_int i, mrb_int end)
+{
+  mrb_int capa = q->capa;
+  float *vx = q->vx, *vy = q->vy;
+#ifdef QUADS_SIMD
+  for (; i + 4 <= end; i += 4)
+  {
+    vec4f x = vec4f_load(q->x + i), y = vec4f_load(q->y + i);
+    vec4f c = vec4f_load(q->cos + i), s = vec4f_load(q->sin + i);
+    vec4f l = vec4f_load(q->left + i), t = vec4f_load(q->top + i);
+    vec4f r = vec4f_load(q->right + i), b = vec4f_load(q->bottom + i);
+    vec4f lc = vec4f_mul(l, c), ls = vec4f_mul(l, s), rc = vec4f_mul(r, c), rs = vec4f_mul(r, s);
+    vec4f tc = vec4f_mul(t, c), ts = vec4f_mul(t, s), bc = vec4f_mul(b, c), bs = vec4f_mul(b, s);
+    // Corners go top left, bottom left, bottom right and top right
+    vec4f_store(vx + i, vec4f_add(x, vec4f_sub(lc, ts)));
+    vec4f_store(vy + i, vec4f_add(y, vec4f_add(ls, tc)));
+    vec4f_store(vx + capa + i, vec4f_add(x, vec4f_sub(lc, bs)));
+    vec4f_store(vy + capa + i, vec4f_add(y, vec4f_add(ls, bc)));
+    vec4f_store(vx + capa * 2 + i, vec4f_add(x, vec4f_sub(rc, bs)));
+    vec4f_store(vy + capa * 2 + i, vec4f_add(y, vec4f_add(rs, bc)));
+    vec4f_store(vx + capa * 3 + i, vec4f_add(x, vec4f_sub(rc, ts)));
+    vec4f_store(vy + capa * 3 + i, vec4f_add(y, vec4f_add(rs, tc)));
+    vec4f iw = vec4f_load(q->inv_width + i), ih = vec4f_load(q->inv_height + i);
+    vec4f_store(q->u0 + i, vec4f_mul(vec4f_load(q->src_u0 + i), iw));
+    vec4f_store(q->v0 + i, vec4f_mul(vec4f_load(q->src_v0 + i), ih));
+    vec4f_store(q->u1 + i, vec4f_mul(vec4f_load(q->src_u1 + i), iw));
+    vec4f_store(q->v1 + i, vec4f_mul(vec4f_load(q->src_v1 + i), ih));
+  }
+#endif
+  for (; i < end; ++i)
+  {
+    float x = q->x[i], y = q->y[i], c = q->cos[i], s = q->sin[i];
+    float l = q->left[i], t = q->top[i], r = q->right[i], b = q->bottom[i];
+    vx[i] = x + l * c - t * s;
+    vy[i] = y + l * s + t * c;
+    vx[capa + i] = x + l * c - b * s;
+    vy[capa + i] = y + l * s + b * c;
+    vx[capa * 2 + i] = x + r * c - b * s;
+    vy[capa * 2 + i] = y + r * s + b * c;
+    vx[capa * 3 + i] = x + r * c - t * s;
+    vy[capa * 3 + i] = y + r * s + t * c;
+    q->u0[i] = q->src_u0[i] * q->inv_width[i];
+    q->v0[i] = q->src_v0[i] * q->inv_height[i];
+    q->u1[i] = q->src_u1[i] * q->inv_width[i];
+    q->v1[i] = q->src_v1[i] * q->inv_height[i];
+  }
+}
+
+/* Chunks are handed out counting down, so a thread late for a job that
+   already ended only sees a negative index and never reads the next one. */
+static mrb_bool
+run_chunk(void)
+{
+  long index = orgf_atomic_fetch_add(&(pool.remaining), -1) - 1;
+  if (index < 0) return FALSE;
+  rf_sprite_quads *quads = pool.job;
+  mrb_int start = (mrb_int)index * ORGF_QUADS_CHUNK;
+  mrb_int end = start + ORGF_QUADS_CHUNK < quads->count ? start + ORGF_QUADS_CHUNK : quads->count;
+  compute_range(quads, start, end);
+  orgf_atomic_fetch_add(&(pool.done), 1);
+  return TRUE;
+}
+
+static void
+quad_worker(void *data)
+{
+  long seen = 0;
+  uint64_t idle_since = orgf_time_ns();
+  while (!orgf_atomic_load(&(pool.quit)))
+  {
+    if (orgf_atomic_load(&(pool.remaining)) > 0 && run_chunk())
+    {
+      idle_since = orgf_time_ns();
+      continue;
+    }
+    // Busy frames keep the workers spinning, idle ones park them until the next job
+    if (orgf_time_ns() - idle_since < ORGF_QUADS_SPIN_NS)
+    {
+      orgf_thread_yield();
+      continue;
+    }
+    seen = orgf_signal_wait(pool.wake, seen);
+    idle_since = orgf_time_ns();
+  }
+}
+
+mrb_int
+mrb_get_quad_threads(void)
+{
+  if (pool.threads < 1)
+  {
+    int cpus = orgf_cpu_count();
+    pool.threads = cpus < 4 ? cpus : 4;
+  }
+  return pool.threads;
+}
+
+void
+mrb_set_quad_threads(mrb_int threads)
+{
+  if (threads < 1) threads = 1;
+  if (threads > ORGF_QUADS_MAX_THREADS) threads = ORGF_QUADS_MAX_THREADS;
+  if (threads == pool.threads) return;
+  mrb_quad_workers_stop();
+  pool.threads = threads;
+}
+
+void
+mrb_quad_workers_stop(void)
+{
+  if (!pool.started) return;
+  orgf_atomic_store(&(pool.quit), 1);
+  orgf_signal_raise(pool.wake);
+  for (mrb_int i = 0; i < pool.started; ++i) orgf_thread_join(pool.workers[i]);
+  pool.started = 0;
+  orgf_atomic_store(&(pool.quit), 0);
+}
+
+void
+mrb_sprite_quads_compute(rf_sprite_quads *quads)
+{
+  mrb_int threads = mrb_get_quad_threads();
+  if (threads < 2 || quads->count < ORGF_QUADS_PARALLEL_MIN)
+  {
+    compute_range(quads, 0, quads->count);
+    return;
+  }
+  if (!pool.wake && !orgf_signal_init(&(pool.wake)))
+  {
+    compute_range(quads, 0, quads->count);
+    return;
+  }
+  while (pool.started < threads - 1)
+  {
+    if (!orgf_thread_start(&(pool.workers[pool.started]), quad_worker, NULL)) break;
+    pool.started += 1;
+  }
+  long chunks = (long)((quads->count + ORGF_QUADS_CHUNK - 1) / ORGF_QUADS_CHUNK);
+  pool.job = quads;
+  orgf_atomic_store(&(pool.done), 0);
+  orgf_atomic_store(&(pool.remaining), chunks);
+  orgf_signal_raise(pool.wake);
+  while (run_chunk());
+  // Whatever is left was taken by a worker and is being computed right now,
+  // a worker sharing this core only finishes it once the wait yields
+  for (int spins = 0; orgf_atomic_load(&(pool.done)) < chunks; ++spins)
+  {
+#ifdef ORGF_CPU_PAUSE
+    if (spins < ORGF_QUADS_PAUSE_SPINS)
+    {
+      ORGF_CPU_PAUSE();
+      continue;
+    }
+#endif
+    orgf_thread_yield();
+  }
+}
+
+double
+mrb_sprite_quads_benchmark(mrb_state *mrb, mrb_int count, mrb_int threads)
+{
+  rf_sprite_quads quads = { 0 };
+  mrb_sprite_quads_reserve(mrb, &quads, count);
+  quads.count = count;
+  uint32_t seed = 12345;
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    float values[12];
+    for (int j = 0; j < 12; ++j)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      values[j] = (float)(seed >> 8) / 16777216.0f;
+    }
+    quads.x[i] = values[0] * 640;
+    quads.y[i] = values[1] * 480;
+    quads.left[i] = -values[2] * 32;
+    quads.top[i] = -values[3] * 32;
+    quads.right[i] = values[4] * 32;
+    quads.bottom[i] = values[5] * 32;
+    quads.cos[i] = values[6];
+    quads.sin[i] = values[7];
+    quads.src_u0[i] = values[8] * 256;
+    quads.src_v0[i] = values[9] * 256;
+    quads.src_u1[i] = values[10] * 256;
+    quads.src_v1[i] = values[11] * 256;
+    quads.inv_width[i] = 1.0f / 256;
+    quads.inv_height[i] = 1.0f / 256;
+  }
+  mrb_int previous = mrb_get_quad_threads();
+  mrb_set_quad_threads(threads);
+  // The first run starts the workers, it isn't timed
+  mrb_sprite_quads_compute(&quads);
+  mrb_int runs = 0;
+  uint64_t start = orgf_time_ns(), elapsed = 0;
+  while (runs < 5 || elapsed < 100000000)
+  {
+    mrb_sprite_quads_compute(&quads);
+    runs += 1;
+    elapsed = orgf_time_ns() - start;
+  }
+  mrb_set_quad_threads(previous);
+  mrb_sprite_quads_free(mrb, &quads);
+  return (double)count * (double)runs / ((double)elapsed / 1000000.0);
+}
@@ -0,0 +1,152 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <string.h>
+
+#include <orgf/disposal.h>
+#include <orgf/graphics.h>
+#include <orgf/readback.h>
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#ifndef GL_RGBA
+#define GL_RGBA 0x1908
+#endif
+#ifndef GL_UNSIGNED_BYTE
+#define GL_UNSIGNED_BYTE 0x1401
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_TEXTURE_2D
+#define GL_TEXTURE_2D 0x0DE1
+#endif
+#ifndef GL_FRAMEBUFFER_BINDING
+#define GL_FRAMEBUFFER_BINDING 0x8CA6
+#endif
+
+static inline size_t
+readback_size(rf_readback *readback)
+{
+  return (size_t)readback->target.texture.width * (size_t)readback->target.texture.height * 4;
+}
+
+void
+mrb_readback_init(rf_readback *readback)
+{
+  memset(readback, 0, sizeof *readback);
+}
+
+void
+mrb_readback_start(rf_readback *readback, rf_render_texture2d target)
+{
+  readback->target = target;
+  readback->pending = TRUE;
+#ifdef ORGF_ASYNC_READBACK
+  size_t size = readback_size(readback);
+  if (!readback->buffer) glGenBuffers(1, &(readback->buffer));
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+  if (readback->buffer_size != size)
+  {
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_READ);
+    readback->buffer_size = size;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, target.id);
+  glReadPixels(0, 0, target.texture.width, target.texture.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (readback->fence) glDeleteSync((GLsync)readback->fence);
+  readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+mrb_bool
+mrb_readback_ready(rf_readback *readback)
+{
+  if (!readback->pending) return FALSE;
+#ifdef ORGF_ASYNC_READBACK
+  GLenum status = glClientWaitSync((GLsync)readback->fence, 0, 0);
+  return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+#else
+  return TRUE;
+#endif
+}
+
+void
+mrb_readback_finish(rf_readback *readback, void *pixels)
+{
+  if (!readback->pending) return;
+  readback->pending = FALSE;
+#ifdef ORGF_ASYNC_READBACK
+  size_t size = readback_size(readback);
+  glClientWaitSync((GLsync)readback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  glDeleteSync((GLsync)readback->fence);
+  readback->fence = NULL;
+  if (!pixels) return;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+  void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+  if (data)
+  {
+    memcpy(pixels, data, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#else
+  if (!pixels) return;
+  rf_gl.BindFramebuffer(GL_FRAMEBUFFER, readback->target.id);
+  rf_gl.ReadPixels(
+    0, 0, readback->target.texture.width, readback->target.texture.height,
+    GL_RGBA, GL_UNSIGNED_BYTE, pixels
+  );
+  rf_gl.BindFramebuffer(GL_FRAMEBUFFER, 0);
+#endif
+}
+
+void
+mrb_readback_texture(rf_texture2d texture, void *pixels)
+{
+  unsigned int framebuffer = 0;
+  int previous = 0;
+  // It may be called while drawing into a render texture
+  rf_gl.GetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  rf_gl.GenFramebuffers(1, &framebuffer);
+  rf_gl.BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  rf_gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.id, 0);
+  rf_gl.ReadPixels(0, 0, texture.width, texture.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  rf_gl.BindFramebuffer(GL_FRAMEBUFFER, (unsigned int)previous);
+  rf_gl.DeleteFramebuffers(1, &framebuffer);
+}
+
+void
+mrb_readback_release_target(rf_readback *readback)
+{
+  // Only the framebuffer goes away, the color texture stays with whoever owns it.
+  rf_render_texture2d target = readback->target;
+  if (!target.id) return;
+  target.texture.id = 0;
+  rf_unload_render_texture(target);
+  readback->target.id = 0;
+}
+
+void
+mrb_readback_dispose_target(mrb_state *mrb, rf_readback *readback)
+{
+  rf_render_texture2d target = readback->target;
+  if (!target.id) return;
+  target.texture.id = 0;
+  mrb_dispose_render_texture(mrb, target, 0);
+  readback->target.id = 0;
+}
+
+void
+mrb_readback_free(rf_readback *readback)
+{
+#ifdef ORGF_ASYNC_READBACK
+  if (readback->fence) glDeleteSync((GLsync)readback->fence);
+  if (readback->buffer) glDeleteBuffers(1, &(readback->buffer));
+#endif
+  mrb_readback_init(readback);
+}
@@ -0,0 +1,152 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+
+#include <orgf/bitmap.h>
+#include <orgf/disposal.h>
+#include <orgf/residency.h>
+#include <orgf/texformat.h>
+
+static rf_residency residency = { 0 };
+
+static inline size_t
+texture_bytes(rf_texture2d texture)
+{
+  if (!texture.id) return 0;
+  return (size_t)texture.width * (size_t)texture.height * (size_t)mrb_pixel_bytes(texture.format);
+}
+
+static void
+unlink_bitmap(rf_bitmap *bmp)
+{
+  if (bmp->lru_prev) bmp->lru_prev->lru_next = bmp->lru_next;
+  else residency.head = bmp->lru_next;
+  if (bmp->lru_next) bmp->lru_next->lru_prev = bmp->lru_prev;
+  else residency.tail = bmp->lru_prev;
+  bmp->lru_prev = NULL;
+  bmp->lru_next = NULL;
+}
+
+static void
+push_front(rf_bitmap *bmp)
+{
+  bmp->lru_prev = NULL;
+  bmp->lru_next = residency.head;
+  if (residency.head) residency.head->lru_prev = bmp;
+  residency.head = bmp;
+  if (!residency.tail) residency.tail = bmp;
+}
+
+rf_residency *
+mrb_get_residency(void)
+{
+  return &residency;
+}
+
+void
+mrb_residency_track(rf_bitmap *bmp)
+{
+  bmp->last_used = residency.frame;
+  bmp->pinned = FALSE;
+  push_front(bmp);
+  residency.tracked += 1;
+}
+
+static void
+forget_texture(rf_bitmap *bmp)
+{
+  if (!bmp->texture.id) return;
+  residency.resident_bytes -= texture_bytes(bmp->texture);
+  residency.resident -= 1;
+  if (mrb_pixel_bytes(bmp->texture.format) == 2) residency.reduced -= 1;
+}
+
+void
+mrb_residency_untrack(mrb_state *mrb, rf_bitmap *bmp)
+{
+  // Called from the finalizer, so the texture is left for the end of the frame
+  forget_texture(bmp);
+  mrb_dispose_texture(mrb, bmp->texture, texture_bytes(bmp->texture));
+  bmp->texture = (rf_texture2d){ 0 };
+  mrb_residency_set_image(bmp, 0, 0);
+  if (bmp->pinned) residency.pinned -= 1;
+  unlink_bitmap(bmp);
+  residency.tracked -= 1;
+}
+
+void
+mrb_residency_touch(rf_bitmap *bmp)
+{
+  bmp->last_used = residency.frame;
+  if (residency.head == bmp) return;
+  unlink_bitmap(bmp);
+  push_front(bmp);
+}
+
+void
+mrb_residency_set_pinned(rf_bitmap *bmp, mrb_bool pinned)
+{
+  if (bmp->pinned == pinned) return;
+  bmp->pinned = pinned;
+  residency.pinned += pinned ? 1 : -1;
+}
+
+void
+mrb_residency_set_texture(rf_bitmap *bmp, rf_texture2d texture)
+{
+  if (bmp->texture.id)
+  {
+    forget_texture(bmp);
+    rf_unload_texture(bmp->texture);
+  }
+  if (texture.id)
+  {
+    residency.resident_bytes += texture_bytes(texture);
+    residency.resident += 1;
+    if (mrb_pixel_bytes(texture.format) == 2) residency.reduced += 1;
+  }
+  bmp->texture = texture;
+}
+
+void
+mrb_residency_set_image(rf_bitmap *bmp, size_t held, size_t released)
+{
+  residency.image_bytes -= bmp->image_bytes;
+  residency.released_bytes -= bmp->released_bytes;
+  residency.image_bytes += held;
+  residency.released_bytes += released;
+  bmp->image_bytes = held;
+  bmp->released_bytes = released;
+}
+
+mrb_bool
+mrb_residency_evictable(rf_bitmap *bmp)
+{
+  if (!bmp->texture.id || bmp->pinned || bmp->readback) return FALSE;
+  // Without pixels on the CPU or a file to load them from there is no way back
+  return bmp->image.data || bmp->source;
+}
+
+void
+mrb_residency_end_frame(mrb_state *mrb)
+{
+  if (residency.budget)
+  {
+    rf_bitmap *bmp = residency.tail;
+    while (bmp && residency.resident_bytes > residency.budget && bmp->last_used < residency.frame)
+    {
+      rf_bitmap *prev = bmp->lru_prev;
+      if (mrb_residency_evictable(bmp))
+      {
+        // The size stays around, drawables still ask for it while evicted
+        rf_texture2d evicted = bmp->texture;
+        evicted.id = 0;
+        evicted.valid = false;
+        mrb_residency_set_texture(bmp, evicted);
+        residency.evictions += 1;
+      }
+      bmp = prev;
+    }
+  }
+  residency.frame += 1;
+}
@@ -0,0 +1,95 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+
+#include <orgf/resolution.h>
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+void
+mrb_resolution_init(rf_resolution *resolution)
+{
+  *resolution = (rf_resolution){ 0 };
+  resolution->scale = 1;
+  resolution->min_scale = ORGF_RESOLUTION_MIN_SCALE;
+  resolution->filter = RF_FILTER_BILINEAR;
+  resolution->patience = ORGF_RESOLUTION_PATIENCE;
+}
+
+static void
+restart(rf_resolution *resolution)
+{
+  resolution->frames = 0;
+  resolution->late = 0;
+  resolution->calm = 0;
+  resolution->probing = FALSE;
+}
+
+mrb_bool
+mrb_resolution_frame(rf_resolution *resolution, uint64_t elapsed, uint64_t period)
+{
+  if (!resolution->enabled) return FALSE;
+  // A little jitter around the period is only the timer
+  if (elapsed > period + period / 8) resolution->late += 1;
+  resolution->frames += 1;
+  if (resolution->frames < ORGF_RESOLUTION_WINDOW) return FALSE;
+  mrb_int late = resolution->late;
+  mrb_bool probing = resolution->probing;
+  resolution->frames = 0;
+  resolution->late = 0;
+  resolution->probing = FALSE;
+  if (late * 4 > ORGF_RESOLUTION_WINDOW)
+  {
+    resolution->calm = 0;
+    if (resolution->scale <= resolution->min_scale) return FALSE;
+    if (probing && resolution->patience < ORGF_RESOLUTION_MAX_PATIENCE) resolution->patience *= 2;
+    resolution->scale -= ORGF_RESOLUTION_STEP;
+    if (resolution->scale < resolution->min_scale) resolution->scale = resolution->min_scale;
+    resolution->downscales += 1;
+    return TRUE;
+  }
+  if (late)
+  {
+    resolution->calm = 0;
+    return FALSE;
+  }
+  // The last step up held, later ones can be tried sooner
+  if (probing && resolution->patience > ORGF_RESOLUTION_PATIENCE) resolution->patience /= 2;
+  if (resolution->scale >= 1) return FALSE;
+  resolution->calm += 1;
+  if (resolution->calm < resolution->patience) return FALSE;
+  resolution->calm = 0;
+  resolution->scale += ORGF_RESOLUTION_STEP;
+  if (resolution->scale > 1) resolution->scale = 1;
+  resolution->probing = TRUE;
+  resolution->upscales += 1;
+  return TRUE;
+}
+
+void
+mrb_resolution_set_scale(rf_resolution *resolution, float scale)
+{
+  if (scale < resolution->min_scale) scale = resolution->min_scale;
+  if (scale > 1) scale = 1;
+  resolution->scale = scale;
+  restart(resolution);
+}
+
+void
+mrb_resolution_region(rf_resolution *resolution, int width, int height, int *region_width, int *region_height)
+{
+  int w = (int)(width * resolution->scale + 0.5f);
+  int h = (int)(height * resolution->scale + 0.5f);
+  *region_width = w < 1 ? 1 : w;
+  *region_height = h < 1 ? 1 : h;
+}
+
+void
+mrb_resolution_begin(rf_resolution *resolution, int width, int height)
+{
+  if (resolution->scale >= 1) return;
+  int w, h;
+  mrb_resolution_region(resolution, width, height, &w, &h);
+  // Rows are flipped in render textures, the top of the screen is the top of the target
+  rf_gl.Viewport(0, height - h, w, h);
+}
@@ -0,0 +1,393 @@
+#include <mruby.h>
+#include <mruby/class.h>
+#include <mruby/data.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+
+#include <rayfork.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <orgf/bitmap.h>
+#include <orgf/font.h>
+#include <orgf/glyphs.h>
+#include <orgf/rect.h>
+#include <orgf/reveal.h>
+
+#define BITMAP mrb_intern_lit(mrb, "#bitmap")
+#define FONT mrb_intern_lit(mrb, "#font")
+
+static void
+free_text_reveal(mrb_state *mrb, void *ptr)
+{
+  if (ptr)
+  {
+    rf_text_reveal *reveal = ptr;
+    mrb_free(mrb, reveal->text);
+    mrb_free(mrb, reveal->glyphs);
+    mrb_free(mrb, reveal->events);
+    mrb_free(mrb, reveal);
+  }
+}
+
+const struct mrb_data_type mrb_text_reveal_data_type = { "TextReveal", free_text_reveal };
+
+/* The number inside the [] following a control code, moving past it. */
+static mrb_bool
+parse_argument(const char *src, mrb_int length, mrb_int *index, float *value)
+{
+  char buffer[32];
+  mrb_int i = *index, size = 0;
+  if (i >= length || src[i] != '[') return FALSE;
+  for (++i; i < length && src[i] != ']'; ++i)
+  {
+    if (size + 1 >= (mrb_int)sizeof buffer) return FALSE;
+    buffer[size++] = src[i];
+  }
+  if (i >= length) return FALSE;
+  buffer[size] = '\0';
+  *value = (float)strtod(buffer, NULL);
+  *index = i + 1;
+  return TRUE;
+}
+
+static void
+add_event(rf_text_reveal *reveal, enum rf_reveal_event_type type, float value)
+{
+  rf_reveal_event *event = reveal->events + reveal->event_count++;
+  event->type = type;
+  event->index = reveal->count;
+  event->value = value;
+}
+
+/* Splits the text into the glyphs to draw and the control codes between
+   them: \S[n] reveals n glyphs per update from there on, 0 all at once,
+   \W[n] waits n updates, \P pauses until resumed and \\ is a backslash. */
+static void
+parse_text(mrb_state *mrb, rf_text_reveal *reveal, const char *src, mrb_int length)
+{
+  size_t capa = (size_t)(length ? length : 1);
+  reveal->text = mrb_malloc(mrb, capa + 1);
+  reveal->glyphs = mrb_malloc(mrb, capa * sizeof *reveal->glyphs);
+  reveal->events = mrb_malloc(mrb, capa * sizeof *reveal->events);
+  mrb_int line = 0;
+  mrb_int i = 0;
+  while (i < length)
+  {
+    if (src[i] == '\\' && i + 1 < length)
+    {
+      char code = src[i + 1];
+      mrb_int next = i + 2;
+      float value;
+      if ((code == 'S' || code == 'W') && parse_argument(src, length, &next, &value))
+      {
+        add_event(reveal, code == 'S' ? RF_REVEAL_SPEED : RF_REVEAL_WAIT, value);
+        i = next;
+        continue;
+      }
+      if (code == 'P')
+      {
+        add_event(reveal, RF_REVEAL_PAUSE, 0);
+        i = next;
+        continue;
+      }
+      // An escaped backslash is a glyph, unknown codes are kept as they are
+      if (code == '\\') i += 1;
+    }
+    if (src[i] == '\r')
+    {
+      i += 1;
+      continue;
+    }
+    if (src[i] == '\n')
+    {
+      reveal->text[reveal->text_length++] = '\n';
+      line += 1;
+      i += 1;
+      continue;
+    }
+    mrb_int start = i;
+    mrb_next_codepoint(src, length, &i);
+    rf_reveal_glyph *glyph = reveal->glyphs + reveal->count++;
+    glyph->offset = reveal->text_length;
+    glyph->length = i - start;
+    glyph->line = line;
+    memcpy(reveal->text + reveal->text_length, src + start, (size_t)(i - start));
+    reveal->text_length += i - start;
+  }
+  reveal->text[reveal->text_length] = '\0';
+}
+
+/* Every line is aligned inside its own copy of rect, one rect height below
+   the previous one, like Bitmap#draw_text would place it. */
+static void
+layout_glyphs(mrb_state *mrb, rf_text_reveal *reveal, rf_text_font *font, int align)
+{
+  mrb_bool cpu = mrb_font_cpu_p(font);
+  rf_rec rect = reveal->rect;
+  mrb_int start = 0;
+  float pen = 0;
+  for (mrb_int i = 0; i <= reveal->count; ++i)
+  {
+    rf_reveal_glyph *glyph = reveal->glyphs + i;
+    if (i == reveal->count || glyph->line != reveal->glyphs[start].line)
+    {
+      float shift = align == 1 ? (rect.width - pen) / 2 : align == 2 ? rect.width - pen : 0;
+      for (mrb_int j = start; j < i; ++j) reveal->glyphs[j].x += rect.x + shift;
+      if (i == reveal->count) break;
+      start = i;
+      pen = 0;
+    }
+    glyph->x = pen;
+    glyph->y = rect.y + glyph->line * rect.height + (rect.height - (float)font->size) / 2;
+    if (cpu) pen += mrb_font_text_width(mrb, font, reveal->text + glyph->offset, glyph->length);
+  }
+}
+
+/* Draws the glyphs from .. to, a run per line, then marks only the pixels
+   they touched for upload. */
+static void
+draw_glyphs(mrb_state *mrb, mrb_value self, rf_text_reveal *reveal, mrb_int from, mrb_int to)
+{
+  if (from >= to) return;
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, mrb_iv_get(mrb, self, BITMAP));
+  rf_text_font *font = mrb_get_font(mrb, mrb_iv_get(mrb, self, FONT));
+  if (!mrb_font_cpu_p(font)) return;
+  rf_image *image = mrb_bitmap_get_mutable_image(mrb, bmp);
+  if (!image->data || image->format != RF_UNCOMPRESSED_R8G8B8A8) return;
+  rf_rec rect = reveal->rect;
+  rf_rec touched = { 0 };
+  while (from < to)
+  {
+    mrb_int end = from + 1;
+    while (end < to && reveal->glyphs[end].line == reveal->glyphs[from].line) ++end;
+    rf_reveal_glyph *first = reveal->glyphs + from;
+    rf_reveal_glyph *last = reveal->glyphs + end - 1;
+    rf_rec clip = { rect.x, rect.y + first->line * rect.height, rect.width, rect.height };
+    mrb_font_draw_run(mrb, font, image, first->x, first->y, clip, reveal->text + first->offset,
+                      last->offset + last->length - first->offset, &touched);
+    from = end;
+  }
+  mrb_bitmap_mark_dirty(bmp, touched);
+}
+
+/* Returns TRUE when the event stops revealing for now. */
+static mrb_bool
+run_event(rf_text_reveal *reveal, rf_reveal_event *event)
+{
+  switch (event->type)
+  {
+    case RF_REVEAL_SPEED:
+      reveal->speed = event->value > 0 ? event->value : 0;
+      return FALSE;
+    case RF_REVEAL_WAIT:
+      reveal->wait = event->value > 0 ? (mrb_int)event->value : 0;
+      return reveal->wait > 0;
+    default:
+      reveal->paused = TRUE;
+      return TRUE;
+  }
+}
+
+static void
+advance(rf_text_reveal *reveal)
+{
+  if (reveal->paused) return;
+  if (reveal->wait > 0)
+  {
+    reveal->wait -= 1;
+    return;
+  }
+  if (reveal->speed > 0) reveal->budget += reveal->speed;
+  for (;;)
+  {
+    if (reveal->next_event < reveal->event_count && reveal->events[reveal->next_event].index == reveal->revealed)
+    {
+      // What was left of this update doesn't carry over a wait or a pause
+      if (run_event(reveal, reveal->events + reveal->next_event++))
+      {
+        reveal->budget = 0;
+        return;
+      }
+      continue;
+    }
+    if (reveal->revealed >= reveal->count) return;
+    if (reveal->speed > 0)
+    {
+      if (reveal->budget < 1) return;
+      reveal->budget -= 1;
+    }
+    reveal->revealed += 1;
+  }
+}
+
+static mrb_value
+mrb_text_reveal_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_int argc;
+  mrb_value *argv;
+  rf_rec rect;
+  mrb_int align = 0;
+  mrb_get_args(mrb, "*", &argv, &argc);
+  if (argc == 3 || argc == 4)
+  {
+    rect = *mrb_get_rect(mrb, argv[1]);
+    if (argc == 4) align = mrb_int(mrb, argv[3]);
+  }
+  else if (argc == 6 || argc == 7)
+  {
+    rect = (rf_rec){ mrb_to_flo(mrb, argv[1]), mrb_to_flo(mrb, argv[2]), mrb_to_flo(mrb, argv[3]), mrb_to_flo(mrb, argv[4]) };
+    if (argc == 7) align = mrb_int(mrb, argv[6]);
+  }
+  else
+  {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "Wrong number of arguments expected 3, 4, 6 or 7");
+  }
+  if (!mrb_bitmap_p(argv[0])) mrb_raise(mrb, E_ARGUMENT_ERROR, "value is not a Bitmap.");
+  mrb_get_bitmap(mrb, argv[0]);
+  mrb_value text = mrb_obj_as_string(mrb, argv[argc == 3 || argc == 6 ? argc - 1 : argc - 2]);
+  // The font is kept, so changing the bitmap's font doesn't move laid out glyphs
+  mrb_value font = mrb_funcall(mrb, argv[0], "font", 0);
+  DATA_TYPE(self) = &mrb_text_reveal_data_type;
+  rf_text_reveal *reveal = mrb_malloc(mrb, sizeof *reveal);
+  memset(reveal, 0, sizeof *reveal);
+  DATA_PTR(self) = reveal;
+  reveal->rect = rect;
+  reveal->speed = 1;
+  mrb_iv_set(mrb, self, BITMAP, argv[0]);
+  mrb_iv_set(mrb, self, FONT, font);
+  parse_text(mrb, reveal, RSTRING_PTR(text), RSTRING_LEN(text));
+  layout_glyphs(mrb, reveal, mrb_get_font(mrb, font), (int)align);
+  return self;
+}
+
+static mrb_value
+mrb_text_reveal_update(mrb_state *mrb, mrb_value self)
+{
+  rf_text_reveal *reveal = mrb_get_text_reveal(mrb, self);
+  mrb_int from = reveal->revealed;
+  advance(reveal);
+  draw_glyphs(mrb, self, reveal, from, reveal->revealed);
+  return mrb_fixnum_value(reveal->revealed - from);
+}
+
+static mrb_value
+mrb_text_reveal_finish(mrb_state *mrb, mrb_value self)
+{
+  rf_text_reveal *reveal = mrb_get_text_reveal(mrb, self);
+  mrb_int from = reveal->revealed;
+  reveal->revealed = reveal->count;
+  reveal->next_event = reveal->event_count;
+  reveal->paused = FALSE;
+  reveal->wait = 0;
+  reveal->budget = 0;
+  draw_glyphs(mrb, self, reveal, from, reveal->revealed);
+  return self;
+}
+
+static mrb_value
+mrb_text_reveal_redraw(mrb_state *mrb, mrb_value self)
+{
+  rf_text_reveal *reveal = mrb_get_text_reveal(mrb, self);
+  draw_glyphs(mrb, self, reveal, 0, reveal->revealed);
+  return self;
+}
+
+static mrb_value
+mrb_text_reveal_resume(mrb_state *mrb, mrb_value self)
+{
+  mrb_get_text_reveal(mrb, self)->paused = FALSE;
+  return self;
+}
+
+static mrb_value
+mrb_text_reveal_pausedQ(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_text_reveal(mrb, self)->paused);
+}
+
+static mrb_value
+mrb_text_reveal_waitingQ(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_get_text_reveal(mrb, self)->wait > 0);
+}
+
+static mrb_value
+mrb_text_reveal_doneQ(mrb_state *mrb, mrb_value self)
+{
+  rf_text_reveal *reveal = mrb_get_text_reveal(mrb, self);
+  return mrb_bool_value(reveal->revealed >= reveal->count && reveal->next_event >= reveal->event_count &&
+                        !reveal->paused && reveal->wait <= 0);
+}
+
+static mrb_value
+mrb_text_reveal_get_speed(mrb_state *mrb, mrb_value self)
+{
+  return mrb_float_value(mrb, mrb_get_text_reveal(mrb, self)->speed);
+}
+
+static mrb_value
+mrb_text_reveal_set_speed(mrb_state *mrb, mrb_value self)
+{
+  mrb_float value;
+  mrb_get_args(mrb, "f", &value);
+  mrb_get_text_reveal(mrb, self)->speed = value > 0 ? (float)value : 0;
+  return mrb_float_value(mrb, value);
+}
+
+static mrb_value
+mrb_text_reveal_get_revealed(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_get_text_reveal(mrb, self)->revealed);
+}
+
+static mrb_value
+mrb_text_reveal_get_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_get_text_reveal(mrb, self)->count);
+}
+
+static mrb_value
+mrb_text_reveal_get_text(mrb_state *mrb, mrb_value self)
+{
+  rf_text_reveal *reveal = mrb_get_text_reveal(mrb, self);
+  return mrb_str_new(mrb, reveal->text, reveal->text_length);
+}
+
+static mrb_value
+mrb_text_reveal_get_bitmap(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, BITMAP);
+}
+
+static mrb_value
+mrb_text_reveal_get_font(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, FONT);
+}
+
+void
+mrb_init_orgf_text_reveal(mrb_state *mrb)
+{
+  struct RClass *reveal = mrb_define_class(mrb, "TextReveal", mrb->object_class);
+  MRB_SET_INSTANCE_TT(reveal, MRB_TT_DATA);
+
+  mrb_define_method(mrb, reveal, "initialize", mrb_text_reveal_initialize, MRB_ARGS_REQ(3)|MRB_ARGS_OPT(4));
+
+  mrb_define_method(mrb, reveal, "update", mrb_text_reveal_update, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "finish", mrb_text_reveal_finish, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "redraw", mrb_text_reveal_redraw, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "resume", mrb_text_reveal_resume, MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, reveal, "paused?", mrb_text_reveal_pausedQ, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "waiting?", mrb_text_reveal_waitingQ, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "done?", mrb_text_reveal_doneQ, MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, reveal, "speed", mrb_text_reveal_get_speed, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "speed=", mrb_text_reveal_set_speed, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, reveal, "revealed", mrb_text_reveal_get_revealed, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "size", mrb_text_reveal_get_size, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "text", mrb_text_reveal_get_text, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "bitmap", mrb_text_reveal_get_bitmap, MRB_ARGS_NONE());
+  mrb_define_method(mrb, reveal, "font", mrb_text_reveal_get_font, MRB_ARGS_NONE());
+}
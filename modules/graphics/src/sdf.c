@@ -0,0 +1,97 @@
+#include <mruby.h>
+
+#include <math.h>
+#include <stdint.h>
+
+#include <orgf/sdf.h>
+
+#define FAR 0x3FFF
+
+typedef struct sdf_point sdf_point;
+
+/* Offset to the nearest seed pixel, the 8SSEDT sweep propagates them. */
+struct sdf_point
+{
+  int16_t dx;
+  int16_t dy;
+};
+
+static inline int32_t
+length2(sdf_point p)
+{
+  return (int32_t)p.dx * p.dx + (int32_t)p.dy * p.dy;
+}
+
+static inline void
+compare(sdf_point *grid, int width, int height, int x, int y, int ox, int oy)
+{
+  int nx = x + ox, ny = y + oy;
+  if (nx < 0 || ny < 0 || nx >= width || ny >= height) return;
+  sdf_point other = grid[ny * width + nx];
+  if (other.dx == FAR) return;
+  other.dx = (int16_t)(other.dx + ox);
+  other.dy = (int16_t)(other.dy + oy);
+  sdf_point *p = grid + y * width + x;
+  if (p->dx == FAR || length2(other) < length2(*p)) *p = other;
+}
+
+static void
+sweep(sdf_point *grid, int width, int height)
+{
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      compare(grid, width, height, x, y, -1, 0);
+      compare(grid, width, height, x, y, 0, -1);
+      compare(grid, width, height, x, y, -1, -1);
+      compare(grid, width, height, x, y, 1, -1);
+    }
+    for (int x = width - 1; x >= 0; --x) compare(grid, width, height, x, y, 1, 0);
+  }
+  for (int y = height - 1; y >= 0; --y)
+  {
+    for (int x = width - 1; x >= 0; --x)
+    {
+      compare(grid, width, height, x, y, 1, 0);
+      compare(grid, width, height, x, y, 0, 1);
+      compare(grid, width, height, x, y, -1, 1);
+      compare(grid, width, height, x, y, 1, 1);
+    }
+    for (int x = 0; x < width; ++x) compare(grid, width, height, x, y, -1, 0);
+  }
+}
+
+static inline float
+distance(sdf_point p)
+{
+  return p.dx == FAR ? (float)FAR : sqrtf((float)length2(p));
+}
+
+void
+mrb_sdf_generate(mrb_state *mrb, const unsigned char *coverage, int width, int height, int spread, unsigned char *field)
+{
+  size_t count = (size_t)width * (size_t)height;
+  if (!count) return;
+  // One grid finds the nearest inside pixel, the other the nearest outside one
+  sdf_point *inside = mrb_malloc(mrb, count * sizeof *inside);
+  sdf_point *outside = mrb_malloc(mrb, count * sizeof *outside);
+  for (size_t i = 0; i < count; ++i)
+  {
+    mrb_bool solid = coverage[i] >= 128;
+    inside[i] = solid ? (sdf_point){ 0, 0 } : (sdf_point){ FAR, FAR };
+    outside[i] = solid ? (sdf_point){ FAR, FAR } : (sdf_point){ 0, 0 };
+  }
+  sweep(inside, width, height);
+  sweep(outside, width, height);
+  float scale = 127.5f / (float)spread;
+  for (size_t i = 0; i < count; ++i)
+  {
+    // Half a pixel puts the edge between the last pixel in and the first out
+    float d = coverage[i] >= 128 ? distance(outside[i]) - 0.5f : 0.5f - distance(inside[i]);
+    float value = 127.5f + d * scale;
+    field[i] = (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value + 0.5f);
+  }
+  mrb_free(mrb, inside);
+  mrb_free(mrb, outside);
+}
@@ -2,10 +2,19 @@
 #include <mruby/data.h>
 #include <mruby/variable.h>
 #include <mruby/class.h>
+#include <mruby/array.h>
+#include <mruby/hash.h>
+#include <mruby/string.h>
 
+#include <math.h>
+#include <string.h>
 #include <rayfork.h>
 
+#include <orgf/blend.h>
+#include <orgf/collision.h>
 #include <orgf/drawable.h>
+#include <orgf/quads.h>
+#include <orgf/thread.h>
 #include <orgf/point.h>
 #include <orgf/rect.h>
 #include <orgf/color.h>
@@ -41,20 +50,53 @@ static mrb_bool shader_ready = FALSE;
 
 static struct
 {
-  int flash_color, bush, tone;
+  int flash_color, bush, tone, wave, premultiplied;
 } shader_locations;
 
+// The depth of a wavy sprite's corners carries its wave, see pack_wave
+static const char * sprite_vshader =
+#if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
+"#version 100\n"
+"attribute vec3 vertex_position;"
+"attribute vec2 vertex_tex_coord;"
+"attribute vec4 vertex_color;"
+"varying vec2 frag_tex_coord;"
+"varying vec4 frag_color;"
+"varying vec3 frag_wave;"
+#elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
+"#version 330\n"
+"in vec3 vertex_position;"
+"in vec2 vertex_tex_coord;"
+"in vec4 vertex_color;"
+"out vec2 frag_tex_coord;"
+"out vec4 frag_color;"
+"out vec3 frag_wave;"
+#endif
+"uniform mat4 mvp;"
+"void main()"
+"{"
+"    frag_tex_coord = vertex_tex_coord;"
+"    frag_color = vertex_color;"
+"    float packed = abs(vertex_position.z) - 1.0;"
+"    float phase = floor(packed / 16384.0);"
+"    frag_wave = vec3(radians(phase), packed - phase * 16384.0, step(vertex_position.z, 0.0));"
+"    gl_Position = mvp * vec4(vertex_position.xy, 0.0, 1.0);"
+"}"
+;
+
 static const char * sprite_fshader =
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
 "#version 100\n"
 "precision mediump float;"
 "varying vec2 frag_tex_coord;"
 "varying vec4 frag_color;"
+"varying vec3 frag_wave;"
 #elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
 "#version 330\n"
 "precision mediump float;"
 "in vec2 frag_tex_coord;"
 "in vec4 frag_color;"
+"in vec3 frag_wave;"
 "out vec4 final_color;"
 #endif
 "uniform sampler2D texture0;"
@@ -62,27 +104,36 @@ static const char * sprite_fshader =
 "uniform vec4 flash_color;"
 "uniform vec4 tone;"
 "uniform vec2 bush;"
+"uniform vec4 wave;"
+"uniform float premultiplied;"
 "void main()"
 "{"
+"    vec2 uv = frag_tex_coord;"
+"    float shift = wave.x * sin(frag_wave.x + uv.y * wave.w * wave.y);" // Each row moves sideways by the wave
+"    uv.x -= shift / wave.z;"
+"    float column = frag_wave.z * (frag_wave.y + 2.0 * abs(wave.x)) - abs(wave.x) - shift;"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
-"    vec4 texel_color = texture2D(texture0, frag_tex_coord);" // NOTE: texture2D() is deprecated on OpenGL 3.3 and ES 3.0
+"    vec4 texel_color = texture2D(texture0, uv);" // NOTE: texture2D() is deprecated on OpenGL 3.3 and ES 3.0
 #elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
-"    vec4 texel_color = texture(texture0, frag_tex_coord);"
+"    vec4 texel_color = texture(texture0, uv);"
 #endif
+"    if (wave.x != 0.0 && (column < 0.0 || column > frag_wave.y)) texel_color = vec4(0.0);"
 "    float bush_op = 1;"
 "    if (frag_tex_coord.y > bush.y) bush_op = bush.x;"
 "    float a = 1 - flash_color.a;"
 "    float ta = 1 - tone.a;"
-"    texel_color.r = texel_color.r + tone.r;"
-"    texel_color.g = texel_color.g + tone.g;"
-"    texel_color.b = texel_color.b + tone.b;"
+"    float pa = mix(1.0, texel_color.a, premultiplied);" // Premultiplied texels scale the colors added to them
+"    texel_color.r = texel_color.r + tone.r * pa;"
+"    texel_color.g = texel_color.g + tone.g * pa;"
+"    texel_color.b = texel_color.b + tone.b * pa;"
 "    float gray = (0.3 * texel_color.r) + (0.59 * texel_color.g) + (0.11 * texel_color.b);"
-"    texel_color.r = texel_color.r * a + flash_color.r * flash_color.a;"
-"    texel_color.g = texel_color.g * a + flash_color.g * flash_color.a;"
-"    texel_color.b = texel_color.b * a + flash_color.b * flash_color.a;"
+"    texel_color.r = texel_color.r * a + flash_color.r * flash_color.a * pa;"
+"    texel_color.g = texel_color.g * a + flash_color.g * flash_color.a * pa;"
+"    texel_color.b = texel_color.b * a + flash_color.b * flash_color.a * pa;"
 "    texel_color.r = texel_color.r * ta + gray * tone.a;"
 "    texel_color.g = texel_color.g * ta + gray * tone.a;"
 "    texel_color.b = texel_color.b * ta + gray * tone.a;"
+"    if (premultiplied > 0.5) texel_color.rgb = clamp(texel_color.rgb, 0.0, texel_color.a) * bush_op;"
 "    texel_color.a = texel_color.a * bush_op;"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
 "    frag_color = texel_color*col_diffuse*frag_color;"
@@ -96,60 +147,115 @@ static void
 init_shader(mrb_state *mrb)
 {
   rf_get_default_shader();
-  sprite_shader = rf_gfx_load_shader(NULL, sprite_fshader);
+  sprite_shader = rf_gfx_load_shader(sprite_vshader, sprite_fshader);
   shader_locations.flash_color = rf_gfx_get_shader_location(sprite_shader, "flash_color");
   shader_locations.bush = rf_gfx_get_shader_location(sprite_shader, "bush");
   shader_locations.tone = rf_gfx_get_shader_location(sprite_shader, "tone");
+  shader_locations.wave = rf_gfx_get_shader_location(sprite_shader, "wave");
+  shader_locations.premultiplied = rf_gfx_get_shader_location(sprite_shader, "premultiplied");
   shader_ready = TRUE;
 }
 
-static inline void
-bind_shader(rf_sprite *sprite)
+typedef struct sprite_uniforms sprite_uniforms;
+
+/* What the sprite shader needs from a sprite, unused effects are left at
+   neutral values so sprites without them compare equal and batch.
+   The phase and width of a wave change from sprite to sprite, so they go
+   with the vertices instead and only the wave's shape is a uniform. */
+struct sprite_uniforms
 {
-  float rgba[] = {
-    (float)sprite->flash_color.r / 255.0f, 
-    (float)sprite->flash_color.g / 255.0f, 
-    (float)sprite->flash_color.b / 255.0f, 
-    (float)sprite->flash_color.a / 255.0f,
-  };
-  float tone[] = {
-    (float)sprite->tone->r / 255.f,
-    (float)sprite->tone->g / 255.f,
-    (float)sprite->tone->b / 255.f,
-    (float)sprite->tone->a / 255.f
-  };
-  float h = sprite->src_rect->height;
-  h = (sprite->src_rect->height - sprite->bush.y) / h;
-  float th = sprite->bitmap->texture.height;
-  float bush[] = {
-    sprite->bush.x,
-    (sprite->src_rect->y + h * sprite->src_rect->height) / th
-  };
-  rf_gfx_set_shader_value(sprite_shader, shader_locations.flash_color, rgba, RF_UNIFORM_VEC4);
-  rf_gfx_set_shader_value(sprite_shader, shader_locations.tone, tone, RF_UNIFORM_VEC4);
-  rf_gfx_set_shader_value(sprite_shader, shader_locations.bush, bush, RF_UNIFORM_VEC2);
+  float flash_color[4];
+  float tone[4];
+  float bush[2];
+  // Amplitude in pixels, radians per pixel of height and the texture size
+  float wave[4];
+};
+
+static const sprite_uniforms neutral_uniforms = {
+  { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 2 }, { 0, 0, 1, 1 }
+};
+
+/* Tiles have their own texture coordinates, so they go without bush and waves. */
+static void
+fill_uniforms(rf_sprite *sprite, rf_texture2d texture, mrb_bool tiled, sprite_uniforms *u)
+{
+  *u = neutral_uniforms;
+  if (sprite->flash_color.a)
+  {
+    u->flash_color[0] = (float)sprite->flash_color.r / 255.0f;
+    u->flash_color[1] = (float)sprite->flash_color.g / 255.0f;
+    u->flash_color[2] = (float)sprite->flash_color.b / 255.0f;
+    u->flash_color[3] = (float)sprite->flash_color.a / 255.0f;
+  }
+  u->tone[0] = (float)sprite->tone->r / 255.f;
+  u->tone[1] = (float)sprite->tone->g / 255.f;
+  u->tone[2] = (float)sprite->tone->b / 255.f;
+  u->tone[3] = (float)sprite->tone->a / 255.f;
+  if (tiled) return;
+  rf_rec src = *(sprite->src_rect);
+  float tw = (float)texture.width, th = (float)texture.height;
+  if (sprite->bush.y)
+  {
+    float h = (src.height - sprite->bush.y) / src.height;
+    u->bush[0] = sprite->bush.x;
+    u->bush[1] = (src.y + h * src.height) / th;
+  }
+  if (sprite->wave_amp)
+  {
+    u->wave[0] = (float)sprite->wave_amp;
+    u->wave[1] = sprite->wave_length > 0 ? 2 * RF_PI / (float)sprite->wave_length : 0;
+    u->wave[2] = tw;
+    u->wave[3] = th;
+  }
+}
+
+/* The rest of a wave goes in the depth of the sprite's corners as the phase
+   in whole degrees, counted from the texture's top row, and the source
+   width in pixels. The sign tells the corners at the left of the source
+   from those at its right; depth is not used by 2D drawing. */
+static float
+pack_wave(rf_sprite *sprite)
+{
+  if (!sprite->wave_amp) return 0;
+  rf_rec src = *(sprite->src_rect);
+  double phase = sprite->wave_phase;
+  if (sprite->wave_length > 0) phase -= 360.0 * src.y / sprite->wave_length;
+  phase = fmod(floor(phase + 0.5), 360);
+  if (phase < 0) phase += 360;
+  float width = fminf(floorf(fabsf(src.width) + 0.5f), 16383);
+  return 1 + (float)phase * 16384 + width;
 }
 
 static inline void
-swap_point(float *p1, float *p2)
+bind_shader(const sprite_uniforms *u)
 {
-  float tmp[2] = { p1[0], p1[1] };
-  p1[0] = p2[0];
-  p1[1] = p2[1];
-  p2[0] = tmp[0];
-  p2[1] = tmp[1];
+  float premultiplied = mrb_get_premultiplied_alpha() ? 1.0f : 0.0f;
+  rf_gfx_set_shader_value(sprite_shader, shader_locations.flash_color, u->flash_color, RF_UNIFORM_VEC4);
+  rf_gfx_set_shader_value(sprite_shader, shader_locations.tone, u->tone, RF_UNIFORM_VEC4);
+  rf_gfx_set_shader_value(sprite_shader, shader_locations.bush, u->bush, RF_UNIFORM_VEC2);
+  rf_gfx_set_shader_value(sprite_shader, shader_locations.wave, u->wave, RF_UNIFORM_VEC4);
+  rf_gfx_set_shader_value(sprite_shader, shader_locations.premultiplied, &premultiplied, RF_UNIFORM_FLOAT);
 }
 
+/* The part of the parent's coordinates that ends up on screen. */
 static void
-rf_draw_sprite(mrb_state *mrb, rf_sprite *sprite)
+visible_area(mrb_state *mrb, rf_container *container, rf_rec *area)
 {
-  if (!sprite->bitmap) return;
-
-  mrb_refresh_bitmap(sprite->bitmap);
-  rf_texture2d texture = sprite->bitmap->texture;
-  if (texture.id <= 0) return;
-  if (!texture.valid) return;
+  if (container == mrb_get_graphics_container(mrb))
+  {
+    rf_sizef size = mrb_get_graphics_size(mrb);
+    *area = (rf_rec){ 0, 0, size.width, size.height };
+    return;
+  }
+  rf_viewport *viewport = (rf_viewport *)container;
+  *area = (rf_rec){ -viewport->offset->x, -viewport->offset->y, viewport->rect->width, viewport->rect->height };
+}
 
+/* Bitmaps past the texture size limit draw tile by tile, on their own. */
+static void
+draw_tiled_sprite(mrb_state *mrb, rf_sprite *sprite)
+{
+  rf_bitmap *bitmap = sprite->bitmap;
   mrb_bool flip_x = FALSE, flip_y = FALSE;
 
   float sx = sprite->scale->x, sy = sprite->scale->y;
@@ -160,70 +266,216 @@ rf_draw_sprite(mrb_state *mrb, rf_sprite *sprite)
   if (sy < 0) { flip_y = true; sy *= -1; }
 
   rf_rec src = *(sprite->src_rect);
-  float width  = (float)texture.width;
-  float height = (float)texture.height;
   rf_rec dst = (rf_rec){
     sprite->position->x, sprite->position->y, src.width * sx, src.height * sy
   };
 
-  float corners[4][2] = {
-    // Bottom-left corner for texture and quad
-    { src.x/width, src.y/height },
-    // Bottom-right corner for texture and quad
-    { src.x/width, (src.y + src.height)/height },
-    // Top-right corner for texture and quad
-    { (src.x + src.width)/width, (src.y + src.height)/height },
-    // Top-left corner for texture and quad
-    { (src.x + src.width)/width, src.y/height }          
-  };
-
-  if (flip_x)
-  {
-    src.width *= -1;
-    swap_point(corners[0], corners[3]);
-    swap_point(corners[1], corners[2]);
-  }
-  if (flip_y)
-  {
-    src.height *= -1;
-    swap_point(corners[0], corners[1]);
-    swap_point(corners[2], corners[3]);
-  }
-
   float ox = sprite->anchor->x * dst.width;
   float oy = sprite->anchor->y * dst.height;
 
   rf_color color = *(sprite->color);
 
   if (!color.a) return;
+  color = mrb_blend_color(color, sprite->blend_mode);
 
-  rf_gfx_enable_texture(texture.id);
+  sprite_uniforms uniforms;
+  fill_uniforms(sprite, bitmap->texture, TRUE, &uniforms);
   rf_gfx_push_matrix();
-    rf_begin_blend_mode(sprite->blend_mode);
+    ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+    mrb_begin_blend_mode(sprite->blend_mode);
     rf_gfx_translatef(dst.x, dst.y, 0);
     rf_gfx_rotatef(sprite->rotation, 0, 0, 1);
     rf_gfx_translatef(-ox, -oy, 0);
     rf_begin_shader(sprite_shader);
-    bind_shader(sprite);
-    rf_gfx_begin(RF_QUADS);
-      rf_gfx_color4ub(color.r, color.g, color.b, color.a);
-      // Bottom-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[0][0], corners[0][1]);
-      rf_gfx_vertex2f(0.0f, 0.0f);
-      // Bottom-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[1][0], corners[1][1]);
-      rf_gfx_vertex2f(0.0f, dst.height);
-      // Top-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[2][0], corners[2][1]);
-      rf_gfx_vertex2f(dst.width, dst.height);
-      // Top-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[3][0], corners[3][1]);
-      rf_gfx_vertex2f(dst.width, 0.0f);
-    rf_gfx_end();
+    bind_shader(&uniforms);
+    // Unrotated sprites only upload the tiles that reach the screen
+    rf_rec area;
+    visible_area(mrb, sprite->base.container, &area);
+    area.x -= dst.x - ox;
+    area.y -= dst.y - oy;
+    mrb_tiled_texture_draw(mrb, bitmap->tiles, mrb_bitmap_get_image(mrb, bitmap), *(sprite->src_rect),
+                           (rf_rec){ 0, 0, dst.width, dst.height }, flip_x, flip_y,
+                           sprite->rotation ? NULL : &area, color);
+    ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
     rf_end_shader();
-    rf_end_blend_mode();
+    ORGF_STATS_SETTLE();
+    mrb_end_blend_mode();
   rf_gfx_pop_matrix();
-  rf_gfx_disable_texture();
+}
+
+// Quads drawn in one rf_gfx_begin, as the particles do
+#define QUADS_PER_BATCH 1024
+
+static rf_sprite_quads run_quads;
+static sprite_uniforms *run_uniforms;
+static float *run_waves;
+static mrb_int run_uniforms_capa;
+
+static void
+reserve_run(mrb_state *mrb, mrb_int count)
+{
+  mrb_sprite_quads_reserve(mrb, &run_quads, count);
+  if (run_uniforms_capa >= run_quads.capa) return;
+  run_uniforms = mrb_realloc(mrb, run_uniforms, (size_t)run_quads.capa * sizeof *run_uniforms);
+  run_waves = mrb_realloc(mrb, run_waves, (size_t)run_quads.capa * sizeof *run_waves);
+  run_uniforms_capa = run_quads.capa;
+}
+
+static void
+gather_sprite(mrb_state *mrb, rf_sprite *sprite)
+{
+  rf_texture2d texture = sprite->bitmap->texture;
+  if (texture.id <= 0 || !texture.valid) return;
+
+  float sx = sprite->scale->x, sy = sprite->scale->y;
+  rf_color color = *(sprite->color);
+  if (!sx || !sy || !color.a) return;
+
+  rf_rec src = *(sprite->src_rect);
+  float width = src.width * fabsf(sx), height = src.height * fabsf(sy);
+  float ox = sprite->anchor->x * width, oy = sprite->anchor->y * height;
+  // Waves move rows sideways, the quad grows by the amplitude so they stay inside
+  float pad = fabsf((float)sprite->wave_amp);
+  rf_sprite_quads *q = &run_quads;
+  mrb_int i = q->count++;
+  q->x[i] = sprite->position->x;
+  q->y[i] = sprite->position->y;
+  q->left[i] = -ox - pad * fabsf(sx);
+  q->top[i] = -oy;
+  q->right[i] = width - ox + pad * fabsf(sx);
+  q->bottom[i] = height - oy;
+  if (sprite->rotation)
+  {
+    float angle = sprite->rotation * (RF_PI / 180.0f);
+    q->cos[i] = cosf(angle);
+    q->sin[i] = sinf(angle);
+  }
+  else
+  {
+    q->cos[i] = 1;
+    q->sin[i] = 0;
+  }
+  q->src_u0[i] = sx < 0 ? src.x + src.width + pad : src.x - pad;
+  q->src_u1[i] = sx < 0 ? src.x - pad : src.x + src.width + pad;
+  q->src_v0[i] = sy < 0 ? src.y + src.height : src.y;
+  q->src_v1[i] = sy < 0 ? src.y : src.y + src.height;
+  q->inv_width[i] = 1.0f / (float)texture.width;
+  q->inv_height[i] = 1.0f / (float)texture.height;
+  q->color[i] = mrb_blend_color(color, sprite->blend_mode);
+  q->texture[i] = texture.id;
+  q->blend[i] = sprite->blend_mode;
+  fill_uniforms(sprite, texture, FALSE, run_uniforms + i);
+  run_waves[i] = pack_wave(sprite);
+}
+
+static inline void
+emit_corner(rf_sprite_quads *q, mrb_int i, int corner, float u, float v)
+{
+  rf_color color = q->color[i];
+  rf_gfx_color4ub(color.r, color.g, color.b, color.a);
+  rf_gfx_tex_coord2f(u, v);
+  float wave = run_waves[i];
+  if (!wave)
+  {
+    rf_gfx_vertex2f(q->vx[corner * q->capa + i], q->vy[corner * q->capa + i]);
+    return;
+  }
+  // Flipped sprites have the source's left at their right
+  if (u > fminf(q->u0[i], q->u1[i])) wave = -wave;
+  rf_gfx_vertex3f(q->vx[corner * q->capa + i], q->vy[corner * q->capa + i], wave);
+}
+
+static inline mrb_bool
+same_batch(rf_sprite_quads *q, mrb_int a, mrb_int b)
+{
+  return q->texture[a] == q->texture[b] && q->blend[a] == q->blend[b] &&
+         !memcmp(run_uniforms + a, run_uniforms + b, sizeof *run_uniforms);
+}
+
+static void
+flush_sprite_run(void)
+{
+  rf_sprite_quads *q = &run_quads;
+  if (!q->count) return;
+  mrb_sprite_quads_compute(q);
+  mrb_int i = 0;
+  while (i < q->count)
+  {
+    // Neighbours sharing texture, blend mode and uniforms are a single draw
+    mrb_int last = i + 1;
+    while (last < q->count && same_batch(q, i, last)) ++last;
+    // Sprites without effects look the same with the default shader
+    mrb_bool shaded = memcmp(run_uniforms + i, &neutral_uniforms, sizeof neutral_uniforms) != 0;
+    ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+    mrb_begin_blend_mode(q->blend[i]);
+    rf_gfx_enable_texture(q->texture[i]);
+    if (shaded)
+    {
+      rf_begin_shader(sprite_shader);
+      bind_shader(run_uniforms + i);
+    }
+    for (mrb_int start = i; start < last; start += QUADS_PER_BATCH)
+    {
+      mrb_int end = start + QUADS_PER_BATCH;
+      if (end > last) end = last;
+      if (rf_gfx_check_buffer_limit((int)(end - start) * 4)) rf_gfx_draw();
+      rf_gfx_begin(RF_QUADS);
+      for (mrb_int k = start; k < end; ++k)
+      {
+        emit_corner(q, k, 0, q->u0[k], q->v0[k]);
+        emit_corner(q, k, 1, q->u0[k], q->v1[k]);
+        emit_corner(q, k, 2, q->u1[k], q->v1[k]);
+        emit_corner(q, k, 3, q->u1[k], q->v0[k]);
+      }
+      rf_gfx_end();
+    }
+    if (shaded)
+    {
+      // The next batch may set other uniforms, these quads must be drawn first
+      ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
+      rf_end_shader();
+      ORGF_STATS_SETTLE();
+    }
+    rf_gfx_disable_texture();
+    i = last;
+  }
+  mrb_end_blend_mode();
+  q->count = 0;
+}
+
+/* Sprites only gather their transform and uniforms, their corners are
+   computed together once the run ends or a tiled sprite interrupts it. */
+static void
+rf_draw_sprite_run(mrb_state *mrb, rf_drawable **items, mrb_int count)
+{
+  reserve_run(mrb, count);
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    rf_sprite *sprite = (rf_sprite *)items[i];
+    if (!sprite->base.visible)
+    {
+      ORGF_STATS_ADD(culled, 1);
+      continue;
+    }
+    if (!sprite->bitmap) continue;
+    // Refreshing may leave the bitmap tiled, so it comes before the check
+    mrb_refresh_bitmap(mrb, sprite->bitmap);
+    if (!sprite->bitmap->tiles)
+    {
+      gather_sprite(mrb, sprite);
+      continue;
+    }
+    flush_sprite_run();
+    draw_tiled_sprite(mrb, sprite);
+  }
+  flush_sprite_run();
+}
+
+static void
+rf_draw_sprite(mrb_state *mrb, rf_sprite *sprite)
+{
+  rf_drawable *item = &(sprite->base);
+  rf_draw_sprite_run(mrb, &item, 1);
 }
 
 static mrb_value
@@ -240,6 +492,8 @@ mrb_sprite_initialize(mrb_state *mrb, mrb_value self)
   sprite->base.container = NULL;
   sprite->base.z = 0;
   sprite->base.draw = (rf_drawable_draw_callback)rf_draw_sprite;
+  sprite->base.draw_run = rf_draw_sprite_run;
+  sprite->base.tick = NULL;
   sprite->base.update = NULL;
   sprite->base.visible = TRUE;
   sprite->bitmap = NULL;
@@ -492,9 +746,129 @@ mrb_sprite_update(mrb_state *mrb, mrb_value self)
     sprite->flash_color.g = sprite->original_flash_color.g;
     sprite->flash_color.b = sprite->original_flash_color.b;
   }
+  if (sprite->wave_amp && sprite->wave_speed)
+  {
+    // Phase is in degrees, speed in degrees per second
+    sprite->wave_phase = fmod(sprite->wave_phase + sprite->wave_speed * mrb_get_dt(mrb), 360);
+  }
   return mrb_nil_value();
 }
 
+typedef struct sprite_shape sprite_shape;
+
+/* Where a sprite's source pixels land on screen. */
+struct sprite_shape
+{
+  rf_collision_mask *mask;
+  int                src_x, src_y, src_w, src_h;
+  float              x, y, sx, sy;
+  mrb_bool           flip_x, flip_y;
+};
+
+static mrb_bool
+get_shape(mrb_state *mrb, rf_sprite *sprite, sprite_shape *shape)
+{
+  if (!sprite->bitmap) return FALSE;
+  shape->src_x = (int)sprite->src_rect->x;
+  shape->src_y = (int)sprite->src_rect->y;
+  shape->src_w = (int)sprite->src_rect->width;
+  shape->src_h = (int)sprite->src_rect->height;
+  shape->sx = fabsf(sprite->scale->x);
+  shape->sy = fabsf(sprite->scale->y);
+  if (shape->src_w <= 0 || shape->src_h <= 0 || !shape->sx || !shape->sy) return FALSE;
+  shape->flip_x = sprite->scale->x < 0;
+  shape->flip_y = sprite->scale->y < 0;
+  shape->x = sprite->position->x - sprite->anchor->x * shape->src_w * shape->sx;
+  shape->y = sprite->position->y - sprite->anchor->y * shape->src_h * shape->sy;
+  rf_bitmap *bmp = sprite->bitmap;
+  int threshold = bmp->collision ? bmp->collision->threshold : ORGF_COLLISION_THRESHOLD;
+  shape->mask = mrb_bitmap_get_collision_mask(mrb, bmp, threshold);
+  return TRUE;
+}
+
+static inline int
+source_x(sprite_shape *shape, int x)
+{
+  return shape->flip_x ? shape->src_x + shape->src_w - 1 - x : shape->src_x + x;
+}
+
+static inline int
+source_y(sprite_shape *shape, int y)
+{
+  return shape->flip_y ? shape->src_y + shape->src_h - 1 - y : shape->src_y + y;
+}
+
+/* Unscaled sprites line up pixel for pixel, so rows are compared 64 pixels
+   at a time. A screen pixel belongs to the source pixel under its center. */
+static mrb_bool
+collide_unscaled(sprite_shape *a, sprite_shape *b)
+{
+  int ax = (int)floorf(0.5f - a->x), ay = (int)floorf(0.5f - a->y);
+  int bx = (int)floorf(0.5f - b->x), by = (int)floorf(0.5f - b->y);
+  int x0 = -ax > -bx ? -ax : -bx;
+  int x1 = a->src_w - ax < b->src_w - bx ? a->src_w - ax : b->src_w - bx;
+  int y0 = -ay > -by ? -ay : -by;
+  int y1 = a->src_h - ay < b->src_h - by ? a->src_h - ay : b->src_h - by;
+  for (int y = y0; y < y1; ++y)
+  {
+    int row_a = source_y(a, y + ay);
+    int row_b = source_y(b, y + by);
+    for (int x = x0; x < x1; x += 64)
+    {
+      int count = x1 - x < 64 ? x1 - x : 64;
+      uint64_t bits = mrb_collision_mask_row(a->mask, source_x(a, x + ax), row_a, count, a->flip_x);
+      if (!bits) continue;
+      if (bits & mrb_collision_mask_row(b->mask, source_x(b, x + bx), row_b, count, b->flip_x)) return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static inline mrb_bool
+solid_at(sprite_shape *shape, float x, float y)
+{
+  int u = (int)floorf((x - shape->x) / shape->sx);
+  int v = (int)floorf((y - shape->y) / shape->sy);
+  if (u < 0 || v < 0 || u >= shape->src_w || v >= shape->src_h) return FALSE;
+  return mrb_collision_mask_get(shape->mask, source_x(shape, u), source_y(shape, v));
+}
+
+static mrb_bool
+collide_scaled(sprite_shape *a, sprite_shape *b, float x0, float y0, float x1, float y1)
+{
+  for (int y = (int)floorf(y0); y < (int)ceilf(y1); ++y)
+  {
+    for (int x = (int)floorf(x0); x < (int)ceilf(x1); ++x)
+    {
+      if (solid_at(a, x + 0.5f, y + 0.5f) && solid_at(b, x + 0.5f, y + 0.5f)) return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+mrb_bool
+mrb_sprite_collide(mrb_state *mrb, rf_sprite *a, rf_sprite *b)
+{
+  sprite_shape sa, sb;
+  if (!get_shape(mrb, a, &sa) || !get_shape(mrb, b, &sb)) return FALSE;
+  float x0 = fmaxf(sa.x, sb.x);
+  float y0 = fmaxf(sa.y, sb.y);
+  float x1 = fminf(sa.x + sa.src_w * sa.sx, sb.x + sb.src_w * sb.sx);
+  float y1 = fminf(sa.y + sa.src_h * sa.sy, sb.y + sb.src_h * sb.sy);
+  if (x0 >= x1 || y0 >= y1) return FALSE;
+  if (sa.sx == 1 && sa.sy == 1 && sb.sx == 1 && sb.sy == 1) return collide_unscaled(&sa, &sb);
+  return collide_scaled(&sa, &sb, x0, y0, x1, y1);
+}
+
+static mrb_value
+mrb_sprite_collideQ(mrb_state *mrb, mrb_value self)
+{
+  mrb_value other;
+  rf_sprite *sprite = mrb_get_sprite(mrb, self);
+  mrb_get_args(mrb, "o", &other);
+  return mrb_bool_value(mrb_sprite_collide(mrb, sprite, mrb_get_sprite(mrb, other)));
+}
+
 static mrb_value
 mrb_sprite_get_bush_depth(mrb_state *mrb, mrb_value self)
 {
@@ -598,6 +972,179 @@ mrb_sprite_set_wave_phase(mrb_state *mrb, mrb_value self)
   return mrb_float_value(mrb, value);
 }
 
+typedef struct bulk_column bulk_column;
+
+/* The values of one attribute for every sprite in a bulk update, stride per
+   sprite. They come as an Array of numbers or a String of native floats,
+   as packed by pack("f*"). */
+struct bulk_column
+{
+  mrb_value    array;
+  const char  *floats;
+  mrb_int      stride;
+  mrb_bool     present;
+};
+
+static void
+get_bulk_column(mrb_state *mrb, mrb_value options, const char *name, mrb_int stride, mrb_int count, bulk_column *column)
+{
+  mrb_value value = mrb_hash_get(mrb, options, mrb_symbol_value(mrb_intern_cstr(mrb, name)));
+  mrb_int size;
+  column->array = value;
+  column->floats = NULL;
+  column->stride = stride;
+  column->present = !mrb_nil_p(value);
+  if (!column->present) return;
+  if (mrb_string_p(value))
+  {
+    column->floats = RSTRING_PTR(value);
+    size = RSTRING_LEN(value) / (mrb_int)sizeof(float);
+  }
+  else if (mrb_array_p(value))
+  {
+    size = RARRAY_LEN(value);
+  }
+  else
+  {
+    mrb_raisef(mrb, E_TYPE_ERROR, "%s must be an Array or a packed String", name);
+  }
+  if (size < count * stride) mrb_raisef(mrb, E_ARGUMENT_ERROR, "%s has fewer values than sprites", name);
+}
+
+static inline float
+bulk_value(mrb_state *mrb, bulk_column *column, mrb_int sprite, mrb_int offset)
+{
+  mrb_int index = sprite * column->stride + offset;
+  if (column->floats)
+  {
+    float value;
+    memcpy(&value, column->floats + index * sizeof value, sizeof value);
+    return value;
+  }
+  return (float)mrb_to_flo(mrb, mrb_ary_entry(column->array, index));
+}
+
+static void
+bulk_update(mrb_state *mrb, mrb_value sprites, mrb_value options)
+{
+  mrb_int count = RARRAY_LEN(sprites);
+  bulk_column x, y, z, opacity, src_rect;
+  get_bulk_column(mrb, options, "x", 1, count, &x);
+  get_bulk_column(mrb, options, "y", 1, count, &y);
+  get_bulk_column(mrb, options, "z", 1, count, &z);
+  get_bulk_column(mrb, options, "opacity", 1, count, &opacity);
+  get_bulk_column(mrb, options, "src_rect", 4, count, &src_rect);
+  rf_container *invalidated = NULL;
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    rf_sprite *sprite = mrb_get_sprite(mrb, mrb_ary_entry(sprites, i));
+    if (x.present) sprite->position->x = bulk_value(mrb, &x, i, 0);
+    if (y.present) sprite->position->y = bulk_value(mrb, &y, i, 0);
+    if (z.present)
+    {
+      mrb_int value = (mrb_int)bulk_value(mrb, &z, i, 0);
+      // Siblings usually share a container, it's only marked once
+      if (sprite->base.z != value)
+      {
+        sprite->base.z = value;
+        if (sprite->base.container != invalidated)
+        {
+          invalidated = sprite->base.container;
+          mrb_container_invalidate(mrb, invalidated);
+        }
+      }
+    }
+    if (opacity.present)
+    {
+      float value = bulk_value(mrb, &opacity, i, 0);
+      sprite->color->a = (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+    if (src_rect.present)
+    {
+      *(sprite->src_rect) = (rf_rec){
+        bulk_value(mrb, &src_rect, i, 0), bulk_value(mrb, &src_rect, i, 1),
+        bulk_value(mrb, &src_rect, i, 2), bulk_value(mrb, &src_rect, i, 3)
+      };
+    }
+  }
+}
+
+/* Sets x, y, z, opacity and src_rect (four values each) of many sprites in
+   one call, sprite i takes the i-th values of each given attribute. */
+static mrb_value
+mrb_sprite_s_bulk_update(mrb_state *mrb, mrb_value self)
+{
+  mrb_value sprites, options;
+  mrb_get_args(mrb, "AH", &sprites, &options);
+  bulk_update(mrb, sprites, options);
+  return sprites;
+}
+
+/* Milliseconds a frame takes to move count sprites with their setters and
+   with a bulk update, the screen must be open to create them. */
+static mrb_value
+mrb_sprite_s_bulk_benchmark(mrb_state *mrb, mrb_value self)
+{
+  mrb_int count = 2000;
+  mrb_get_args(mrb, "|i", &count);
+  if (count < 1) mrb_raise(mrb, E_ARGUMENT_ERROR, "sprite count must be positive");
+  struct RClass *klass = mrb_class_ptr(self);
+  mrb_value sprites = mrb_ary_new_capa(mrb, count);
+  mrb_value xs = mrb_ary_new_capa(mrb, count);
+  mrb_value ys = mrb_ary_new_capa(mrb, count);
+  mrb_value zs = mrb_ary_new_capa(mrb, count);
+  mrb_value opacities = mrb_ary_new_capa(mrb, count);
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    int arena = mrb_gc_arena_save(mrb);
+    mrb_ary_push(mrb, sprites, mrb_obj_new(mrb, klass, 0, NULL));
+    mrb_ary_push(mrb, xs, mrb_float_value(mrb, (mrb_float)(i % 640)));
+    mrb_ary_push(mrb, ys, mrb_float_value(mrb, (mrb_float)(i % 480)));
+    mrb_ary_push(mrb, zs, mrb_fixnum_value(i % 16));
+    mrb_ary_push(mrb, opacities, mrb_fixnum_value(i % 256));
+    mrb_gc_arena_restore(mrb, arena);
+  }
+  mrb_value options = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, options, mrb_symbol_value(mrb_intern_lit(mrb, "x")), xs);
+  mrb_hash_set(mrb, options, mrb_symbol_value(mrb_intern_lit(mrb, "y")), ys);
+  mrb_hash_set(mrb, options, mrb_symbol_value(mrb_intern_lit(mrb, "z")), zs);
+  mrb_hash_set(mrb, options, mrb_symbol_value(mrb_intern_lit(mrb, "opacity")), opacities);
+  double frame_ms[2];
+  for (int bulk = 0; bulk < 2; ++bulk)
+  {
+    mrb_int runs = 0;
+    uint64_t start = orgf_time_ns(), elapsed = 0;
+    while (runs < 5 || elapsed < 100000000)
+    {
+      if (bulk)
+      {
+        bulk_update(mrb, sprites, options);
+      }
+      else
+      {
+        for (mrb_int i = 0; i < count; ++i)
+        {
+          int arena = mrb_gc_arena_save(mrb);
+          mrb_value sprite = mrb_ary_entry(sprites, i);
+          mrb_funcall(mrb, sprite, "x=", 1, mrb_ary_entry(xs, i));
+          mrb_funcall(mrb, sprite, "y=", 1, mrb_ary_entry(ys, i));
+          mrb_funcall(mrb, sprite, "z=", 1, mrb_ary_entry(zs, i));
+          mrb_funcall(mrb, sprite, "opacity=", 1, mrb_ary_entry(opacities, i));
+          mrb_gc_arena_restore(mrb, arena);
+        }
+      }
+      runs += 1;
+      elapsed = orgf_time_ns() - start;
+    }
+    frame_ms[bulk] = (double)elapsed / 1000000.0 / (double)runs;
+  }
+  for (mrb_int i = 0; i < count; ++i) mrb_funcall(mrb, mrb_ary_entry(sprites, i), "dispose", 0);
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "setters")), mrb_float_value(mrb, frame_ms[0]));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "bulk")), mrb_float_value(mrb, frame_ms[1]));
+  return hash;
+}
+
 void
 mrb_init_orgf_sprite(mrb_state *mrb)
 {
@@ -606,11 +1153,15 @@ mrb_init_orgf_sprite(mrb_state *mrb)
 
   mrb_define_method(mrb, sprite, "initialize", mrb_sprite_initialize, MRB_ARGS_OPT(1));
 
+  mrb_define_class_method(mrb, sprite, "bulk_update", mrb_sprite_s_bulk_update, MRB_ARGS_REQ(2));
+  mrb_define_class_method(mrb, sprite, "bulk_benchmark", mrb_sprite_s_bulk_benchmark, MRB_ARGS_OPT(1));
+
   mrb_define_method(mrb, sprite, "disposed?", mrb_sprite_disposedQ, MRB_ARGS_NONE());
   mrb_define_method(mrb, sprite, "dispose", mrb_sprite_dispose, MRB_ARGS_NONE());
 
   mrb_define_method(mrb, sprite, "flash", mrb_sprite_flash, MRB_ARGS_REQ(2));
   mrb_define_method(mrb, sprite, "update", mrb_sprite_update, MRB_ARGS_NONE());
+  mrb_define_method(mrb, sprite, "collide?", mrb_sprite_collideQ, MRB_ARGS_REQ(1));
 
   mrb_define_method(mrb, sprite, "z", mrb_sprite_get_z, MRB_ARGS_NONE());
   mrb_define_method(mrb, sprite, "z=", mrb_sprite_set_z, MRB_ARGS_REQ(1));
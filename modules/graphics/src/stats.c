@@ -0,0 +1,225 @@
+#include <mruby.h>
+#include <mruby/hash.h>
+
+#include <rayfork.h>
+#include <string.h>
+
+#include <orgf/stats.h>
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#define GL_TRIANGLES 0x0004
+
+rf_graphics_stats *mrb_active_stats = NULL;
+
+static struct
+{
+  void (*DrawElements)(unsigned int mode, int count, unsigned int type, const void *indices);
+  void (*DrawArrays)(unsigned int mode, int first, int count);
+  void (*BindTexture)(unsigned int target, unsigned int texture);
+  void (*UseProgram)(unsigned int program);
+  void (*BindFramebuffer)(unsigned int target, unsigned int framebuffer);
+  void (*BufferSubData)(unsigned int target, ptrdiff_t offset, ptrdiff_t size, const void *data);
+} original;
+
+static const char *FLUSH_REASONS[RF_FLUSH_REASONS] = {
+  "buffer",
+  "shader",
+  "blend",
+  "target",
+  "frame",
+  "scissor"
+};
+
+static void
+count_draw(mrb_int vertices)
+{
+  rf_graphics_stats *stats = mrb_active_stats;
+  stats->current.draw_calls += 1;
+  stats->current.vertices += vertices;
+  if (stats->pending_reason != RF_FLUSH_NONE)
+  {
+    stats->current.flushes[stats->pending_reason] += 1;
+    stats->pending_reason = RF_FLUSH_NONE;
+    stats->flush_open = TRUE;
+  }
+  else if (!stats->flush_open)
+  {
+    // Nothing in the engine asked for it, so the batch ran out of room
+    stats->current.flushes[RF_FLUSH_BUFFER] += 1;
+    stats->flush_open = TRUE;
+  }
+}
+
+static void
+stats_draw_elements(unsigned int mode, int count, unsigned int type, const void *indices)
+{
+  // The batch draws quads as two indexed triangles
+  count_draw(mode == GL_TRIANGLES ? count / 6 * 4 : count);
+  original.DrawElements(mode, count, type, indices);
+}
+
+static void
+stats_draw_arrays(unsigned int mode, int first, int count)
+{
+  count_draw(count);
+  original.DrawArrays(mode, first, count);
+}
+
+static void
+stats_bind_texture(unsigned int target, unsigned int texture)
+{
+  if (texture && texture != mrb_active_stats->texture)
+  {
+    mrb_active_stats->current.texture_binds += 1;
+    mrb_active_stats->texture = texture;
+  }
+  original.BindTexture(target, texture);
+}
+
+static void
+stats_use_program(unsigned int program)
+{
+  if (program && program != mrb_active_stats->program)
+  {
+    mrb_active_stats->current.shader_switches += 1;
+    mrb_active_stats->program = program;
+  }
+  original.UseProgram(program);
+}
+
+static void
+stats_bind_framebuffer(unsigned int target, unsigned int framebuffer)
+{
+  mrb_active_stats->current.target_switches += 1;
+  original.BindFramebuffer(target, framebuffer);
+}
+
+static void
+stats_buffer_sub_data(unsigned int target, ptrdiff_t offset, ptrdiff_t size, const void *data)
+{
+  // Every flush uploads the batch before drawing it
+  mrb_active_stats->flush_open = FALSE;
+  original.BufferSubData(target, offset, size, data);
+}
+
+void
+mrb_stats_enable(rf_graphics_stats *stats)
+{
+  if (mrb_active_stats) return;
+  original.DrawElements = rf_gl.DrawElements;
+  original.DrawArrays = rf_gl.DrawArrays;
+  original.BindTexture = rf_gl.BindTexture;
+  original.UseProgram = rf_gl.UseProgram;
+  original.BindFramebuffer = rf_gl.BindFramebuffer;
+  original.BufferSubData = rf_gl.BufferSubData;
+  rf_gl.DrawElements = stats_draw_elements;
+  rf_gl.DrawArrays = stats_draw_arrays;
+  rf_gl.BindTexture = stats_bind_texture;
+  rf_gl.UseProgram = stats_use_program;
+  rf_gl.BindFramebuffer = stats_bind_framebuffer;
+  rf_gl.BufferSubData = stats_buffer_sub_data;
+  memset(stats, 0, sizeof *stats);
+  stats->pending_reason = RF_FLUSH_NONE;
+  mrb_active_stats = stats;
+}
+
+void
+mrb_stats_disable(void)
+{
+  if (!mrb_active_stats) return;
+  // Putting the procs back leaves nothing behind on the hot path
+  rf_gl.DrawElements = original.DrawElements;
+  rf_gl.DrawArrays = original.DrawArrays;
+  rf_gl.BindTexture = original.BindTexture;
+  rf_gl.UseProgram = original.UseProgram;
+  rf_gl.BindFramebuffer = original.BindFramebuffer;
+  rf_gl.BufferSubData = original.BufferSubData;
+  mrb_active_stats = NULL;
+}
+
+void
+mrb_stats_commit(rf_graphics_stats *stats)
+{
+  stats->frames[stats->index] = stats->current;
+  stats->index = (stats->index + 1) % ORGF_STATS_FRAMES;
+  if (stats->count < ORGF_STATS_FRAMES) stats->count += 1;
+  memset(&(stats->current), 0, sizeof(stats->current));
+}
+
+static mrb_float
+frame_value(rf_frame_stats *frame, int metric)
+{
+  if (metric < RF_FLUSH_REASONS) return (mrb_float)frame->flushes[metric];
+  switch (metric - RF_FLUSH_REASONS)
+  {
+    case 0: return (mrb_float)frame->draw_calls;
+    case 1: return (mrb_float)frame->vertices;
+    case 2: return (mrb_float)frame->texture_binds;
+    case 3: return (mrb_float)frame->shader_switches;
+    case 4: return (mrb_float)frame->target_switches;
+    case 5: return (mrb_float)frame->visited;
+    case 6: return (mrb_float)frame->culled;
+    case 7: return (mrb_float)frame->direct_viewports;
+    case 8: return (mrb_float)frame->uploads;
+    case 9: return (mrb_float)frame->glyph_rasterizations;
+    case 10: return (mrb_float)frame->upload_time / 1000000.0;
+    case 11: return (mrb_float)frame->update_time / 1000000.0;
+    case 12: return (mrb_float)frame->draw_time / 1000000.0;
+    default: return (mrb_float)frame->present_time / 1000000.0;
+  }
+}
+
+static const char *METRICS[] = {
+  "draw_calls",
+  "vertices",
+  "texture_binds",
+  "shader_switches",
+  "target_switches",
+  "visited",
+  "culled",
+  "direct_viewports",
+  "uploads",
+  "glyph_rasterizations",
+  "upload_time",
+  "update_time",
+  "draw_time",
+  "present_time",
+  NULL
+};
+
+static mrb_value
+metric_summary(mrb_state *mrb, rf_graphics_stats *stats, int metric)
+{
+  mrb_float min = 0, max = 0, total = 0;
+  for (mrb_int i = 0; i < stats->count; ++i)
+  {
+    mrb_float value = frame_value(&(stats->frames[i]), metric);
+    if (!i || value < min) min = value;
+    if (!i || value > max) max = value;
+    total += value;
+  }
+  mrb_value hash = mrb_hash_new_capa(mrb, 3);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "min")), mrb_float_value(mrb, min));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "avg")), mrb_float_value(mrb, stats->count ? total / stats->count : 0));
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "max")), mrb_float_value(mrb, max));
+  return hash;
+}
+
+mrb_value
+mrb_stats_to_hash(mrb_state *mrb, rf_graphics_stats *stats)
+{
+  mrb_value hash = mrb_hash_new(mrb);
+  mrb_value flushes = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "frames")), mrb_fixnum_value(stats->count));
+  for (int i = 0; i < RF_FLUSH_REASONS; ++i)
+  {
+    mrb_hash_set(mrb, flushes, mrb_symbol_value(mrb_intern_cstr(mrb, FLUSH_REASONS[i])), metric_summary(mrb, stats, i));
+  }
+  mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_lit(mrb, "flushes")), flushes);
+  for (int i = 0; METRICS[i]; ++i)
+  {
+    mrb_hash_set(mrb, hash, mrb_symbol_value(mrb_intern_cstr(mrb, METRICS[i])), metric_summary(mrb, stats, RF_FLUSH_REASONS + i));
+  }
+  return hash;
+}
@@ -0,0 +1,127 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+
+#include <orgf/targets.h>
+
+static rf_render_target_pool pool = { 0 };
+
+static inline int
+bucket(int size)
+{
+  return (size + ORGF_TARGET_BUCKET - 1) / ORGF_TARGET_BUCKET * ORGF_TARGET_BUCKET;
+}
+
+static inline size_t
+target_bytes(rf_render_texture2d target)
+{
+  return (size_t)target.texture.width * (size_t)target.texture.height * 4;
+}
+
+static mrb_bool
+fits(rf_render_texture2d target, int width, int height, mrb_bool exact)
+{
+  int tw = target.texture.width;
+  int th = target.texture.height;
+  if (exact) return tw == width && th == height;
+  if (tw < width || th < height) return FALSE;
+  // Up to one bucket of slack, so a shrinking window doesn't hold a huge target
+  return tw <= bucket(width) + ORGF_TARGET_BUCKET && th <= bucket(height) + ORGF_TARGET_BUCKET;
+}
+
+rf_render_target_pool *
+mrb_get_render_target_pool(void)
+{
+  return &pool;
+}
+
+mrb_bool
+mrb_render_target_acquire(mrb_state *mrb, rf_render_target *target, int width, int height, mrb_bool exact)
+{
+  *target = (rf_render_target){ 0 };
+  if (width < 1 || height < 1) return FALSE;
+  rf_render_target_entry *best = NULL;
+  for (mrb_int i = 0; i < pool.count; ++i)
+  {
+    rf_render_target_entry *entry = pool.entries + i;
+    if (entry->in_use || entry->format != RF_UNCOMPRESSED_R8G8B8A8) continue;
+    if (!fits(entry->target, width, height, exact)) continue;
+    if (best && target_bytes(best->target) <= target_bytes(entry->target)) continue;
+    best = entry;
+  }
+  if (best)
+  {
+    pool.hits += 1;
+  }
+  else
+  {
+    if (pool.count >= pool.capa)
+    {
+      mrb_int capa = pool.capa ? pool.capa * 2 : 16;
+      pool.entries = mrb_realloc(mrb, pool.entries, sizeof(*pool.entries) * capa);
+      pool.capa = capa;
+    }
+    best = pool.entries + pool.count;
+    pool.count += 1;
+    best->target = exact ? rf_load_render_texture(width, height) : rf_load_render_texture(bucket(width), bucket(height));
+    best->format = RF_UNCOMPRESSED_R8G8B8A8;
+    pool.bytes += target_bytes(best->target);
+    pool.allocations += 1;
+  }
+  best->in_use = TRUE;
+  best->last_used = pool.frame;
+  pool.in_use += 1;
+  target->target = best->target;
+  target->width = width;
+  target->height = height;
+  return TRUE;
+}
+
+void
+mrb_render_target_release(rf_render_target *target)
+{
+  if (!target->target.id) return;
+  for (mrb_int i = 0; i < pool.count; ++i)
+  {
+    rf_render_target_entry *entry = pool.entries + i;
+    if (entry->target.id != target->target.id || !entry->in_use) continue;
+    entry->in_use = FALSE;
+    entry->last_used = pool.frame;
+    pool.in_use -= 1;
+    break;
+  }
+  *target = (rf_render_target){ 0 };
+}
+
+void
+mrb_render_target_end_frame(mrb_state *mrb)
+{
+  mrb_int i = 0;
+  while (i < pool.count)
+  {
+    rf_render_target_entry *entry = pool.entries + i;
+    if (entry->in_use || pool.frame - entry->last_used < ORGF_TARGET_KEEP_FRAMES)
+    {
+      ++i;
+      continue;
+    }
+    pool.bytes -= target_bytes(entry->target);
+    rf_unload_render_texture(entry->target);
+    pool.entries[i] = pool.entries[pool.count - 1];
+    pool.count -= 1;
+    pool.trims += 1;
+  }
+  pool.frame += 1;
+}
+
+void
+mrb_render_target_pool_clear(mrb_state *mrb)
+{
+  for (mrb_int i = 0; i < pool.count; ++i) rf_unload_render_texture(pool.entries[i].target);
+  mrb_free(mrb, pool.entries);
+  pool.entries = NULL;
+  pool.count = 0;
+  pool.capa = 0;
+  pool.in_use = 0;
+  pool.bytes = 0;
+}
@@ -0,0 +1,306 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <orgf/simd.h>
+#include <orgf/texformat.h>
+
+typedef struct texture_layout texture_layout;
+
+/* Bits and position of red, green, blue and alpha in a 16 bit pixel. */
+struct texture_layout
+{
+  rf_pixel_format pixel_format;
+  int             bits[4];
+  int             shift[4];
+};
+
+static const texture_layout RGB565 = { RF_UNCOMPRESSED_R5G6B5, { 5, 6, 5, 0 }, { 11, 5, 0, 0 } };
+static const texture_layout RGBA5551 = { RF_UNCOMPRESSED_R5G5B5A1, { 5, 5, 5, 1 }, { 11, 6, 1, 0 } };
+static const texture_layout RGBA4444 = { RF_UNCOMPRESSED_R4G4B4A4, { 4, 4, 4, 4 }, { 12, 8, 4, 0 } };
+
+static const unsigned char BAYER[4][4] = {
+  {  0,  8,  2, 10 },
+  { 12,  4, 14,  6 },
+  {  3, 11,  1,  9 },
+  { 15,  7, 13,  5 },
+};
+
+static rf_texture_policy policy = { RF_TEXTURE_RGBA8888, FALSE, NULL, 0, 0 };
+
+rf_texture_policy *
+mrb_get_texture_policy(void)
+{
+  return &policy;
+}
+
+void
+mrb_texture_policy_set(mrb_state *mrb, const char *directory, enum rf_texture_format format)
+{
+  for (mrb_int i = 0; i < policy.rule_count; ++i)
+  {
+    rf_texture_rule *rule = policy.rules + i;
+    if (strcmp(rule->directory, directory)) continue;
+    if (format != RF_TEXTURE_DEFAULT)
+    {
+      rule->format = format;
+      return;
+    }
+    mrb_free(mrb, rule->directory);
+    policy.rules[i] = policy.rules[policy.rule_count - 1];
+    policy.rule_count -= 1;
+    return;
+  }
+  if (format == RF_TEXTURE_DEFAULT) return;
+  if (policy.rule_count >= policy.rule_capa)
+  {
+    mrb_int capa = policy.rule_capa ? policy.rule_capa * 2 : 8;
+    policy.rules = mrb_realloc(mrb, policy.rules, sizeof(*policy.rules) * capa);
+    policy.rule_capa = capa;
+  }
+  size_t len = strlen(directory);
+  rf_texture_rule *rule = policy.rules + policy.rule_count;
+  rule->directory = mrb_malloc(mrb, len + 1);
+  memcpy(rule->directory, directory, len + 1);
+  rule->format = format;
+  policy.rule_count += 1;
+}
+
+void
+mrb_texture_policy_free(mrb_state *mrb)
+{
+  for (mrb_int i = 0; i < policy.rule_count; ++i) mrb_free(mrb, policy.rules[i].directory);
+  mrb_free(mrb, policy.rules);
+  policy.rules = NULL;
+  policy.rule_count = 0;
+  policy.rule_capa = 0;
+}
+
+static enum rf_texture_format
+directory_format(const char *source)
+{
+  size_t best = 0;
+  enum rf_texture_format format = policy.format;
+  if (!source) return format;
+  // The most specific directory wins, so a subfolder can opt out of its parent's rule
+  for (mrb_int i = 0; i < policy.rule_count; ++i)
+  {
+    rf_texture_rule *rule = policy.rules + i;
+    size_t len = strlen(rule->directory);
+    if (len <= best || strncmp(source, rule->directory, len)) continue;
+    if (source[len] != '/' && source[len] != '\\') continue;
+    best = len;
+    format = rule->format;
+  }
+  return format;
+}
+
+static inline mrb_bool
+convertible(rf_image image)
+{
+  if (!image.data) return FALSE;
+  switch (image.format)
+  {
+    case RF_UNCOMPRESSED_GRAYSCALE:
+    case RF_UNCOMPRESSED_GRAY_ALPHA:
+    case RF_UNCOMPRESSED_R8G8B8:
+    case RF_UNCOMPRESSED_R8G8B8A8:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+enum rf_texture_format
+mrb_texture_detect(rf_image image)
+{
+  if (image.format == RF_UNCOMPRESSED_R8G8B8) return RF_TEXTURE_RGB565;
+  // Gray images are already smaller than any 16 bit format
+  if (image.format != RF_UNCOMPRESSED_R8G8B8A8 || !image.data) return RF_TEXTURE_RGBA8888;
+  const unsigned char *pixels = image.data;
+  size_t count = (size_t)image.width * (size_t)image.height;
+  mrb_bool opaque = TRUE;
+  for (size_t i = 0; i < count; ++i)
+  {
+    unsigned char a = pixels[i * 4 + 3];
+    if (a == 255) continue;
+    if (a) return RF_TEXTURE_RGBA8888;
+    opaque = FALSE;
+  }
+  return opaque ? RF_TEXTURE_RGB565 : RF_TEXTURE_RGBA5551;
+}
+
+enum rf_texture_format
+mrb_texture_policy_resolve(enum rf_texture_format format, const char *source, rf_image image)
+{
+  if (format == RF_TEXTURE_DEFAULT) format = directory_format(source);
+  if (!convertible(image)) return RF_TEXTURE_RGBA8888;
+  if (format == RF_TEXTURE_AUTO) format = mrb_texture_detect(image);
+  return format;
+}
+
+static const texture_layout *
+get_layout(enum rf_texture_format format)
+{
+  switch (format)
+  {
+    case RF_TEXTURE_RGB565: return &RGB565;
+    case RF_TEXTURE_RGBA5551: return &RGBA5551;
+    default: return &RGBA4444;
+  }
+}
+
+static void
+expand_row(const unsigned char *ORGF_RESTRICT src, unsigned char *ORGF_RESTRICT dst, int width, int format)
+{
+  for (int x = 0; x < width; ++x)
+  {
+    switch (format)
+    {
+      case RF_UNCOMPRESSED_GRAYSCALE:
+        dst[0] = dst[1] = dst[2] = src[x];
+        dst[3] = 255;
+        break;
+      case RF_UNCOMPRESSED_GRAY_ALPHA:
+        dst[0] = dst[1] = dst[2] = src[x * 2];
+        dst[3] = src[x * 2 + 1];
+        break;
+      default:
+        dst[0] = src[x * 3];
+        dst[1] = src[x * 3 + 1];
+        dst[2] = src[x * 3 + 2];
+        dst[3] = 255;
+        break;
+    }
+    dst += 4;
+  }
+}
+
+/* The threshold added to four consecutive pixels of a row, alpha is left
+   alone so 1 bit alpha stays a clean cut. */
+static void
+row_bias(const texture_layout *layout, int y, unsigned char *bias)
+{
+  for (int x = 0; x < 4; ++x)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      bias[x * 4 + c] = (unsigned char)(BAYER[y & 3][x] * (256 >> layout->bits[c]) / 16);
+    }
+    bias[x * 4 + 3] = 0;
+  }
+}
+
+#ifdef ORGF_SIMD_SSE2
+static inline __m128i
+pack_pixels(__m128i v, const __m128i *down, const __m128i *up)
+{
+  __m128i mask = _mm_set1_epi32(0xFF);
+  __m128i r = _mm_and_si128(v, mask);
+  __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), mask);
+  __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), mask);
+  __m128i a = _mm_srli_epi32(v, 24);
+  __m128i result = _mm_sll_epi32(_mm_srl_epi32(r, down[0]), up[0]);
+  result = _mm_or_si128(result, _mm_sll_epi32(_mm_srl_epi32(g, down[1]), up[1]));
+  result = _mm_or_si128(result, _mm_sll_epi32(_mm_srl_epi32(b, down[2]), up[2]));
+  result = _mm_or_si128(result, _mm_sll_epi32(_mm_srl_epi32(a, down[3]), up[3]));
+  // Sign extend the low half so the saturating pack keeps every bit
+  return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+}
+#endif
+
+static void
+convert_row(const unsigned char *ORGF_RESTRICT src, uint16_t *ORGF_RESTRICT dst, int width,
+            const texture_layout *layout, const unsigned char *bias)
+{
+  int x = 0;
+#ifdef ORGF_SIMD_SSE2
+  __m128i down[4], up[4];
+  for (int c = 0; c < 4; ++c)
+  {
+    down[c] = _mm_cvtsi32_si128(8 - layout->bits[c]);
+    up[c] = _mm_cvtsi32_si128(layout->shift[c]);
+  }
+  __m128i vbias = bias ? _mm_loadu_si128((const __m128i *)bias) : _mm_setzero_si128();
+  for (; x + 8 <= width; x += 8)
+  {
+    __m128i lo = _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + x * 4)), vbias);
+    __m128i hi = _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + x * 4 + 16)), vbias);
+    __m128i packed = _mm_packs_epi32(pack_pixels(lo, down, up), pack_pixels(hi, down, up));
+    _mm_storeu_si128((__m128i *)(dst + x), packed);
+  }
+#endif
+  for (; x < width; ++x)
+  {
+    uint16_t pixel = 0;
+    for (int c = 0; c < 4; ++c)
+    {
+      int value = src[x * 4 + c] + (bias ? bias[(x & 3) * 4 + c] : 0);
+      if (value > 255) value = 255;
+      pixel |= (uint16_t)((value >> (8 - layout->bits[c])) << layout->shift[c]);
+    }
+    dst[x] = pixel;
+  }
+}
+
+rf_image
+mrb_texture_convert(mrb_state *mrb, rf_image image, enum rf_texture_format format)
+{
+  const texture_layout *layout = get_layout(format);
+  int width = image.width;
+  int height = image.height;
+  int bpp = mrb_pixel_bytes(image.format);
+  uint16_t *pixels = mrb_malloc(mrb, (size_t)width * (size_t)height * sizeof *pixels);
+  unsigned char *row = NULL;
+  if (image.format != RF_UNCOMPRESSED_R8G8B8A8) row = mrb_malloc(mrb, (size_t)width * 4);
+  unsigned char bias[16];
+  for (int y = 0; y < height; ++y)
+  {
+    const unsigned char *src = (const unsigned char *)image.data + (size_t)y * (size_t)width * (size_t)bpp;
+    if (row)
+    {
+      expand_row(src, row, width, image.format);
+      src = row;
+    }
+    if (policy.dither) row_bias(layout, y, bias);
+    convert_row(src, pixels + (size_t)y * (size_t)width, width, layout, policy.dither ? bias : NULL);
+  }
+  if (row) mrb_free(mrb, row);
+  rf_image result = image;
+  result.data = pixels;
+  result.format = layout->pixel_format;
+  result.valid = true;
+  return result;
+}
+
+enum rf_texture_format
+mrb_get_texture_format(mrb_state *mrb, mrb_value value)
+{
+  if (mrb_nil_p(value)) return RF_TEXTURE_DEFAULT;
+  if (!mrb_symbol_p(value)) mrb_raise(mrb, E_ARGUMENT_ERROR, "Texture format must be a Symbol");
+  mrb_sym format = mrb_symbol(value);
+  if (format == mrb_intern_lit(mrb, "default")) return RF_TEXTURE_DEFAULT;
+  if (format == mrb_intern_lit(mrb, "auto")) return RF_TEXTURE_AUTO;
+  if (format == mrb_intern_lit(mrb, "rgba8888")) return RF_TEXTURE_RGBA8888;
+  if (format == mrb_intern_lit(mrb, "rgb565")) return RF_TEXTURE_RGB565;
+  if (format == mrb_intern_lit(mrb, "rgba5551")) return RF_TEXTURE_RGBA5551;
+  if (format == mrb_intern_lit(mrb, "rgba4444")) return RF_TEXTURE_RGBA4444;
+  mrb_raise(mrb, E_ARGUMENT_ERROR, "Texture format must be :default, :auto, :rgba8888, :rgb565, :rgba5551 or :rgba4444");
+  return RF_TEXTURE_DEFAULT;
+}
+
+mrb_value
+mrb_texture_format_value(mrb_state *mrb, enum rf_texture_format format)
+{
+  switch (format)
+  {
+    case RF_TEXTURE_AUTO: return mrb_symbol_value(mrb_intern_lit(mrb, "auto"));
+    case RF_TEXTURE_RGBA8888: return mrb_symbol_value(mrb_intern_lit(mrb, "rgba8888"));
+    case RF_TEXTURE_RGB565: return mrb_symbol_value(mrb_intern_lit(mrb, "rgb565"));
+    case RF_TEXTURE_RGBA5551: return mrb_symbol_value(mrb_intern_lit(mrb, "rgba5551"));
+    case RF_TEXTURE_RGBA4444: return mrb_symbol_value(mrb_intern_lit(mrb, "rgba4444"));
+    default: return mrb_symbol_value(mrb_intern_lit(mrb, "default"));
+  }
+}
@@ -0,0 +1,252 @@
+#include <mruby.h>
+
+#include <rayfork.h>
+#include <string.h>
+
+#include <orgf/blend.h>
+#include <orgf/disposal.h>
+#include <orgf/stats.h>
+#include <orgf/texformat.h>
+#include <orgf/tiles.h>
+
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#ifndef GL_MAX_TEXTURE_SIZE
+#define GL_MAX_TEXTURE_SIZE 0x0D33
+#endif
+
+static rf_tile_cache cache = { NULL, ORGF_TILE_BUDGET, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static inline size_t
+tile_bytes(rf_texture2d texture)
+{
+  return (size_t)texture.width * (size_t)texture.height * (size_t)mrb_pixel_bytes(texture.format);
+}
+
+rf_tile_cache *
+mrb_get_tile_cache(void)
+{
+  return &cache;
+}
+
+int
+mrb_get_max_texture_size(void)
+{
+  if (!cache.gl_max_size)
+  {
+    int size = 0;
+    rf_gl.GetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+    // Every GL version this runs on guarantees at least 2048
+    cache.gl_max_size = size >= 2048 ? size : 2048;
+  }
+  if (cache.max_size > 0 && cache.max_size < cache.gl_max_size) return cache.max_size;
+  return cache.gl_max_size;
+}
+
+rf_tiled_texture *
+mrb_tiled_texture_new(mrb_state *mrb, int width, int height)
+{
+  rf_tiled_texture *tiles = mrb_malloc(mrb, sizeof *tiles);
+  int max_size = mrb_get_max_texture_size();
+  // The gutter comes out of the tile, so full tiles keep a power of two texture
+  tiles->tile_size = (ORGF_TILE_SIZE < max_size ? ORGF_TILE_SIZE : max_size) - ORGF_TILE_GUTTER * 2;
+  tiles->columns = (width + tiles->tile_size - 1) / tiles->tile_size;
+  tiles->rows = (height + tiles->tile_size - 1) / tiles->tile_size;
+  size_t count = (size_t)tiles->columns * (size_t)tiles->rows;
+  tiles->tiles = mrb_malloc(mrb, (count ? count : 1) * sizeof *tiles->tiles);
+  memset(tiles->tiles, 0, count * sizeof *tiles->tiles);
+  tiles->prev = NULL;
+  tiles->next = cache.head;
+  if (cache.head) cache.head->prev = tiles;
+  cache.head = tiles;
+  cache.textures += 1;
+  return tiles;
+}
+
+static void
+unload_tile(rf_texture_tile *tile)
+{
+  if (!tile->texture.id) return;
+  cache.bytes -= tile_bytes(tile->texture);
+  cache.resident -= 1;
+  rf_unload_texture(tile->texture);
+  tile->texture = (rf_texture2d){ 0 };
+}
+
+void
+mrb_tiled_texture_invalidate(rf_tiled_texture *tiles)
+{
+  mrb_int count = (mrb_int)tiles->columns * tiles->rows;
+  for (mrb_int i = 0; i < count; ++i) unload_tile(tiles->tiles + i);
+}
+
+void
+mrb_tiled_texture_free(mrb_state *mrb, rf_tiled_texture *tiles)
+{
+  if (!tiles) return;
+  mrb_int count = (mrb_int)tiles->columns * tiles->rows;
+  for (mrb_int i = 0; i < count; ++i)
+  {
+    // Freed by the bitmap's finalizer, the textures go once the frame ends
+    rf_texture_tile *tile = tiles->tiles + i;
+    if (!tile->texture.id) continue;
+    cache.bytes -= tile_bytes(tile->texture);
+    cache.resident -= 1;
+    mrb_dispose_texture(mrb, tile->texture, tile_bytes(tile->texture));
+  }
+  if (tiles->prev) tiles->prev->next = tiles->next;
+  else cache.head = tiles->next;
+  if (tiles->next) tiles->next->prev = tiles->prev;
+  cache.textures -= 1;
+  mrb_free(mrb, tiles->tiles);
+  mrb_free(mrb, tiles);
+}
+
+static mrb_bool
+evict_oldest(void)
+{
+  rf_texture_tile *oldest = NULL;
+  for (rf_tiled_texture *tiles = cache.head; tiles; tiles = tiles->next)
+  {
+    mrb_int count = (mrb_int)tiles->columns * tiles->rows;
+    for (mrb_int i = 0; i < count; ++i)
+    {
+      rf_texture_tile *tile = tiles->tiles + i;
+      // Tiles of this frame are already queued for drawing
+      if (!tile->texture.id || tile->last_used >= cache.frame) continue;
+      if (!oldest || tile->last_used < oldest->last_used) oldest = tile;
+    }
+  }
+  if (!oldest) return FALSE;
+  unload_tile(oldest);
+  cache.evictions += 1;
+  return TRUE;
+}
+
+static rf_texture2d
+load_tile(mrb_state *mrb, rf_tiled_texture *tiles, rf_image *image, int column, int row)
+{
+  rf_texture_tile *tile = tiles->tiles + (size_t)row * tiles->columns + column;
+  tile->last_used = cache.frame;
+  if (tile->texture.id) return tile->texture;
+  uint64_t start = ORGF_STATS_NOW();
+  int x = column * tiles->tile_size;
+  int y = row * tiles->tile_size;
+  int w = image->width - x < tiles->tile_size ? image->width - x : tiles->tile_size;
+  int h = image->height - y < tiles->tile_size ? image->height - y : tiles->tile_size;
+  size_t bpp = (size_t)mrb_pixel_bytes(image->format);
+  int g = ORGF_TILE_GUTTER;
+  int tw = w + g * 2, th = h + g * 2;
+  unsigned char *pixels = mrb_malloc(mrb, (size_t)tw * (size_t)th * bpp);
+  const unsigned char *src = image->data;
+  // The gutter repeats the neighbouring pixels, or the edge ones at the image's border
+  for (int j = 0; j < th; ++j)
+  {
+    int sy = y + j - g;
+    if (sy < 0) sy = 0;
+    if (sy >= image->height) sy = image->height - 1;
+    const unsigned char *row = src + (size_t)sy * image->width * bpp;
+    unsigned char *out = pixels + (size_t)j * tw * bpp;
+    for (int i = 0; i < g; ++i)
+    {
+      int left = x - g + i > 0 ? x - g + i : 0;
+      int right = x + w + i < image->width ? x + w + i : image->width - 1;
+      memcpy(out + (size_t)i * bpp, row + (size_t)left * bpp, bpp);
+      memcpy(out + (size_t)(g + w + i) * bpp, row + (size_t)right * bpp, bpp);
+    }
+    memcpy(out + (size_t)g * bpp, row + (size_t)x * bpp, (size_t)w * bpp);
+  }
+  rf_image region = *image;
+  region.data = pixels;
+  region.width = tw;
+  region.height = th;
+  if (mrb_get_premultiplied_alpha()) mrb_premultiply_image(&region);
+  tile->texture = rf_load_texture_from_image(region);
+  mrb_free(mrb, pixels);
+  cache.bytes += tile_bytes(tile->texture);
+  cache.resident += 1;
+  cache.uploads += 1;
+  while (cache.bytes > cache.budget && evict_oldest());
+  ORGF_STATS_ADD(uploads, 1);
+  ORGF_STATS_ADD(upload_time, ORGF_STATS_NOW() - start);
+  return tile->texture;
+}
+
+static inline mrb_bool
+outside(float x0, float y0, float x1, float y1, const rf_rec *clip)
+{
+  if (!clip) return FALSE;
+  return x1 <= clip->x || y1 <= clip->y || x0 >= clip->x + clip->width || y0 >= clip->y + clip->height;
+}
+
+void
+mrb_tiled_texture_draw(mrb_state *mrb, rf_tiled_texture *tiles, rf_image *image, rf_rec src, rf_rec dst,
+                       mrb_bool flip_x, mrb_bool flip_y, const rf_rec *clip, rf_color color)
+{
+  if (!image->data || src.width <= 0 || src.height <= 0) return;
+  float sx = dst.width / src.width;
+  float sy = dst.height / src.height;
+  float left = src.x > 0 ? src.x : 0;
+  float top = src.y > 0 ? src.y : 0;
+  float right = src.x + src.width < image->width ? src.x + src.width : image->width;
+  float bottom = src.y + src.height < image->height ? src.y + src.height : image->height;
+  if (left >= right || top >= bottom) return;
+  int size = tiles->tile_size;
+  for (int row = (int)top / size; row * size < bottom && row < tiles->rows; ++row)
+  {
+    float ty0 = (float)(row * size) > top ? (float)(row * size) : top;
+    float ty1 = (float)((row + 1) * size) < bottom ? (float)((row + 1) * size) : bottom;
+    float qy0 = flip_y ? src.y + src.height - ty1 : ty0 - src.y;
+    float qy1 = flip_y ? src.y + src.height - ty0 : ty1 - src.y;
+    qy0 = dst.y + qy0 * sy;
+    qy1 = dst.y + qy1 * sy;
+    for (int column = (int)left / size; column * size < right && column < tiles->columns; ++column)
+    {
+      float tx0 = (float)(column * size) > left ? (float)(column * size) : left;
+      float tx1 = (float)((column + 1) * size) < right ? (float)((column + 1) * size) : right;
+      float qx0 = flip_x ? src.x + src.width - tx1 : tx0 - src.x;
+      float qx1 = flip_x ? src.x + src.width - tx0 : tx1 - src.x;
+      qx0 = dst.x + qx0 * sx;
+      qx1 = dst.x + qx1 * sx;
+      if (outside(qx0, qy0, qx1, qy1, clip)) continue;
+      rf_texture2d texture = load_tile(mrb, tiles, image, column, row);
+      if (!texture.id) continue;
+      float u0 = (tx0 - column * size + ORGF_TILE_GUTTER) / texture.width;
+      float u1 = (tx1 - column * size + ORGF_TILE_GUTTER) / texture.width;
+      float v0 = (ty0 - row * size + ORGF_TILE_GUTTER) / texture.height;
+      float v1 = (ty1 - row * size + ORGF_TILE_GUTTER) / texture.height;
+      if (flip_x) { float t = u0; u0 = u1; u1 = t; }
+      if (flip_y) { float t = v0; v0 = v1; v1 = t; }
+      rf_gfx_enable_texture(texture.id);
+      rf_gfx_begin(RF_QUADS);
+        rf_gfx_color4ub(color.r, color.g, color.b, color.a);
+        rf_gfx_tex_coord2f(u0, v0);
+        rf_gfx_vertex2f(qx0, qy0);
+        rf_gfx_tex_coord2f(u0, v1);
+        rf_gfx_vertex2f(qx0, qy1);
+        rf_gfx_tex_coord2f(u1, v1);
+        rf_gfx_vertex2f(qx1, qy1);
+        rf_gfx_tex_coord2f(u1, v0);
+        rf_gfx_vertex2f(qx1, qy0);
+      rf_gfx_end();
+    }
+  }
+  rf_gfx_disable_texture();
+}
+
+void
+mrb_tiled_texture_end_frame(mrb_state *mrb)
+{
+  for (rf_tiled_texture *tiles = cache.head; tiles; tiles = tiles->next)
+  {
+    mrb_int count = (mrb_int)tiles->columns * tiles->rows;
+    for (mrb_int i = 0; i < count; ++i)
+    {
+      rf_texture_tile *tile = tiles->tiles + i;
+      if (!tile->texture.id || cache.frame - tile->last_used < ORGF_TILE_KEEP_FRAMES) continue;
+      unload_tile(tile);
+      cache.evictions += 1;
+    }
+  }
+  cache.frame += 1;
+}
@@ -5,6 +5,7 @@
 
 #include <rayfork.h>
 
+#include <orgf/blend.h>
 #include <orgf/point.h>
 #include <orgf/color.h>
 #include <orgf/drawable.h>
@@ -17,13 +18,19 @@
 #define TONE mrb_intern_lit(mrb, "#tone")
 #define OFFSET mrb_intern_lit(mrb, "#offset")
 
+#define rf_gl (rf_get_context()->gfx_ctx.gl)
+
+#ifndef GL_SCISSOR_TEST
+#define GL_SCISSOR_TEST 0x0C11
+#endif
+
 static void
 free_viewport(mrb_state *mrb, void *p)
 {
   if (p)
   {
     rf_viewport *vp = p;
-    rf_unload_render_texture(vp->render);
+    mrb_render_target_release(&(vp->render));
     mrb_container_free(mrb, p);
     mrb_free(mrb, p);
   }
@@ -33,7 +40,7 @@ const struct mrb_data_type mrb_viewport_data_type = { "Viewport", free_viewport
 
 static struct
 {
-  int flash_color, tone;
+  int flash_color, tone, premultiplied;
 } shader_locations;
 
 static rf_shader viewport_shader;
@@ -57,6 +64,7 @@ static const char * frag =
 "uniform vec4 col_diffuse;"
 "uniform vec4 flash_color;"
 "uniform vec4 tone;"
+"uniform float premultiplied;"
 "void main()"
 "{"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
@@ -66,16 +74,18 @@ static const char * frag =
 #endif
 "    float a = 1 - flash_color.a;"
 "    float ta = 1 - tone.a;"
-"    texel_color.r = texel_color.r + tone.r;"
-"    texel_color.g = texel_color.g + tone.g;"
-"    texel_color.b = texel_color.b + tone.b;"
+"    float pa = mix(1.0, texel_color.a, premultiplied);" // Premultiplied texels scale the colors added to them
+"    texel_color.r = texel_color.r + tone.r * pa;"
+"    texel_color.g = texel_color.g + tone.g * pa;"
+"    texel_color.b = texel_color.b + tone.b * pa;"
 "    float gray = (0.3 * texel_color.r) + (0.59 * texel_color.g) + (0.11 * texel_color.b);"
-"    texel_color.r = texel_color.r * a + flash_color.r * flash_color.a;"
-"    texel_color.g = texel_color.g * a + flash_color.g * flash_color.a;"
-"    texel_color.b = texel_color.b * a + flash_color.b * flash_color.a;"
+"    texel_color.r = texel_color.r * a + flash_color.r * flash_color.a * pa;"
+"    texel_color.g = texel_color.g * a + flash_color.g * flash_color.a * pa;"
+"    texel_color.b = texel_color.b * a + flash_color.b * flash_color.a * pa;"
 "    texel_color.r = texel_color.r * ta + gray * tone.a;"
 "    texel_color.g = texel_color.g * ta + gray * tone.a;"
 "    texel_color.b = texel_color.b * ta + gray * tone.a;"
+"    if (premultiplied > 0.5) texel_color.rgb = clamp(texel_color.rgb, 0.0, texel_color.a);"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
 "    frag_color = texel_color*col_diffuse*frag_color;"
 #elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
@@ -91,6 +101,7 @@ init_shader(mrb_state *mrb)
   viewport_shader = rf_gfx_load_shader(NULL, frag);
   shader_locations.flash_color = rf_gfx_get_shader_location(viewport_shader, "flash_color");
   shader_locations.tone = rf_gfx_get_shader_location(viewport_shader, "tone");
+  shader_locations.premultiplied = rf_gfx_get_shader_location(viewport_shader, "premultiplied");
   shader_ready = TRUE;
 }
 
@@ -109,42 +120,84 @@ bind_shader(rf_viewport *view)
     (float)view->tone->b / 255.f,
     (float)view->tone->a / 255.f
   };
+  float premultiplied = mrb_get_premultiplied_alpha() ? 1.0f : 0.0f;
   rf_gfx_set_shader_value(viewport_shader, shader_locations.flash_color, rgba, RF_UNIFORM_VEC4);
   rf_gfx_set_shader_value(viewport_shader, shader_locations.tone, tone, RF_UNIFORM_VEC4);
+  rf_gfx_set_shader_value(viewport_shader, shader_locations.premultiplied, &premultiplied, RF_UNIFORM_FLOAT);
 }
 
-static const float corners[4][2] = {
-  // Bottom-left corner for texture and quad
-  { 0, 1 },
-  // Bottom-right corner for texture and quad
-  { 0, 0 },
-  // Top-right corner for texture and quad
-  { 1, 0 },
-  // Top-left corner for texture and quad
-  { 1, 1 }          
-};
+/* Tone, flash and a color other than white are applied by the composite
+   shader, without them the children can be drawn straight into the screen. */
+static inline mrb_bool
+needs_pass(rf_viewport *viewport)
+{
+  rf_tone *tone = viewport->tone;
+  rf_color *color = viewport->color;
+  if (tone->r || tone->g || tone->b || tone->a) return TRUE;
+  if (viewport->flash_color.a) return TRUE;
+  return color->r != 255 || color->g != 255 || color->b != 255 || color->a != 255;
+}
 
 static void
 rf_viewport_update(mrb_state *mrb, rf_viewport *viewport)
 {
   int w = (int)viewport->rect->width;
   int h = (int)viewport->rect->height;
-  if (viewport->render.texture.width != w || viewport->render.texture.height != h)
-  {
-    rf_unload_render_texture(viewport->render);
-    viewport->render = rf_load_render_texture(w, h);
-  }
+  // Normally released once drawn, this catches frames where it wasn't
+  mrb_render_target_release(&(viewport->render));
+  // At a lower resolution the pass shrinks too, drawing it back stretches it
+  rf_resolution *resolution = mrb_get_graphics_resolution(mrb);
+  float scale = resolution->scale;
+  if (w > 0 && h > 0) mrb_resolution_region(resolution, w, h, &w, &h);
   rf_camera2d cam;
-  cam.offset = *(viewport->offset);
+  cam.offset = (rf_vec2){ viewport->offset->x * scale, viewport->offset->y * scale };
+  cam.target = (rf_vec2){ 0, 0 };
   cam.rotation = 0;
-  cam.zoom = 1;
+  cam.zoom = scale;
   mrb_container_update(mrb, &(viewport->base));
-  rf_begin_render_to_texture(viewport->render);
+  viewport->direct = !needs_pass(viewport);
+  if (viewport->direct)
+  {
+    ORGF_STATS_ADD(direct_viewports, 1);
+    return;
+  }
+  if (!mrb_render_target_acquire(mrb, &(viewport->render), w, h, FALSE)) return;
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
+  rf_begin_render_to_texture(viewport->render.target);
+  ORGF_STATS_SETTLE();
     rf_clear(RF_BLANK);
     rf_begin_2d(cam);
       mrb_container_draw_children(mrb, &(viewport->base));
     rf_end_2d();
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
   rf_end_render_to_texture();
+  ORGF_STATS_SETTLE();
+}
+
+static void
+draw_direct(mrb_state *mrb, rf_viewport *viewport, int x, int y, int w, int h)
+{
+  if (w <= 0 || h <= 0) return;
+  rf_sizef size = mrb_get_graphics_size(mrb);
+  float scale = mrb_get_graphics_resolution(mrb)->scale;
+  rf_camera2d cam;
+  cam.offset = (rf_vec2){ x + viewport->offset->x, y + viewport->offset->y };
+  cam.target = (rf_vec2){ 0, 0 };
+  cam.rotation = 0;
+  cam.zoom = 1;
+  // Both begin and end flush, so the scissor covers exactly the children
+  ORGF_STATS_FLUSH(RF_FLUSH_SCISSOR);
+  rf_begin_2d(cam);
+  ORGF_STATS_SETTLE();
+    rf_gl.Enable(GL_SCISSOR_TEST);
+    // The scissor is in pixels of the screen's target, which shrinks with the resolution
+    rf_gl.Scissor((int)(x * scale + 0.5f), (int)size.height - (int)((y + h) * scale + 0.5f),
+                  (int)(w * scale + 0.5f), (int)(h * scale + 0.5f));
+    mrb_container_draw_children(mrb, &(viewport->base));
+  ORGF_STATS_FLUSH(RF_FLUSH_SCISSOR);
+  rf_end_2d();
+  ORGF_STATS_SETTLE();
+  rf_gl.Disable(GL_SCISSOR_TEST);
 }
 
 static void
@@ -154,34 +207,43 @@ rf_viewport_draw(mrb_state *mrb, rf_viewport *viewport)
   int y = (int)viewport->rect->y;
   int w = (int)viewport->rect->width;
   int h = (int)viewport->rect->height;
-  if (!w || !h) return;
+  if (viewport->direct)
+  {
+    draw_direct(mrb, viewport, x, y, w, h);
+    return;
+  }
+  if (!viewport->render.target.id) return;
 
-  rf_color color = *(viewport->color);
-  rf_gfx_enable_texture(viewport->render.texture.id);
+  float u, v;
+  mrb_render_target_uv(&(viewport->render), &u, &v);
+  rf_color color = mrb_blend_color(*(viewport->color), RF_BLEND_ALPHA);
+  rf_gfx_enable_texture(viewport->render.target.texture.id);
   rf_gfx_push_matrix();
-    rf_begin_blend_mode(RF_BLEND_ALPHA);
+    ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+    mrb_begin_blend_mode(RF_BLEND_ALPHA);
     rf_gfx_translatef(x, y, 0);
     rf_begin_shader(viewport_shader);
     bind_shader(viewport);
     rf_gfx_begin(RF_QUADS);
       rf_gfx_color4ub(color.r, color.g, color.b, color.a);
-      // Bottom-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[0][0], corners[0][1]);
+      // Only the corner of the target the viewport was drawn into
+      rf_gfx_tex_coord2f(0.0f, 1.0f);
       rf_gfx_vertex2f(0.0f, 0.0f);
-      // Bottom-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[1][0], corners[1][1]);
+      rf_gfx_tex_coord2f(0.0f, v);
       rf_gfx_vertex2f(0.0f, h);
-      // Top-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[2][0], corners[2][1]);
+      rf_gfx_tex_coord2f(u, v);
       rf_gfx_vertex2f(w, h);
-      // Top-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[3][0], corners[3][1]);
+      rf_gfx_tex_coord2f(u, 1.0f);
       rf_gfx_vertex2f(w, 0.0f);
     rf_gfx_end();
+    ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
     rf_end_shader();
-    rf_end_blend_mode();
+    ORGF_STATS_SETTLE();
+    mrb_end_blend_mode();
   rf_gfx_pop_matrix();
   rf_gfx_disable_texture();
+  // Reusing it later in the frame is safe, binding it as a target flushes this quad first
+  mrb_render_target_release(&(viewport->render));
 }
 
 static mrb_value
@@ -196,6 +258,11 @@ mrb_viewport_initialize(mrb_state *mrb, mrb_value self)
   DATA_TYPE(self) = &mrb_viewport_data_type;
   DATA_PTR(self) = data;
   mrb_container_init(mrb, &(data->base));
+  data->render = (rf_render_target){ 0 };
+  data->direct = FALSE;
+  data->flash_color = (rf_color){ 0, 0, 0, 0 };
+  data->flash_time = 0;
+  data->total_flash_time = 0;
   data->base.base.visible = TRUE;
   data->base.base.update = (rf_drawable_update_callback)rf_viewport_update;
   data->base.base.draw   = (rf_drawable_draw_callback)rf_viewport_draw;
@@ -217,7 +284,6 @@ mrb_viewport_initialize(mrb_state *mrb, mrb_value self)
       rf_sizef size = mrb_get_graphics_size(mrb);
       mrb_value rect = mrb_rect_new(mrb, 0, 0, size.width, size.height);
       mrb_iv_set(mrb, self, RECT, rect);
-      data->render = rf_load_render_texture((int)size.width, (int)size.height);
       data->rect = mrb_get_rect(mrb, rect);
       break;
     }
@@ -235,7 +301,6 @@ mrb_viewport_initialize(mrb_state *mrb, mrb_value self)
       mrb_float x, y, w, h;
       mrb_get_args(mrb, "ffff", &x, &y, &w, &h);
       mrb_value rect = mrb_rect_new(mrb, x, y, w, h);
-      data->render = rf_load_render_texture((int)w, (int)h);
       mrb_iv_set(mrb, self, RECT, rect);
       data->rect = mrb_get_rect(mrb, rect);
       break;
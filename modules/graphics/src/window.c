@@ -5,6 +5,7 @@
 
 #include <rayfork.h>
 
+#include <orgf/blend.h>
 #include <orgf/drawable.h>
 #include <orgf/point.h>
 #include <orgf/rect.h>
@@ -20,7 +21,7 @@ free_window(mrb_state *mrb, void *p)
   if (p)
   {
     rf_window *window = p;
-    rf_unload_render_texture(window->render);
+    mrb_render_target_release(&(window->render));
     mrb_container_remove_child(mrb, window->base.container, p);
     mrb_free(mrb, p);
   }
@@ -54,9 +55,9 @@ draw_cursor(rf_window *window)
   int w = window->cursor_rect->width;
   int h = window->cursor_rect->height;
   if (w <= 0 || h <= 0) return;
-  rf_color color = (rf_color){
+  rf_color color = mrb_blend_color((rf_color){
     255, 255, 255, (unsigned char)(window->opacity * window->cursor_opacity / 255)
-  };
+  }, RF_BLEND_ALPHA);
   rf_rec dst = *(window->cursor_rect);
   dst.x += window->padding.left - window->skin_rects.border_left - window->offset->x;
   dst.y += window->padding.top - window->skin_rects.border_top - window->offset->y;
@@ -66,17 +67,6 @@ draw_cursor(rf_window *window)
   );
 }
 
-static const float corners[4][2] = {
-  // Bottom-left corner for texture and quad
-  { 0, 1 },
-  // Bottom-right corner for texture and quad
-  { 0, 0 },
-  // Top-right corner for texture and quad
-  { 1, 0 },
-  // Top-left corner for texture and quad
-  { 1, 1 }          
-};
-
 static const char * frag =
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
 "#version 100\n"
@@ -93,6 +83,7 @@ static const char * frag =
 "uniform sampler2D texture0;"
 "uniform vec4 col_diffuse;"
 "uniform vec4 tone;"
+"uniform float premultiplied;"
 "void main()"
 "{"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
@@ -101,13 +92,15 @@ static const char * frag =
 "    vec4 texel_color = texture(texture0, frag_tex_coord);"
 #endif
 "    float ta = 1 - tone.a;"
-"    texel_color.r = texel_color.r + tone.r;"
-"    texel_color.g = texel_color.g + tone.g;"
-"    texel_color.b = texel_color.b + tone.b;"
+"    float pa = mix(1.0, texel_color.a, premultiplied);" // Premultiplied texels scale the colors added to them
+"    texel_color.r = texel_color.r + tone.r * pa;"
+"    texel_color.g = texel_color.g + tone.g * pa;"
+"    texel_color.b = texel_color.b + tone.b * pa;"
 "    float gray = (0.3 * texel_color.r) + (0.59 * texel_color.g) + (0.11 * texel_color.b);"
 "    texel_color.r = texel_color.r * ta + gray * tone.a;"
 "    texel_color.g = texel_color.g * ta + gray * tone.a;"
 "    texel_color.b = texel_color.b * ta + gray * tone.a;"
+"    if (premultiplied > 0.5) texel_color.rgb = clamp(texel_color.rgb, 0.0, texel_color.a);"
 #if defined(RAYFORK_GRAPHICS_BACKEND_GL_ES3)
 "    frag_color = texel_color*col_diffuse*frag_color;"
 #elif defined(RAYFORK_GRAPHICS_BACKEND_GL_33)
@@ -120,7 +113,7 @@ rf_shader window_shader;
 mrb_bool shader_ready = FALSE;
 struct
 {
-  int tone;
+  int tone, premultiplied;
 } shader_locations;
 
 static void
@@ -128,6 +121,7 @@ init_shader(mrb_state *mrb)
 {
   window_shader = rf_gfx_load_shader(NULL, frag);
   shader_locations.tone = rf_gfx_get_shader_location(window_shader, "tone");
+  shader_locations.premultiplied = rf_gfx_get_shader_location(window_shader, "premultiplied");
   shader_ready = TRUE;
 }
 
@@ -140,26 +134,32 @@ bind_shader(rf_window *window)
     (float)window->tone->b / 255.f,
     (float)window->tone->a / 255.f
   };
+  float premultiplied = mrb_get_premultiplied_alpha() ? 1.0f : 0.0f;
   rf_gfx_set_shader_value(window_shader, shader_locations.tone, tone, RF_UNIFORM_VEC4);
+  rf_gfx_set_shader_value(window_shader, shader_locations.premultiplied, &premultiplied, RF_UNIFORM_FLOAT);
 }
 
 static inline void
-draw_window_background(rf_window *window, int w, int h)
+draw_window_background(mrb_state *mrb, rf_window *window, int w, int h)
 {
   if (!window->skin) return;
-  rf_color color = (rf_color){
+  rf_color color = mrb_blend_color((rf_color){
     255, 255, 255, (unsigned char)(window->opacity * window->back_opacity / 255)
-  };
+  }, RF_BLEND_ALPHA);
   rf_vec2 origin = *(window->offset);
   rf_rec src = window->skin_rects.backgrounds[0];
   rf_rec dst = (rf_rec){0, 0, w, h};
 
-  mrb_refresh_bitmap(window->skin);
+  mrb_refresh_bitmap(mrb, window->skin);
   rf_texture2d texture = window->skin->texture;
+  ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
   rf_begin_shader(window_shader);
+  ORGF_STATS_SETTLE();
     bind_shader(window);        
     rf_draw_texture_region(texture, src, dst, (rf_vec2){0, 0}, 0, color);
+  ORGF_STATS_FLUSH(RF_FLUSH_SHADER);
   rf_end_shader();
+  ORGF_STATS_SETTLE();
   src = window->skin_rects.backgrounds[1];
   int tx = w / src.width  + 1;
   int ty = h / src.height + 1;
@@ -174,12 +174,12 @@ draw_window_background(rf_window *window, int w, int h)
 }
 
 static inline void
-draw_window_contents(rf_window *window)
+draw_window_contents(mrb_state *mrb, rf_window *window)
 {
   if (!window->contents) return;
 
-  mrb_refresh_bitmap(window->contents);
-  rf_color color = (rf_color){255, 255, 255, (unsigned char)(window->opacity * window->contents_opacity / 255)};
+  mrb_refresh_bitmap(mrb, window->contents);
+  rf_color color = mrb_blend_color((rf_color){255, 255, 255, (unsigned char)(window->opacity * window->contents_opacity / 255)}, RF_BLEND_ALPHA);
   int w2 = window->contents->texture.width - window->offset->x;
   int h2 = window->contents->texture.height - window->offset->y;
   int b = window->rect->width - window->padding.left - window->padding.right;
@@ -204,22 +204,23 @@ update_window(mrb_state *mrb, rf_window *window)
   int py = window->skin_rects.border_top;
   int w = window->rect->width - px * 2;
   int h = window->rect->height - py * 2;
-  if (w != window->render.texture.width || h != window->render.texture.height)
-  {
-    rf_unload_render_texture(window->render);
-    window->render.id = 0;
-    if (w && h) window->render = rf_load_render_texture(w, h);
-  }
+  // Normally released once drawn, this catches frames where it wasn't
+  mrb_render_target_release(&(window->render));
+  if (!mrb_render_target_acquire(mrb, &(window->render), w, h, FALSE)) return;
 
   rf_gfx_push_matrix();
-  rf_begin_render_to_texture(window->render);
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
+  rf_begin_render_to_texture(window->render.target);
+  ORGF_STATS_SETTLE();
     rf_clear(RF_BLANK);
-    rf_begin_blend_mode(RF_BLEND_ALPHA);
-      draw_window_background(window, w, h);
-      draw_window_contents(window);
+    mrb_begin_blend_mode(RF_BLEND_ALPHA);
+      draw_window_background(mrb, window, w, h);
+      draw_window_contents(mrb, window);
       draw_cursor(window);
-    rf_end_blend_mode();
+    mrb_end_blend_mode();
+  ORGF_STATS_FLUSH(RF_FLUSH_TARGET);
   rf_end_render_to_texture();
+  ORGF_STATS_SETTLE();
   rf_gfx_pop_matrix();
 }
 
@@ -231,30 +232,31 @@ draw_contents(rf_window *window)
   if (w <= 0 || h <= 0) return;
   int x = window->skin_rects.border_top;
   int y = window->skin_rects.border_left;
-  w = window->render.texture.width;
-  h = window->render.texture.height;
-  rf_gfx_enable_texture(window->render.texture.id);
+  if (!window->render.target.id) return;
+  w = window->render.width;
+  h = window->render.height;
+  float u, v;
+  mrb_render_target_uv(&(window->render), &u, &v);
+  rf_gfx_enable_texture(window->render.target.texture.id);
   rf_gfx_push_matrix();
     rf_gfx_translatef(x, y + h / 2, 0);
     rf_gfx_scalef(1, ((float)window->openness / 255.0f), 1);
     rf_gfx_translatef(0, -h / 2, 0);
     rf_gfx_begin(RF_QUADS);
       rf_gfx_color4ub(255, 255, 255, 255);
-      // Bottom-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[0][0], corners[0][1]);
+      // Only the corner of the target the contents were drawn into
+      rf_gfx_tex_coord2f(0.0f, 1.0f);
       rf_gfx_vertex2f(0.0f, 0.0f);
-      // Bottom-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[1][0], corners[1][1]);
+      rf_gfx_tex_coord2f(0.0f, v);
       rf_gfx_vertex2f(0.0f, h);
-      // Top-right corner for texture and quad
-      rf_gfx_tex_coord2f(corners[2][0], corners[2][1]);
+      rf_gfx_tex_coord2f(u, v);
       rf_gfx_vertex2f(w, h);
-      // Top-left corner for texture and quad
-      rf_gfx_tex_coord2f(corners[3][0], corners[3][1]);
+      rf_gfx_tex_coord2f(u, 1.0f);
       rf_gfx_vertex2f(w, 0.0f);
     rf_gfx_end();
   rf_gfx_pop_matrix();
   rf_gfx_disable_texture();
+  mrb_render_target_release(&(window->render));
 }
 
 static inline void
@@ -264,7 +266,7 @@ draw_border(rf_window *window)
   int h = window->rect->height;
   if (!window->skin) return;
 
-  rf_color color = (rf_color){255, 255, 255, (unsigned char)window->opacity};
+  rf_color color = mrb_blend_color((rf_color){255, 255, 255, (unsigned char)window->opacity}, RF_BLEND_ALPHA);
   rf_rec src;
   rf_rec dst;
   rf_gfx_push_matrix();
@@ -346,7 +348,7 @@ draw_pause_cursor(rf_window *window)
     src.width,
     src.height
   };
-  rf_color color = (rf_color){255, 255, 255, window->opacity };
+  rf_color color = mrb_blend_color((rf_color){255, 255, 255, window->opacity }, RF_BLEND_ALPHA);
   rf_draw_texture_region(window->skin->texture, src, dst, (rf_vec2){0, 0}, 0, color);
 }
 
@@ -357,7 +359,7 @@ draw_arrows(rf_window *window)
   if (!window->contents) return;
 
   rf_vec2 origin = (rf_vec2){ 0, 0 };
-  rf_color color = (rf_color){ 255, 255, 255, window->opacity };
+  rf_color color = mrb_blend_color((rf_color){ 255, 255, 255, window->opacity }, RF_BLEND_ALPHA);
 
   if (window->offset->x > 0)
   {
@@ -398,12 +400,15 @@ static void
 draw_window(mrb_state *mrb, rf_window *window)
 {
   if (window->rect->width <= 0 || window->rect->height <= 0) return;
-  rf_begin_blend_mode(RF_BLEND_ALPHA);
+  if (window->skin) mrb_refresh_bitmap(mrb, window->skin);
+  ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+  mrb_begin_blend_mode(RF_BLEND_ALPHA);
     rf_gfx_translatef(window->rect->x, window->rect->y, 0);
     draw_contents(window);
     draw_border(window);
     draw_cursors(window);
-  rf_end_blend_mode();
+  ORGF_STATS_FLUSH(RF_FLUSH_BLEND);
+  mrb_end_blend_mode();
 }
 
 static mrb_value
@@ -519,10 +524,11 @@ mrb_window_initialize(mrb_state *mrb, mrb_value self)
   DATA_PTR(self) = window;
   window->base.z = 0;
   window->base.container = NULL;
-  window->base.update = NULL;
+  window->base.tick = NULL;
   window->base.visible = TRUE;
   window->base.update = (rf_drawable_update_callback)update_window;
   window->base.draw = (rf_drawable_draw_callback)draw_window;
+  window->base.draw_run = NULL;
   window->active = TRUE;
   window->arrows_visible = TRUE;
   window->contents = NULL;
@@ -590,16 +596,7 @@ mrb_window_initialize(mrb_state *mrb, mrb_value self)
       break;
     }
   }
-  int w = (int)max(0, window->rect->width - 24);
-  int h = (int)max(0, window->rect->height - 24);
-  if (w && h)
-  {
-    window->render = rf_load_render_texture(w, h);
-  }
-  else
-  {
-    window->render.id = 0;
-  }
+  window->render = (rf_render_target){ 0 };
   mrb_container_add_child(mrb, mrb_get_graphics_container(mrb), &(window->base));
   return self;
 }
@@ -0,0 +1,52 @@
+#include <mruby.h>
+#include <mruby/array.h>
+
+#include <orgf/bitmap.h>
+#include <orgf/sprite.h>
+
+typedef struct
+{
+  rf_sprite  sprite;
+  rf_rec     src_rect;
+  rf_vec2    position;
+  rf_vec2    anchor;
+  rf_vec2    scale;
+} test_sprite;
+
+/* Reads [bitmap, x, y, scale_x = 1, scale_y = 1] into a sprite showing the
+   whole bitmap, Sprite.new itself needs the game screen. */
+static void
+get_test_sprite(mrb_state *mrb, mrb_value list, test_sprite *s)
+{
+  mrb_int size = RARRAY_LEN(list);
+  if (size < 3) mrb_raise(mrb, E_ARGUMENT_ERROR, "Expected [bitmap, x, y, scale_x, scale_y]");
+  rf_bitmap *bmp = mrb_get_bitmap(mrb, mrb_ary_entry(list, 0));
+  s->src_rect = (rf_rec){ 0, 0, (float)bmp->image.width, (float)bmp->image.height };
+  s->position = (rf_vec2){ (float)mrb_to_flo(mrb, mrb_ary_entry(list, 1)), (float)mrb_to_flo(mrb, mrb_ary_entry(list, 2)) };
+  s->anchor = (rf_vec2){ 0, 0 };
+  s->scale.x = size > 3 ? (float)mrb_to_flo(mrb, mrb_ary_entry(list, 3)) : 1;
+  s->scale.y = size > 4 ? (float)mrb_to_flo(mrb, mrb_ary_entry(list, 4)) : 1;
+  s->sprite.bitmap = bmp;
+  s->sprite.src_rect = &(s->src_rect);
+  s->sprite.position = &(s->position);
+  s->sprite.anchor = &(s->anchor);
+  s->sprite.scale = &(s->scale);
+}
+
+static mrb_value
+mrb_collision_test_s_collideQ(mrb_state *mrb, mrb_value self)
+{
+  mrb_value a, b;
+  test_sprite sa, sb;
+  mrb_get_args(mrb, "AA", &a, &b);
+  get_test_sprite(mrb, a, &sa);
+  get_test_sprite(mrb, b, &sb);
+  return mrb_bool_value(mrb_sprite_collide(mrb, &(sa.sprite), &(sb.sprite)));
+}
+
+void
+mrb_collision_test_init(mrb_state *mrb)
+{
+  struct RClass *collision_test = mrb_define_module(mrb, "CollisionTest");
+  mrb_define_class_method(mrb, collision_test, "collide?", mrb_collision_test_s_collideQ, MRB_ARGS_REQ(2));
+}
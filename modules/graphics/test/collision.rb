@@ -0,0 +1,54 @@
+# Bitmaps with a single solid pixel, so a hit means the masks really line up
+def collision_bitmap(width, height, x, y, alpha = 255)
+  bitmap = Bitmap.new(width, height)
+  bitmap.set_pixel(x, y, Color.new(255, 255, 255, alpha))
+  bitmap
+end
+
+assert('Sprite collision of unflipped sprites') do
+  a = collision_bitmap(4, 4, 0, 0)
+  b = collision_bitmap(4, 4, 0, 0)
+  assert_true(CollisionTest.collide?([a, 0, 0], [b, 0, 0]))
+  assert_false(CollisionTest.collide?([a, 0, 0], [b, 1, 0]))
+  assert_false(CollisionTest.collide?([a, 0, 0], [b, 4, 0]))
+end
+
+assert('Sprite collision of flipped sprites') do
+  a = collision_bitmap(4, 4, 0, 0)
+  b = collision_bitmap(1, 1, 0, 0)
+  # Mirrored, the solid pixel moves to the right edge
+  assert_true(CollisionTest.collide?([a, 0, 0, -1, 1], [b, 3, 0]))
+  assert_false(CollisionTest.collide?([a, 0, 0, -1, 1], [b, 0, 0]))
+  assert_true(CollisionTest.collide?([a, 0, 0, 1, -1], [b, 0, 3]))
+  assert_false(CollisionTest.collide?([a, 0, 0, 1, -1], [b, 0, 0]))
+end
+
+assert('Sprite collision of flipped rows wider than a mask word') do
+  a = collision_bitmap(70, 2, 10, 1)
+  b = collision_bitmap(1, 1, 0, 0)
+  assert_true(CollisionTest.collide?([a, 0, 0], [b, 10, 1]))
+  assert_true(CollisionTest.collide?([a, 0, 0, -1, 1], [b, 59, 1]))
+  assert_false(CollisionTest.collide?([a, 0, 0, -1, 1], [b, 60, 1]))
+  assert_false(CollisionTest.collide?([a, 0, 0, -1, 1], [b, 59, 0]))
+  # Row against row, the mirrored read straddles both words of the mask
+  assert_true(CollisionTest.collide?([a, 0, 0, -1, 1], [collision_bitmap(70, 2, 59, 1), 0, 0]))
+  assert_false(CollisionTest.collide?([a, 0, 0, -1, 1], [collision_bitmap(70, 2, 58, 1), 0, 0]))
+end
+
+assert('Sprite collision of scaled sprites') do
+  a = collision_bitmap(4, 4, 0, 0)
+  b = collision_bitmap(1, 1, 0, 0)
+  assert_true(CollisionTest.collide?([a, 0, 0, 2, 2], [b, 1, 1]))
+  assert_false(CollisionTest.collide?([a, 0, 0, 2, 2], [b, 2, 0]))
+  assert_true(CollisionTest.collide?([a, 0, 0, -2, 2], [b, 6, 1]))
+  assert_false(CollisionTest.collide?([a, 0, 0, -2, 2], [b, 1, 1]))
+end
+
+assert('Bitmap#collision_mask threshold') do
+  a = collision_bitmap(4, 4, 1, 1, 100)
+  b = collision_bitmap(4, 4, 1, 1)
+  assert_false(CollisionTest.collide?([a, 0, 0], [b, 0, 0]))
+  assert_equal(a, a.collision_mask(64))
+  assert_true(CollisionTest.collide?([a, 0, 0], [b, 0, 0]))
+  assert_raise(ArgumentError) { a.collision_mask(0) }
+end
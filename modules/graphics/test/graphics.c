@@ -0,0 +1,14 @@
+#include <mruby.h>
+
+void
+mrb_movie_test_init(mrb_state *mrb);
+
+void
+mrb_collision_test_init(mrb_state *mrb);
+
+void
+mrb_orgf_graphics_gem_test(mrb_state *mrb)
+{
+  mrb_movie_test_init(mrb);
+  mrb_collision_test_init(mrb);
+}
@@ -0,0 +1,59 @@
+#include <mruby.h>
+#include <mruby/hash.h>
+#include <string.h>
+
+#include <physfs.h>
+
+#include <orgf/movie.h>
+#include <orgf/thread.h>
+
+// Plenty for the fixture, a stuck decoder fails the test instead of hanging it
+#define MAX_UPDATES 2000
+
+/* Mounts the fixtures next to this file, the test binary runs elsewhere. */
+static void
+mount_fixtures(mrb_state *mrb)
+{
+  char dir[1024];
+  const char *file = __FILE__;
+  const char *slash = strrchr(file, '/');
+  const char *backslash = strrchr(file, '\\');
+  if (backslash > slash) slash = backslash;
+  size_t size = slash ? (size_t)(slash - file) : 0;
+  if (size + sizeof "/fixtures" > sizeof dir) mrb_raise(mrb, E_RUNTIME_ERROR, "Fixture path is too long");
+  memcpy(dir, file, size);
+  strcpy(dir + size, size ? "/fixtures" : "fixtures");
+  if (!PHYSFS_isInit() && !PHYSFS_init(NULL)) mrb_raise(mrb, E_RUNTIME_ERROR, "Failed to initialize file system");
+  if (!PHYSFS_mount(dir, "Fixtures", 1)) mrb_raisef(mrb, E_RUNTIME_ERROR, "Failed to mount '%s'", dir);
+}
+
+/* Plays a movie to its end without a GL context, as Graphics does while
+   the screen is being skipped. */
+static mrb_value
+mrb_movie_test_s_decode(mrb_state *mrb, mrb_value self)
+{
+  const char *name;
+  mrb_get_args(mrb, "z", &name);
+  mount_fixtures(mrb);
+  rf_movie *movie = mrb_movie_open(mrb, name);
+  mrb_int updates = 0;
+  while (!mrb_movie_finished(movie) && updates < MAX_UPDATES)
+  {
+    mrb_movie_update(mrb, movie, 1.0 / 60.0, FALSE);
+    orgf_thread_sleep(1);
+    updates += 1;
+  }
+  mrb_value result = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, result, mrb_symbol_value(mrb_intern_lit(mrb, "presented")), mrb_fixnum_value(movie->presented));
+  mrb_hash_set(mrb, result, mrb_symbol_value(mrb_intern_lit(mrb, "dropped")), mrb_fixnum_value(movie->dropped));
+  mrb_hash_set(mrb, result, mrb_symbol_value(mrb_intern_lit(mrb, "finished")), mrb_bool_value(mrb_movie_finished(movie)));
+  mrb_movie_close(mrb, movie);
+  return result;
+}
+
+void
+mrb_movie_test_init(mrb_state *mrb)
+{
+  struct RClass *movie_test = mrb_define_module(mrb, "MovieTest");
+  mrb_define_class_method(mrb, movie_test, "decode", mrb_movie_test_s_decode, MRB_ARGS_REQ(1));
+}
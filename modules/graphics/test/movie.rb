@@ -0,0 +1,5 @@
+assert('Movie decodes without uploading frames') do
+  result = MovieTest.decode('Fixtures/tiny.mpg')
+  assert_true(result[:finished])
+  assert_true(result[:presented] > 0)
+end